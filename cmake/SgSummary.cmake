@@ -84,6 +84,16 @@ else ()
     set(_https_support "No")
 endif ()
 
+if (SG_TRACING)
+    if (HAVE_SYS_SDT_H)
+        set(_tracing "Yes")
+    else ()
+        set(_tracing "No (missing header: sys/sdt.h)")
+    endif ()
+else ()
+    set(_tracing "No")
+endif ()
+
 if (SG_BUILD_EXAMPLES)
     set(_build_examples "Yes")
     if (SG_EXAMPLES)
@@ -190,6 +200,8 @@ Sagui library ${VERSION} - building summary:
     CFLAGS: ${_cflags}
   Build: ${_build_type}-${_build_arch} (${_lib_type})
   HTTPS: ${_https_support}
+  Tracing: ${_tracing}
+  String map hash: ${SG_STRMAP_HASH}
   Examples: ${_build_examples}
   Docs:
     HTML: ${_build_html}
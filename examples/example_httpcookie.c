@@ -46,14 +46,13 @@ static int strtoint(const char *str) {
 }
 
 static void req_cb(__SG_UNUSED void *cls, __SG_UNUSED struct sg_httpreq *req, struct sg_httpres *res) {
-    struct sg_strmap **cookies = sg_httpreq_cookies(req);
     char str[100];
     int count;
     if (strcmp(sg_httpreq_path(req), "/favicon.ico") == 0) {
         sg_httpres_send(res, "", "", 204);
         return;
     }
-    count = cookies ? strtoint(sg_strmap_get(*cookies, COOKIE_NAME)) : 0;
+    count = strtoint(sg_httpreq_cookie(req, COOKIE_NAME));
     if (count == 0) {
         snprintf(str, sizeof(str), INITIAL_PAGE);
         count = 1;
@@ -95,13 +95,12 @@ static void process_uploads(struct sg_httpreq *req, struct sg_httpres *res) {
 }
 
 static void req_cb(__SG_UNUSED void *cls, struct sg_httpreq *req, struct sg_httpres *res) {
-    struct sg_strmap **qs;
     const char *file;
     char path[PATH_MAX];
     if (sg_httpreq_is_uploading(req))
         process_uploads(req, res);
     else {
-        if ((qs = sg_httpreq_params(req)) && (file = sg_strmap_get(*qs, "file"))) {
+        if ((file = sg_httpreq_param(req, "file"))) {
             sprintf(path, "%s%c%s", sg_tmpdir(), PATH_SEP, file);
             sg_httpres_sendfile(res, 4096, 0, path, false, 200);
         } else
@@ -0,0 +1,81 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sagui.h>
+
+/* NOTE: Error checking has been omitted for clarity. */
+
+static void home_cb(__SG_UNUSED void *cls, __SG_UNUSED struct sg_route *route, __SG_UNUSED struct sg_httpreq *req,
+                    struct sg_httpres *res) {
+    sg_httpres_send(res, "<html><head><title>Home</title></head><body>Home</body></html>",
+                    "text/html; charset=utf-8", 200);
+}
+
+static void user_cb(__SG_UNUSED void *cls, struct sg_route *route, __SG_UNUSED struct sg_httpreq *req,
+                    struct sg_httpres *res) {
+    char str[256];
+    size_t len;
+    const char *id = sg_route_param(route, "id", &len);
+    snprintf(str, sizeof(str), "<html><head><title>User</title></head><body>User: %.*s</body></html>", (int) len, id);
+    sg_httpres_send(res, str, "text/html; charset=utf-8", 200);
+}
+
+static void req_cb(void *cls, struct sg_httpreq *req, struct sg_httpres *res) {
+    switch (sg_router_dispatch(cls, req, res)) {
+        case ENOENT:
+            sg_httpres_send(res, "Not found", "text/plain", 404);
+            break;
+        case ENOTSUP:
+            sg_httpres_send(res, "Method not allowed", "text/plain", 405);
+            break;
+        default:
+            break;
+    }
+}
+
+int main(void) {
+    struct sg_router *router = sg_router_new();
+    struct sg_httpsrv *srv;
+    sg_router_add(router, "GET", "/", home_cb, NULL);
+    sg_router_add(router, "GET", "/users/:id", user_cb, NULL);
+    sg_router_compile(router);
+    srv = sg_httpsrv_new(req_cb, router);
+    if (!sg_httpsrv_listen(srv, 0 /* 0 = port chosen randomly */, false)) {
+        sg_httpsrv_free(srv);
+        sg_router_free(router);
+        return EXIT_FAILURE;
+    }
+    fprintf(stdout, "Server running at http://localhost:%d\n", sg_httpsrv_port(srv));
+    fflush(stdout);
+    getchar();
+    sg_httpsrv_free(srv);
+    sg_router_free(router);
+    return EXIT_SUCCESS;
+}
@@ -92,6 +92,51 @@ extern "C" {
  */
 typedef void (*sg_err_cb)(void *cls, const char *err);
 
+/**
+ * Error codes reported by #sg_err.
+ */
+enum sg_err_code {
+    /** Error reported by the HTTP engine (libmicrohttpd). */
+    SG_ERR_HTTPD,
+    /** Request payload larger than the limit set by #sg_httpsrv_set_payld_limit(). */
+    SG_ERR_PAYLD_TOO_LARGE,
+    /** Uploads larger than the limit set by #sg_httpsrv_set_uplds_limit(). */
+    SG_ERR_UPLDS_TOO_LARGE,
+    /** Uploads directory not found or not accessible. */
+    SG_ERR_UPLDS_DIR,
+    /** Temporary upload file that could not be created, written, closed or removed. */
+    SG_ERR_UPLD_FILE,
+    /** Request larger than the limit set by #sg_httpsrv_set_req_mem_limit(). */
+    SG_ERR_REQ_MEM_TOO_LARGE
+};
+
+/**
+ * Subsystems which report errors by #sg_err.
+ */
+enum sg_err_subsys {
+    /** Server and connections handling. */
+    SG_ERR_SUBSYS_HTTPSRV,
+    /** Payload and uploads handling. */
+    SG_ERR_SUBSYS_HTTPUPLDS
+};
+
+/**
+ * Structured error record. The record and its message are only valid during the callback that received them, use
+ * #sg_err_dup() to keep a copy.
+ */
+struct sg_err {
+    /** Error code. */
+    enum sg_err_code code;
+    /** Subsystem which reported the error. */
+    enum sg_err_subsys subsys;
+    /** Error number (`errno`) which caused the error, or `0` if not applicable. */
+    int errnum;
+    /** Request being handled when the error happened, or `NULL` if not tied to a request. */
+    struct sg_httpreq *req;
+    /** Error message. */
+    const char *msg;
+};
+
 /**
  * Callback signature used by functions that write streams.
  * \param[out] handle Stream handle.
@@ -118,6 +163,21 @@ typedef ssize_t (*sg_read_cb)(void *handle, uint64_t offset, char *buf, size_t s
  */
 typedef void (*sg_free_cb)(void *handle);
 
+/**
+ * Callback signature used by functions that allocate memory.
+ * \param[out] size Memory size to be allocated.
+ * \return Pointer of the allocated memory, or `NULL` if no memory space.
+ */
+typedef void *(*sg_malloc_cb)(size_t size);
+
+/**
+ * Callback signature used by functions that reallocate memory.
+ * \param[out] ptr Pointer of the memory to be reallocated.
+ * \param[out] size Memory size to be reallocated.
+ * \return Pointer of the reallocated memory, or `NULL` if no memory space.
+ */
+typedef void *(*sg_realloc_cb)(void *ptr, size_t size);
+
 /**
  * Callback signature used by functions that save streams.
  * \param[out] handle Stream handle.
@@ -174,6 +234,22 @@ __SG_MALLOC;
  */
 SG_EXTERN void sg_free(void *ptr);
 
+/**
+ * Sets the functions used by the library to allocate memory, including the strings and hash tables of the maps and
+ * the buffers of the strings. It allows to use other allocators, e.g. memory arenas or allocators which account the
+ * memory used by the server.
+ * \param[in] malloc_cb Function to allocate memory, equivalent to [malloc(3)](https://linux.die.net/man/3/malloc).
+ * \param[in] realloc_cb Function to reallocate memory, equivalent to
+ * [realloc(3)](https://linux.die.net/man/3/realloc).
+ * \param[in] free_cb Function to free memory, equivalent to [free(3)](https://linux.die.net/man/3/free), never
+ * called with a null pointer.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument, i.e. only some of the functions are null (all null restore the C allocator).
+ * \warning It must be called before any other function of the library, since a memory must be freed by the same
+ * allocator which allocated it. The functions are called from the server threads and must be thread-safe.
+ */
+SG_EXTERN int sg_set_allocator(sg_malloc_cb malloc_cb, sg_realloc_cb realloc_cb, sg_free_cb free_cb);
+
 /**
  * Returns string describing an error number.
  * \param[in] errnum Error number.
@@ -183,6 +259,15 @@ SG_EXTERN void sg_free(void *ptr);
  */
 SG_EXTERN char *sg_strerror(int errnum, char *errmsg, size_t errlen);
 
+/**
+ * Duplicates an error record, including its message, into a single memory block.
+ * \param[in] err Error record.
+ * \return Copy of the error record, which must be freed by #sg_free().
+ * \retval NULL If the \p err is null and sets the `errno` to `EINVAL`.
+ * \note The request of the copy is only valid while the request is being handled.
+ */
+SG_EXTERN struct sg_err *sg_err_dup(const struct sg_err *err);
+
 /**
  * Checks if a string is a HTTP post method.
  * \param[in] method Null-terminated string.
@@ -197,6 +282,15 @@ SG_EXTERN bool sg_is_post(const char *method);
  */
 SG_EXTERN char *sg_tmpdir(void);
 
+/**
+ * Returns the first listening socket inherited from the service manager, following the systemd socket activation
+ * protocol (environment variables `LISTEN_PID` and `LISTEN_FDS`).
+ * \return Inherited socket, `-1` otherwise and sets the `errno` to `ENOENT`.
+ * \note A predecessor process can use the same protocol to hand its listening socket over to a successor, see
+ * #sg_httpsrv_export_fd().
+ */
+SG_EXTERN int sg_inherited_fd(void);
+
 /** \} */
 
 /**
@@ -339,8 +433,8 @@ SG_EXTERN const char *sg_strmap_val(struct sg_strmap *pair);
  * \param[in] val Pair value.
  * \retval 0 - Success.
  * \retval EINVAL - Invalid argument.
- * \note It cannot check if a name already exists in a pair added to the \p map, then the uniqueness must be managed
- * by the application.
+ * \note If the name already exists in the \p map, the value is added as one more value of that name, retrieved by
+ * #sg_strmap_find_next() or #sg_strmap_get_all().
  * \warning It exits the application if called when no memory space is available.
  */
 SG_EXTERN int sg_strmap_add(struct sg_strmap **map, const char *name, const char *val);
@@ -352,8 +446,8 @@ SG_EXTERN int sg_strmap_add(struct sg_strmap **map, const char *name, const char
  * \param[in] val Pair value.
  * \retval 0 - Success.
  * \retval EINVAL - Invalid argument.
- * \note If a name already exists in a pair previously added into the \p map, then the function replaces its value,
- * otherwise it is added as a new pair.
+ * \note If a name already exists in pairs previously added into the \p map, then the function replaces all their
+ * values, otherwise it is added as a new pair.
  * \warning It exits the application if called when no memory space is available.
  */
 SG_EXTERN int sg_strmap_set(struct sg_strmap **map, const char *name, const char *val);
@@ -366,9 +460,31 @@ SG_EXTERN int sg_strmap_set(struct sg_strmap **map, const char *name, const char
  * \retval 0 - Success.
  * \retval EINVAL - Invalid argument.
  * \retval ENOENT - Pair not found.
+ * \note If the name has several values, the first added one is found.
  */
 SG_EXTERN int sg_strmap_find(struct sg_strmap *map, const char *name, struct sg_strmap **pair);
 
+/**
+ * Gets the next pair with the same name of a pair, i.e. the next value of a repeated name.
+ * \param[in,out] pair Pointer to the pair found by #sg_strmap_find(), which is replaced by the next pair with the same
+ * name, or `NULL` if there are no more values.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ */
+SG_EXTERN int sg_strmap_find_next(struct sg_strmap **pair);
+
+/**
+ * Gets all the values of a name, in the order they were added, without scanning the whole map.
+ * \param[in] map Pairs map.
+ * \param[in] name Name to get the values.
+ * \param[out] vals Array to store the values, or `NULL` to just count them.
+ * \param[in] size Size of the \p vals array.
+ * \return Number of values of the name, which can be greater than \p size.
+ * \retval 0 If the name is not found, or if \p map or \p name is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN unsigned int sg_strmap_get_all(struct sg_strmap *map, const char *name, const char **vals,
+                                         unsigned int size);
+
 /**
  * Gets a pair by name and returns the value.
  * \param[in] map Pairs map.
@@ -385,6 +501,7 @@ SG_EXTERN const char *sg_strmap_get(struct sg_strmap *map, const char *name);
  * \retval 0 - Success.
  * \retval EINVAL - Invalid argument.
  * \retval ENOENT - Pair already removed.
+ * \note If the name has several values, only the first added one is removed.
  */
 SG_EXTERN int sg_strmap_rm(struct sg_strmap **map, const char *name);
 
@@ -431,6 +548,111 @@ SG_EXTERN int sg_strmap_next(struct sg_strmap **next);
  */
 SG_EXTERN void sg_strmap_cleanup(struct sg_strmap **map);
 
+/**
+ * Handle for an immutable snapshot of a string map, which can be read concurrently by any number of threads without
+ * locks. It is useful to represent read-mostly tables, like MIME types, redirects or settings reloaded at runtime.
+ * \struct sg_strmap_snap
+ */
+struct sg_strmap_snap;
+
+/**
+ * Handle for publishing snapshots of string maps to concurrent readers, allowing to replace them atomically.
+ * \struct sg_strmap_shared
+ */
+struct sg_strmap_shared;
+
+/**
+ * Freezes a string map into a compact read-only snapshot, keeping its pairs and their order.
+ * \param[in] map Pairs map to be frozen, which can be null to get an empty snapshot.
+ * \param[out] snap Pointer to store the new snapshot.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note The \p map is not changed and can be freed just after freezing it.
+ * \note The snapshot must be released by #sg_strmap_snap_release().
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN int sg_strmap_freeze(struct sg_strmap *map, struct sg_strmap_snap **snap);
+
+/**
+ * Finds a pair of a snapshot by name.
+ * \param[in] snap Snapshot of pairs.
+ * \param[in] name Name to find the pair.
+ * \param[in,out] pair Pointer to store the found pair, whose next values can be got by #sg_strmap_find_next().
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \retval ENOENT - Pair not found.
+ * \warning The pairs of a snapshot are read-only, so they must never be passed to functions changing a map.
+ */
+SG_EXTERN int sg_strmap_snap_find(struct sg_strmap_snap *snap, const char *name, struct sg_strmap **pair);
+
+/**
+ * Gets a pair of a snapshot by name and returns the value.
+ * \param[in] snap Snapshot of pairs.
+ * \param[in] name Name to get the pair.
+ * \return Pair value.
+ * \retval NULL If \p snap or \p name is null or pair is not found.
+ */
+SG_EXTERN const char *sg_strmap_snap_get(struct sg_strmap_snap *snap, const char *name);
+
+/**
+ * Iterates over the pairs of a snapshot, in the order they were added to the frozen map.
+ * \param[in] snap Snapshot of pairs.
+ * \param[in] cb Callback to iterate the pairs.
+ * \param[in,out] cls User-specified value.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \return Callback result when it is different from `0`.
+ */
+SG_EXTERN int sg_strmap_snap_iter(struct sg_strmap_snap *snap, sg_strmap_iter_cb cb, void *cls);
+
+/**
+ * Counts the total pairs in a snapshot.
+ * \param[in] snap Snapshot of pairs.
+ * \return Total of pairs.
+ * \retval 0 If the snapshot is empty or null.
+ */
+SG_EXTERN unsigned int sg_strmap_snap_count(struct sg_strmap_snap *snap);
+
+/**
+ * Releases a reference of a snapshot, freeing it when no more threads are using it.
+ * \param[in] snap Snapshot of pairs.
+ */
+SG_EXTERN void sg_strmap_snap_release(struct sg_strmap_snap *snap);
+
+/**
+ * Creates a new handle for publishing snapshots.
+ * \param[in] snap Initial snapshot, which can be null. The handle takes over its reference.
+ * \return New handle for publishing snapshots.
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN struct sg_strmap_shared *sg_strmap_shared_new(struct sg_strmap_snap *snap);
+
+/**
+ * Frees the handle for publishing snapshots, releasing its current snapshot.
+ * \param[in] shared Handle for publishing snapshots.
+ * \note Readers can keep using the snapshots they have acquired until releasing them.
+ */
+SG_EXTERN void sg_strmap_shared_free(struct sg_strmap_shared *shared);
+
+/**
+ * Acquires the current snapshot of a handle, without locking it. It is safe to call from any thread, even while the
+ * snapshot is being replaced.
+ * \param[in] shared Handle for publishing snapshots.
+ * \return Current snapshot, which must be released by #sg_strmap_snap_release() after using it.
+ * \retval NULL If the handle has no snapshot, or if \p shared is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN struct sg_strmap_snap *sg_strmap_shared_acquire(struct sg_strmap_shared *shared);
+
+/**
+ * Replaces atomically the current snapshot of a handle, e.g. when reloading a configuration. Readers see either the
+ * old or the new snapshot, and the old one is freed after the last reader releases it.
+ * \param[in] shared Handle for publishing snapshots.
+ * \param[in] snap New snapshot, which can be null. The handle takes over its reference.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ */
+SG_EXTERN int sg_strmap_shared_swap(struct sg_strmap_shared *shared, struct sg_strmap_snap *snap);
+
 /** \} */
 
 /**
@@ -514,6 +736,184 @@ typedef int (*sg_httpuplds_iter_cb)(void *cls, struct sg_httpupld *upld);
  */
 typedef void (*sg_httpreq_cb)(void *cls, struct sg_httpreq *req, struct sg_httpres *res);
 
+/**
+ * Callback signature used to handle client sockets accepted by the server.
+ * \param[out] cls User-defined closure.
+ * \param[out] fd Client socket.
+ */
+typedef void (*sg_httpsrv_accept_cb)(void *cls, int fd);
+
+/**
+ * Callback signature used to handle server errors as structured records.
+ * \param[out] cls User-defined closure.
+ * \param[out] err Error record.
+ */
+typedef void (*sg_httpsrv_err_cb)(void *cls, const struct sg_err *err);
+
+/**
+ * Socket options handled by #sg_httpsrv_set_sockopt(). The first three apply to the listening sockets, the others to
+ * each accepted client socket.
+ */
+enum sg_httpsrv_sockopt {
+    /** Size of the queue of pending connections (`listen()` backlog). */
+    SG_HTTPSRV_SOCKOPT_BACKLOG,
+    /** Non-zero to allow other sockets to bind the same port (`SO_REUSEPORT`). */
+    SG_HTTPSRV_SOCKOPT_REUSEPORT,
+    /** Size of the queue of pending TCP Fast Open requests (`TCP_FASTOPEN`, Linux only). */
+    SG_HTTPSRV_SOCKOPT_FASTOPEN,
+    /** Non-zero to send small responses without delay, disabling the Nagle's algorithm (`TCP_NODELAY`). */
+    SG_HTTPSRV_SOCKOPT_NODELAY,
+    /** Size of the socket send buffer (`SO_SNDBUF`). */
+    SG_HTTPSRV_SOCKOPT_SNDBUF,
+    /** Size of the socket receive buffer (`SO_RCVBUF`). */
+    SG_HTTPSRV_SOCKOPT_RCVBUF,
+    /** Time (in microseconds) to busy poll the device queue on blocking reads (`SO_BUSY_POLL`, Linux only). */
+    SG_HTTPSRV_SOCKOPT_BUSY_POLL
+};
+
+/**
+ * Policies used by #sg_httpsrv_set_thr_affinity() to pin the server threads to CPUs.
+ */
+enum sg_httpsrv_affinity {
+    /** Threads are not pinned and are scheduled freely by the system (default). */
+    SG_HTTPSRV_AFFINITY_NONE,
+    /** Threads are pinned to consecutive CPUs, filling a NUMA node before using the next one. */
+    SG_HTTPSRV_AFFINITY_COMPACT,
+    /** Threads are pinned to CPUs alternating the NUMA nodes, spreading them across the sockets. */
+    SG_HTTPSRV_AFFINITY_SCATTER,
+    /** Threads are pinned to the CPUs of a list, in order. */
+    SG_HTTPSRV_AFFINITY_LIST
+};
+
+/**
+ * Request phases measured by the server latency histograms, queried by #sg_httpsrv_lat_quantile().
+ */
+enum sg_httpsrv_phase {
+    /** From accepting the connection (or completing its previous request) to parsing the request headers. */
+    SG_HTTPSRV_PHASE_HEADERS,
+    /** From parsing the request headers to receiving the whole request payload. */
+    SG_HTTPSRV_PHASE_BODY,
+    /** Execution of the request callback. */
+    SG_HTTPSRV_PHASE_HANDLER,
+    /** Queueing of the response. */
+    SG_HTTPSRV_PHASE_QUEUE,
+    /** From queueing the response to completing the request, i.e. sending the response to the client. */
+    SG_HTTPSRV_PHASE_COMPLETE,
+    /** From parsing the request headers to completing the request. */
+    SG_HTTPSRV_PHASE_TOTAL
+};
+
+/**
+ * Formats of the server access log, set by #sg_httpsrv_set_access_log().
+ */
+enum sg_httpsrv_log_fmt {
+    /** Common Log Format, e.g. `127.0.0.1 - - [10/Oct/2018:13:55:36 +0000] "GET / HTTP/1.1" 200 2326`. */
+    SG_HTTPSRV_LOG_COMMON,
+    /** Combined Log Format, i.e. the Common Log Format followed by the quoted `Referer` and `User-Agent` headers. */
+    SG_HTTPSRV_LOG_COMBINED,
+    /** One JSON object per line, including the request duration (in microseconds) as `duration_us`. */
+    SG_HTTPSRV_LOG_JSON
+};
+
+/**
+ * Well-known HTTP headers, accessed by #sg_httpreq_header_id() and #sg_httpres_set_header_id() without hashing or
+ * comparing their names.
+ */
+enum sg_hdr {
+    /** `Accept` header. */
+    SG_HDR_ACCEPT,
+    /** `Accept-Charset` header. */
+    SG_HDR_ACCEPT_CHARSET,
+    /** `Accept-Encoding` header. */
+    SG_HDR_ACCEPT_ENCODING,
+    /** `Accept-Language` header. */
+    SG_HDR_ACCEPT_LANGUAGE,
+    /** `Accept-Ranges` header. */
+    SG_HDR_ACCEPT_RANGES,
+    /** `Age` header. */
+    SG_HDR_AGE,
+    /** `Allow` header. */
+    SG_HDR_ALLOW,
+    /** `Authorization` header. */
+    SG_HDR_AUTHORIZATION,
+    /** `Cache-Control` header. */
+    SG_HDR_CACHE_CONTROL,
+    /** `Connection` header. */
+    SG_HDR_CONNECTION,
+    /** `Content-Disposition` header. */
+    SG_HDR_CONTENT_DISPOSITION,
+    /** `Content-Encoding` header. */
+    SG_HDR_CONTENT_ENCODING,
+    /** `Content-Language` header. */
+    SG_HDR_CONTENT_LANGUAGE,
+    /** `Content-Length` header. */
+    SG_HDR_CONTENT_LENGTH,
+    /** `Content-Location` header. */
+    SG_HDR_CONTENT_LOCATION,
+    /** `Content-Range` header. */
+    SG_HDR_CONTENT_RANGE,
+    /** `Content-Type` header. */
+    SG_HDR_CONTENT_TYPE,
+    /** `Cookie` header. */
+    SG_HDR_COOKIE,
+    /** `Date` header. */
+    SG_HDR_DATE,
+    /** `ETag` header. */
+    SG_HDR_ETAG,
+    /** `Expect` header. */
+    SG_HDR_EXPECT,
+    /** `Expires` header. */
+    SG_HDR_EXPIRES,
+    /** `Host` header. */
+    SG_HDR_HOST,
+    /** `If-Match` header. */
+    SG_HDR_IF_MATCH,
+    /** `If-Modified-Since` header. */
+    SG_HDR_IF_MODIFIED_SINCE,
+    /** `If-None-Match` header. */
+    SG_HDR_IF_NONE_MATCH,
+    /** `If-Range` header. */
+    SG_HDR_IF_RANGE,
+    /** `If-Unmodified-Since` header. */
+    SG_HDR_IF_UNMODIFIED_SINCE,
+    /** `Last-Modified` header. */
+    SG_HDR_LAST_MODIFIED,
+    /** `Location` header. */
+    SG_HDR_LOCATION,
+    /** `Origin` header. */
+    SG_HDR_ORIGIN,
+    /** `Pragma` header. */
+    SG_HDR_PRAGMA,
+    /** `Range` header. */
+    SG_HDR_RANGE,
+    /** `Referer` header. */
+    SG_HDR_REFERER,
+    /** `Retry-After` header. */
+    SG_HDR_RETRY_AFTER,
+    /** `Server` header. */
+    SG_HDR_SERVER,
+    /** `Set-Cookie` header. */
+    SG_HDR_SET_COOKIE,
+    /** `Transfer-Encoding` header. */
+    SG_HDR_TRANSFER_ENCODING,
+    /** `Upgrade` header. */
+    SG_HDR_UPGRADE,
+    /** `User-Agent` header. */
+    SG_HDR_USER_AGENT,
+    /** `Vary` header. */
+    SG_HDR_VARY,
+    /** `Via` header. */
+    SG_HDR_VIA,
+    /** `WWW-Authenticate` header. */
+    SG_HDR_WWW_AUTHENTICATE,
+    /** `X-Forwarded-For` header. */
+    SG_HDR_X_FORWARDED_FOR,
+    /** `X-Forwarded-Proto` header. */
+    SG_HDR_X_FORWARDED_PROTO,
+    /** `X-Requested-With` header. */
+    SG_HDR_X_REQUESTED_WITH
+};
+
 /**
  * Sets the authentication protection space (realm).
  * \param[in] auth Authentication handle.
@@ -700,6 +1100,48 @@ SG_EXTERN struct sg_strmap **sg_httpreq_cookies(struct sg_httpreq *req);
  */
 SG_EXTERN struct sg_strmap **sg_httpreq_params(struct sg_httpreq *req);
 
+/**
+ * Gets a client header by its name (case-insensitive), without building the headers map.
+ * \param[in] req Request handle.
+ * \param[in] name Header name.
+ * \return Header value, valid while the request is alive.
+ * \retval NULL If the header is not found, or if \p req or \p name is null and sets the `errno` to `EINVAL`.
+ * \note If the map was already built by #sg_httpreq_headers(), the value is looked up in it.
+ */
+SG_EXTERN const char *sg_httpreq_header(struct sg_httpreq *req, const char *name);
+
+/**
+ * Gets a client cookie by its name (case-insensitive), without building the cookies map.
+ * \param[in] req Request handle.
+ * \param[in] name Cookie name.
+ * \return Cookie value, valid while the request is alive.
+ * \retval NULL If the cookie is not found, or if \p req or \p name is null and sets the `errno` to `EINVAL`.
+ * \note If the map was already built by #sg_httpreq_cookies(), the value is looked up in it.
+ */
+SG_EXTERN const char *sg_httpreq_cookie(struct sg_httpreq *req, const char *name);
+
+/**
+ * Gets a query-string parameter by its name (case-insensitive), without building the query-string map.
+ * \param[in] req Request handle.
+ * \param[in] name Parameter name.
+ * \return Parameter value, valid while the request is alive.
+ * \retval NULL If the parameter is not found, or if \p req or \p name is null and sets the `errno` to `EINVAL`.
+ * \note If the map was already built by #sg_httpreq_params(), the value is looked up in it.
+ */
+SG_EXTERN const char *sg_httpreq_param(struct sg_httpreq *req, const char *name);
+
+/**
+ * Gets a well-known client header by its identifier. The first call indexes all the well-known headers received in a
+ * single pass, so the next ones are constant time.
+ * \param[in] req Request handle.
+ * \param[in] id Header identifier.
+ * \return Header value as received from the client, valid while the request is alive.
+ * \retval NULL If the header is not found, or if \p req is null or \p id is invalid and sets the `errno` to
+ * `EINVAL`.
+ * \note If the header is repeated, the first one is returned.
+ */
+SG_EXTERN const char *sg_httpreq_header_id(struct sg_httpreq *req, enum sg_hdr id);
+
 /**
  * Returns the fields of a HTML form into #sg_strmap map.
  * \param[in] req Request handle.
@@ -749,6 +1191,15 @@ SG_EXTERN struct sg_str *sg_httpreq_payload(struct sg_httpreq *req);
  */
 SG_EXTERN bool sg_httpreq_is_uploading(struct sg_httpreq *req);
 
+/**
+ * Gets the memory used by the library to store the request, i.e. its payload, fields and the maps of headers,
+ * cookies and parameters created so far.
+ * \param[in] req Request handle.
+ * \return Request memory size (in bytes).
+ * \retval 0 If the \p req is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN size_t sg_httpreq_mem_size(struct sg_httpreq *req);
+
 /**
  * Returns the list of the uploaded files.
  * \param[in] req Request handle.
@@ -807,6 +1258,53 @@ SG_EXTERN struct sg_strmap **sg_httpres_headers(struct sg_httpres *res);
  */
 SG_EXTERN int sg_httpres_set_cookie(struct sg_httpres *res, const char *name, const char *val);
 
+/**
+ * Sets a well-known server header by its identifier, stored in a fixed slot instead of the headers map.
+ * \param[in] res Response handle.
+ * \param[in] id Header identifier.
+ * \param[in] val Header value, or `NULL` to remove it.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note The header is sent in addition to the ones of the headers map, so it should not be set in both.
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN int sg_httpres_set_header_id(struct sg_httpres *res, enum sg_hdr id, const char *val);
+
+/**
+ * Handle for an immutable block of validated headers, which can be attached to many responses at once. It is useful
+ * to send the same set of headers in several endpoints, like CORS, security or cache policy headers.
+ * \struct sg_httphdrs
+ */
+struct sg_httphdrs;
+
+/**
+ * Builds a block of headers from a headers map, validating them once.
+ * \param[in] headers Headers map, which can be null to get an empty block.
+ * \param[out] hdrs Pointer to store the new block.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument, or a header name is not a valid token or a header value has control characters.
+ * \note The \p headers map is not changed and can be freed just after building the block.
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN int sg_httphdrs_new(struct sg_strmap *headers, struct sg_httphdrs **hdrs);
+
+/**
+ * Frees a block of headers. The responses it is attached to keep using it until they are dispatched.
+ * \param[in] hdrs Block of headers.
+ */
+SG_EXTERN void sg_httphdrs_free(struct sg_httphdrs *hdrs);
+
+/**
+ * Attaches a block of headers to the response handle, without copying them. It is safe to attach the same block to
+ * responses of different threads.
+ * \param[in] res Response handle.
+ * \param[in] hdrs Block of headers, or `NULL` to detach the current one.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note The block is sent before the headers map, so its headers should not be set in both.
+ */
+SG_EXTERN int sg_httpres_set_headers_block(struct sg_httpres *res, struct sg_httphdrs *hdrs);
+
 /**
  * Sends a null-terminated string content to the client.
  * \param[in] res Response handle.
@@ -947,18 +1445,65 @@ SG_EXTERN bool sg_httpsrv_tls_listen(struct sg_httpsrv *srv, const char *key, co
  * \param[in] threaded Enable/disable the threaded model. If `true`, the server creates one thread per connection.
  * \return `true` if the server is started, `false` otherwise. If \p srv is null, sets the `errno` to `EINVAL`.
  * \note If port is `0`, the operating system will assign randomly an unused port.
+ * \note Calling any of the listening functions on a server already listening adds a new listener to it (e.g. HTTP
+ * and HTTPS ports plus a Unix domain socket). All the listeners share the same callbacks, limits and settings, and
+ * the non-threaded ones are served by the same thread pool (see sg_httpsrv_set_thr_pool_size()).
  */
 SG_EXTERN bool sg_httpsrv_listen(struct sg_httpsrv *srv, uint16_t port, bool threaded);
 
+#ifndef _WIN32
+
+/**
+ * Starts the HTTP server listening on a Unix domain socket.
+ * \param[in] srv Server handle.
+ * \param[in] path File system path of the socket.
+ * \param[in] mode Permissions of the socket file (e.g. `0660`), or `0` to keep the ones defined by the process umask.
+ * \param[in] threaded Enable/disable the threaded model. If `true`, the server creates one thread per connection.
+ * \return `true` if the server is started, `false` otherwise. If \p srv or \p path is null, sets the `errno` to
+ * `EINVAL`.
+ * \note A stale socket file left by a dead server is replaced, but if another server is still accepting connections
+ * on \p path the function fails and sets the `errno` to `EADDRINUSE`. The socket file is removed when the server is
+ * stopped.
+ */
+SG_EXTERN bool sg_httpsrv_listen_unix(struct sg_httpsrv *srv, const char *path, unsigned int mode, bool threaded);
+
+#endif
+
 /**
- * Stops the server not to accept new connections.
+ * Stops the server (all its listeners) not to accept new connections.
  * \param[in] srv Server handle.
  * \return `0` if the server is stopped. If \p srv is null, sets the `errno` to `EINVAL`.
  */
 SG_EXTERN int sg_httpsrv_shutdown(struct sg_httpsrv *srv);
 
 /**
- * Returns the server listening port.
+ * Stops the server gracefully. It stops accepting new connections, lets the in-flight requests finish until the
+ * \p timeout is reached, and then stops the server closing the remaining connections.
+ * \param[in] srv Server handle.
+ * \param[in] timeout Maximum time (in seconds) to wait for the in-flight requests.
+ * \param[out] drained Pointer to store the total of requests finished while draining (can be null).
+ * \param[out] aborted Pointer to store the total of requests aborted by the server stop (can be null).
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note Responses sent while draining include the header `Connection: close`, and the idle keep-alive connections
+ * are closed when the draining starts (in about one second in the non-threaded mode, by a connection timeout).
+ */
+SG_EXTERN int sg_httpsrv_drain(struct sg_httpsrv *srv, unsigned int timeout, unsigned int *drained,
+                               unsigned int *aborted);
+
+/**
+ * Duplicates the server listening socket allowing to hand it over to a successor process (e.g. a new binary started
+ * by `fork()` + `exec()`). The new socket is inheritable, so the successor can start listening on it by
+ * #sg_httpsrv_set_listen_fd() while the current server is stopped gracefully by #sg_httpsrv_drain(), and no pending
+ * connection is refused during the upgrade.
+ * \param[in] srv Server handle.
+ * \return Duplicated listening socket, `-1` otherwise. If \p srv is null or not listening, sets the `errno` to
+ * `EINVAL`.
+ */
+SG_EXTERN int sg_httpsrv_export_fd(struct sg_httpsrv *srv);
+
+/**
+ * Returns the server listening port (of the first listener).
  * \param[in] srv Server handle.
  * \return Server listening port, `0` otherwise. If \p srv is null, sets the `errno` to `EINVAL`.
  */
@@ -1057,9 +1602,15 @@ SG_EXTERN uint64_t sg_httpsrv_uplds_limit(struct sg_httpsrv *srv);
 /**
  * Sets the size for the thread pool.
  * \param[in] srv Server handle.
- * \param[in] size Thread pool size.
+ * \param[in] size Thread pool size, or `0` to use one thread (default).
  * \retval 0 - Success.
  * \retval EINVAL - Invalid argument.
+ * \note The pool threads are created once when the server starts listening and are reused by all connections, so
+ * it avoids the cost of creating a thread for each accepted connection in threaded mode, in exchange for a
+ * connection not having a dedicated thread. Pools can't be combined with the threaded mode.
+ * \note The pool is shared by all the non-threaded listeners: each of its threads accepts and serves connections of
+ * every listener, so a busy listener can use the whole pool while the others are idle. The size is read when the
+ * first listener starts, and kept until the server is shut down.
  */
 SG_EXTERN int sg_httpsrv_set_thr_pool_size(struct sg_httpsrv *srv, unsigned int size);
 
@@ -1071,6 +1622,52 @@ SG_EXTERN int sg_httpsrv_set_thr_pool_size(struct sg_httpsrv *srv, unsigned int
  */
 SG_EXTERN unsigned int sg_httpsrv_thr_pool_size(struct sg_httpsrv *srv);
 
+/**
+ * Sets the stack size of the threads created by the server, i.e. the pool threads, and the polling thread and the
+ * thread of each connection in threaded mode.
+ * \param[in] srv Server handle.
+ * \param[in] size Thread stack size (in bytes), or `0` to use the system default (default).
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note In threaded mode, lowering the stack size (e.g. to 64 kB) reduces the address space reserved per
+ * connection, allowing more concurrent connections. The request callbacks must not use more stack than it.
+ */
+SG_EXTERN int sg_httpsrv_set_thr_stack_size(struct sg_httpsrv *srv, size_t size);
+
+/**
+ * Gets the stack size of the threads created by the server.
+ * \param[in] srv Server handle.
+ * \return Thread stack size (in bytes), or `0` if the system default is used.
+ * \retval 0 If the \p srv is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN size_t sg_httpsrv_thr_stack_size(struct sg_httpsrv *srv);
+
+/**
+ * Sets the policy used to pin the threads of the pool to CPUs. Each thread is pinned when it starts, before
+ * allocating its statistics and buffers, so they are placed on the NUMA node of the thread.
+ * \param[in] srv Server handle.
+ * \param[in] affinity Affinity policy.
+ * \param[in] cpus List of CPUs for #SG_HTTPSRV_AFFINITY_LIST, reused in a round-robin way if the server has more
+ * threads than CPUs. It is ignored by the other policies.
+ * \param[in] count Number of CPUs in \p cpus.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \retval ENOTSUP - Thread affinity not supported by the platform (Linux only).
+ * \retval ENOMEM - Out of memory.
+ * \note The policy is used by the listeners started after this call. The threads of the threaded mode are not
+ * pinned, since one thread is created for each connection.
+ */
+SG_EXTERN int sg_httpsrv_set_thr_affinity(struct sg_httpsrv *srv, enum sg_httpsrv_affinity affinity,
+                                          const unsigned int *cpus, unsigned int count);
+
+/**
+ * Gets the policy used to pin the server threads to CPUs.
+ * \param[in] srv Server handle.
+ * \return Affinity policy.
+ * \retval SG_HTTPSRV_AFFINITY_NONE If the \p srv is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN enum sg_httpsrv_affinity sg_httpsrv_thr_affinity(struct sg_httpsrv *srv);
+
 /**
  * Sets the inactivity time to a client get time out.
  * \param[in] srv Server handle.
@@ -1094,6 +1691,9 @@ SG_EXTERN unsigned int sg_httpsrv_con_timeout(struct sg_httpsrv *srv);
  * \param[in] limit Concurrent connections limit.
  * \retval 0 - Success.
  * \retval EINVAL - Invalid argument.
+ * \note The limit applies to each listener, so a server listening on several ports or sockets accepts up to the
+ * limit times the number of listeners. In a listener served by the thread pool, it is split between the threads
+ * (at least one connection per thread), like the pools of libmicrohttpd.
  */
 SG_EXTERN int sg_httpsrv_set_con_limit(struct sg_httpsrv *srv, unsigned int limit);
 
@@ -1105,6 +1705,232 @@ SG_EXTERN int sg_httpsrv_set_con_limit(struct sg_httpsrv *srv, unsigned int limi
  */
 SG_EXTERN unsigned int sg_httpsrv_con_limit(struct sg_httpsrv *srv);
 
+/**
+ * Sets the size of the memory pool of each connection, used by the HTTP engine to parse the request line and headers
+ * and to buffer the connection I/O. Requests whose headers do not fit in the pool are rejected with `431` or `413`,
+ * thus the limit also bounds the memory a client can consume by sending large headers.
+ * \param[in] srv Server handle.
+ * \param[in] limit Memory pool size (in bytes), or `0` to use the libmicrohttpd default (~32 kB).
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ */
+SG_EXTERN int sg_httpsrv_set_con_mem_limit(struct sg_httpsrv *srv, size_t limit);
+
+/**
+ * Gets the size of the memory pool of each connection.
+ * \param[in] srv Server handle.
+ * \return Memory pool size (in bytes), or `0` if the libmicrohttpd default is used.
+ * \retval 0 If the \p srv is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN size_t sg_httpsrv_con_mem_limit(struct sg_httpsrv *srv);
+
+/**
+ * Sets the size by which the read buffer of a connection grows in its memory pool. Smaller increments leave more
+ * room in the pool for the headers and reduce the memory of idle connections.
+ * \param[in] srv Server handle.
+ * \param[in] increment Buffer increment (in bytes), lesser than the memory pool size (otherwise the server fails
+ * to listen), or `0` to use the libmicrohttpd default (~1 kB).
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ */
+SG_EXTERN int sg_httpsrv_set_con_mem_increment(struct sg_httpsrv *srv, size_t increment);
+
+/**
+ * Gets the size by which the read buffer of a connection grows in its memory pool.
+ * \param[in] srv Server handle.
+ * \return Buffer increment (in bytes), or `0` if the libmicrohttpd default is used.
+ * \retval 0 If the \p srv is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN size_t sg_httpsrv_con_mem_increment(struct sg_httpsrv *srv);
+
+/**
+ * Sets the limit of memory used by the library to store each request, i.e. its payload, fields and the maps of
+ * headers, cookies and parameters. Requests that exceed the limit while receiving the payload are aborted.
+ * \param[in] srv Server handle.
+ * \param[in] limit Request memory limit (in bytes), or `0` for no limit (default).
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note The maps of headers, cookies and parameters are created on demand and only accounted, since their size is
+ * already bounded by #sg_httpsrv_set_con_mem_limit().
+ */
+SG_EXTERN int sg_httpsrv_set_req_mem_limit(struct sg_httpsrv *srv, size_t limit);
+
+/**
+ * Gets the limit of memory used by the library to store each request.
+ * \param[in] srv Server handle.
+ * \return Request memory limit (in bytes).
+ * \retval 0 If the \p srv is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN size_t sg_httpsrv_req_mem_limit(struct sg_httpsrv *srv);
+
+/**
+ * Sets an already bound and listening socket to be used by the server instead of binding a new one, e.g. a socket
+ * inherited by #sg_inherited_fd().
+ * \param[in] srv Server handle.
+ * \param[in] fd Listening socket, or `-1` to bind a new socket (default).
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note The server takes the ownership of the socket when it starts listening, closing it when it is stopped.
+ */
+SG_EXTERN int sg_httpsrv_set_listen_fd(struct sg_httpsrv *srv, int fd);
+
+/**
+ * Gets the server listening socket.
+ * \param[in] srv Server handle.
+ * \return Socket the server is listening on, or the socket set by #sg_httpsrv_set_listen_fd() if the server is not
+ * listening yet.
+ * \retval -1 If the \p srv is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN int sg_httpsrv_listen_fd(struct sg_httpsrv *srv);
+
+/**
+ * Sets a socket option to be applied by the server, e.g. enabling `TCP_NODELAY` for short request/response
+ * latency or enlarging `SO_SNDBUF` for bulk downloads.
+ * \param[in] srv Server handle.
+ * \param[in] opt Socket option.
+ * \param[in] val Option value, or `-1` to keep the system default (default).
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note The options are used by the listeners started after this call. Client socket options are applied in a
+ * best-effort way, ignoring the ones unsupported by the socket family or platform.
+ */
+SG_EXTERN int sg_httpsrv_set_sockopt(struct sg_httpsrv *srv, enum sg_httpsrv_sockopt opt, int val);
+
+/**
+ * Gets a socket option set by #sg_httpsrv_set_sockopt().
+ * \param[in] srv Server handle.
+ * \param[in] opt Socket option.
+ * \return Option value, or `-1` if the system default is used.
+ * \retval -1 If the \p srv is null or \p opt is invalid and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN int sg_httpsrv_sockopt(struct sg_httpsrv *srv, enum sg_httpsrv_sockopt opt);
+
+/**
+ * Sets a callback to handle each client socket accepted by the server, called after applying the socket options.
+ * \param[in] srv Server handle.
+ * \param[in] cb Callback to handle the accepted sockets, or `NULL` to remove it.
+ * \param[in] cls User-defined closure.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \warning The callback is called from the server threads and must not close the socket.
+ */
+SG_EXTERN int sg_httpsrv_set_accept_cb(struct sg_httpsrv *srv, sg_httpsrv_accept_cb cb, void *cls);
+
+/**
+ * Sets a callback to handle the server errors as structured records, called instead of the error callback passed to
+ * #sg_httpsrv_new2(). The error messages are formatted in a stack buffer (truncated to 511 characters), so reporting
+ * an error does not allocate memory.
+ * \param[in] srv Server handle.
+ * \param[in] cb Callback to handle the errors, or `NULL` to restore the error callback passed to #sg_httpsrv_new2().
+ * \param[in] cls User-defined closure.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \warning The callback is called from the server threads.
+ */
+SG_EXTERN int sg_httpsrv_set_err_cb(struct sg_httpsrv *srv, sg_httpsrv_err_cb cb, void *cls);
+
+/**
+ * Server statistics, accumulated since the server was created.
+ */
+struct sg_httpsrv_stats {
+    /** Requests received. */
+    uint64_t reqs;
+    /** Bytes of request payloads received. */
+    uint64_t bytes_in;
+    /** Bytes of response bodies sent (streams of unknown size are not counted). */
+    uint64_t bytes_out;
+    /** Responses sent per status class, from `status[0]` for 1xx to `status[4]` for 5xx. */
+    uint64_t status[5];
+    /** Connections accepted. */
+    uint64_t cons_opened;
+    /** Connections closed. */
+    uint64_t cons_closed;
+    /** Connections currently active. */
+    uint64_t cons_active;
+    /** Files uploaded. */
+    uint64_t uplds;
+    /** Bytes of files uploaded. */
+    uint64_t uplds_bytes;
+    /** Access log records dropped because the log buffer of a server thread was full. */
+    uint64_t log_dropped;
+};
+
+/**
+ * Takes a snapshot of the server statistics. The counters are kept per server thread, without locking, and merged on
+ * each call.
+ * \param[in] srv Server handle.
+ * \param[out] stats Statistics snapshot.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note While the server is running, the snapshot may miss the counters being updated at the time of the call.
+ */
+SG_EXTERN int sg_httpsrv_stats(struct sg_httpsrv *srv, struct sg_httpsrv_stats *stats);
+
+/**
+ * Gets a quantile of the latencies measured for a request phase, e.g. `0.5`, `0.99` and `0.999` for the p50, p99 and
+ * p999 latencies. The latencies are recorded in log-bucketed histograms kept per server thread, merged on each call.
+ * \param[in] srv Server handle.
+ * \param[in] phase Request phase.
+ * \param[in] q Quantile between `0` and `1`.
+ * \return Latency (in microseconds), rounded up to the histogram resolution (12.5%), or `0` if no latency was
+ * recorded.
+ * \retval 0 If any argument is invalid and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN uint64_t sg_httpsrv_lat_quantile(struct sg_httpsrv *srv, enum sg_httpsrv_phase phase, double q);
+
+/**
+ * Sets a path in which the server exposes its statistics and latency histograms in the Prometheus text format. The
+ * `GET` and `HEAD` requests to this path are answered by the library instead of the request callback, but are still
+ * checked by the authentication callback.
+ * \param[in] srv Server handle.
+ * \param[in] path Metrics path, e.g. `"/metrics"`, or `NULL` to disable the metrics exposition (default).
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ */
+SG_EXTERN int sg_httpsrv_set_metrics_path(struct sg_httpsrv *srv, const char *path);
+
+/**
+ * Gets the path in which the server exposes its metrics.
+ * \param[in] srv Server handle.
+ * \return Metrics path, or `NULL` if the metrics exposition is disabled.
+ * \retval NULL If the \p srv is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN const char *sg_httpsrv_metrics_path(struct sg_httpsrv *srv);
+
+/**
+ * Sets a file in which the server logs the completed requests. The records are formatted into buffers kept per server
+ * thread and appended to the file in batches by a background thread, so the logging does not block the requests.
+ * \param[in] srv Server handle.
+ * \param[in] path Log file path, or `NULL` to disable the access log (default).
+ * \param[in] fmt Log format.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note The file is opened when the server starts listening, thus a change while it is listening takes effect after
+ * the next #sg_httpsrv_shutdown() and listen.
+ * \note In threaded mode each connection has a buffer while it is open, released after the records it left are
+ * written.
+ * \warning A record is dropped (and counted in the statistics) if the buffer of its thread is full.
+ */
+SG_EXTERN int sg_httpsrv_set_access_log(struct sg_httpsrv *srv, const char *path, enum sg_httpsrv_log_fmt fmt);
+
+/**
+ * Gets the file in which the server logs the completed requests.
+ * \param[in] srv Server handle.
+ * \return Log file path, or `NULL` if the access log is disabled.
+ * \retval NULL If the \p srv is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN const char *sg_httpsrv_access_log(struct sg_httpsrv *srv);
+
+/**
+ * Requests the access log file to be reopened, allowing to rotate it, e.g. by calling it from a `SIGHUP` handler
+ * after renaming the file.
+ * \param[in] srv Server handle.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \note It is async-signal-safe: the file is reopened by the background thread on its next batch.
+ */
+SG_EXTERN int sg_httpsrv_reopen_access_log(struct sg_httpsrv *srv);
+
 /**
  * Returns a value to end a stream reading processed by #sg_httpres_sendstream().
  * \param[in] err `true` to return a value indicating a stream reading error.
@@ -1112,6 +1938,235 @@ SG_EXTERN unsigned int sg_httpsrv_con_limit(struct sg_httpsrv *srv);
  */
 SG_EXTERN ssize_t sg_httpread_end(bool err);
 
+/**
+ * Returns the canonical name of a well-known header, e.g. `"Content-Type"` for #SG_HDR_CONTENT_TYPE.
+ * \param[in] id Header identifier.
+ * \return Header name.
+ * \retval NULL If \p id is invalid and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN const char *sg_hdr_name(enum sg_hdr id);
+
+/** \} */
+
+/**
+ * \ingroup sg_api
+ * \defgroup sg_router Router
+ * Router handle and its related functions.
+ * \{
+ */
+
+/**
+ * Handle for the request router. It matches the method and path of the requests against route patterns compiled
+ * into a radix tree, calling the handler of the matched route.
+ * \struct sg_router
+ */
+struct sg_router;
+
+/**
+ * Handle for the route matched by a request, including the values of its parameters. It is only valid inside the
+ * route callback.
+ * \struct sg_route
+ */
+struct sg_route;
+
+/**
+ * Callback signature used to handle the requests matching a route.
+ * \param[out] cls User-defined closure.
+ * \param[out] route Matched route handle.
+ * \param[out] req Request handle.
+ * \param[out] res Response handle.
+ */
+typedef void (*sg_route_cb)(void *cls, struct sg_route *route, struct sg_httpreq *req, struct sg_httpres *res);
+
+/**
+ * Creates a new router handle.
+ * \return New router handle.
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN struct sg_router *sg_router_new(void);
+
+/**
+ * Frees the router handle previously allocated by #sg_router_new().
+ * \param[in] router Router handle.
+ */
+SG_EXTERN void sg_router_free(struct sg_router *router);
+
+/**
+ * Adds a route to the router. The pattern is a path whose segments can be parameters, like `:id` in `/users/:id`,
+ * matching any non-empty segment, or a last wildcard segment, like `*path`, matching the rest of the path. Static
+ * segments take precedence over parameters, and parameters over wildcards.
+ * \param[in] router Router handle.
+ * \param[in] method Standard HTTP method, e.g. `"GET"`, or `NULL` to handle any method not added to the pattern.
+ * \param[in] pattern Route pattern, starting with `/`. Parameter names are made of letters, digits and underscores.
+ * \param[in] cb Callback to handle the requests matching the route.
+ * \param[in] cls User-defined closure.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument, invalid pattern, more than 16 parameters, or a parameter named differently in
+ * another route at the same position.
+ * \retval EEXIST - Route already added for the method.
+ * \retval EALREADY - Router already compiled.
+ * \note `HEAD` requests are handled by the `GET` route if no `HEAD` route is added.
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN int sg_router_add(struct sg_router *router, const char *method, const char *pattern, sg_route_cb cb,
+                            void *cls);
+
+/**
+ * Compiles the added routes into a compact read-only tree, allowing to dispatch requests from any thread.
+ * \param[in] router Router handle.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \retval EALREADY - Router already compiled.
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN int sg_router_compile(struct sg_router *router);
+
+/**
+ * Dispatches a request to the handler of the route matching its method and path, usually called from the server
+ * request callback.
+ * \param[in] router Router handle.
+ * \param[in] req Request handle.
+ * \param[in] res Response handle.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument, or router not compiled.
+ * \retval ENOENT - No route matches the path, e.g. to send a 404 response.
+ * \retval ENOTSUP - A route matches the path, but not the method, e.g. to send a 405 response.
+ * \note It doesn't allocate memory.
+ */
+SG_EXTERN int sg_router_dispatch(struct sg_router *router, struct sg_httpreq *req, struct sg_httpres *res);
+
+/**
+ * Returns the pattern of the matched route.
+ * \param[in] route Route handle.
+ * \return Route pattern as null-terminated string.
+ * \retval NULL If \p route is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN const char *sg_route_pattern(struct sg_route *route);
+
+/**
+ * Gets the value of a parameter of the matched route.
+ * \param[in] route Route handle.
+ * \param[in] name Parameter name, without the `:` or `*` prefix.
+ * \param[out] len Pointer to store the value length.
+ * \return Parameter value, pointing to the request path, therefore it is not null-terminated.
+ * \retval NULL If the parameter is not found, or if \p route, \p name or \p len is null and sets the `errno` to
+ * `EINVAL`.
+ */
+SG_EXTERN const char *sg_route_param(struct sg_route *route, const char *name, size_t *len);
+
+/** \} */
+
+/**
+ * \ingroup sg_api
+ * \defgroup sg_httpvhost Virtual hosts
+ * Virtual host handle and its related functions.
+ * \{
+ */
+
+/**
+ * Handle for a virtual host, which serves the requests whose Host header matches its name with its own handler,
+ * router and limits, allowing to serve several sites or tenants in the same server.
+ * \struct sg_httpvhost
+ */
+struct sg_httpvhost;
+
+/**
+ * Adds a virtual host to the server. The requests not matching any virtual host are handled by the server callback.
+ * \param[in] srv Server handle.
+ * \param[in] host Host name without port, e.g. `"example.com"`, or a wildcard like `"*.example.com"`, matching any
+ * subdomain of `example.com` (but not `example.com` itself). Names are matched ignoring their case, and the most
+ * specific wildcard wins.
+ * \param[in] cb Callback to handle the requests of the virtual host, or those not matching its router.
+ * \param[in] cls User-defined closure.
+ * \return New virtual host handle, freed along with the server. It starts with the server upload directory and limits.
+ * \retval NULL If \p srv, \p host or \p cb is null or \p host is invalid and sets the `errno` to `EINVAL`, if
+ * \p host was already added and sets the `errno` to `EEXIST`, or if the server is listening and sets the `errno` to
+ * `EALREADY`.
+ * \note The host is resolved once per request, from the raw Host header, before calling the authentication callback.
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN struct sg_httpvhost *sg_httpsrv_add_vhost(struct sg_httpsrv *srv, const char *host, sg_httpreq_cb cb,
+                                                    void *cls);
+
+/**
+ * Sets a router to dispatch the requests of the virtual host. Requests not matching any route are handled by the
+ * virtual host callback.
+ * \param[in] vhost Virtual host handle.
+ * \param[in] router Compiled router handle, or `NULL` to disable the routing.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument, or router not compiled.
+ * \note The router is not freed along with the server.
+ */
+SG_EXTERN int sg_httpvhost_set_router(struct sg_httpvhost *vhost, struct sg_router *router);
+
+/**
+ * Gets the router of the virtual host.
+ * \param[in] vhost Virtual host handle.
+ * \return Router handle, or `NULL` if the routing is disabled.
+ * \retval NULL If \p vhost is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN struct sg_router *sg_httpvhost_router(struct sg_httpvhost *vhost);
+
+/**
+ * Sets the directory to save the uploaded files of the virtual host.
+ * \param[in] vhost Virtual host handle.
+ * \param[in] dir Directory as null-terminated string.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ * \warning It exits the application if called when no memory space is available.
+ */
+SG_EXTERN int sg_httpvhost_set_upld_dir(struct sg_httpvhost *vhost, const char *dir);
+
+/**
+ * Gets the directory of the uploaded files of the virtual host.
+ * \param[in] vhost Virtual host handle.
+ * \return Directory as null-terminated string.
+ * \retval NULL If \p vhost is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN const char *sg_httpvhost_upld_dir(struct sg_httpvhost *vhost);
+
+/**
+ * Sets the limit of the total payload of the requests of the virtual host.
+ * \param[in] vhost Virtual host handle.
+ * \param[in] limit Payload total limit. Use `0` for no limit.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ */
+SG_EXTERN int sg_httpvhost_set_payld_limit(struct sg_httpvhost *vhost, size_t limit);
+
+/**
+ * Gets the limit of the total payload of the requests of the virtual host.
+ * \param[in] vhost Virtual host handle.
+ * \return Payload total limit.
+ * \retval 0 If \p vhost is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN size_t sg_httpvhost_payld_limit(struct sg_httpvhost *vhost);
+
+/**
+ * Sets the limit of the total uploads of the requests of the virtual host.
+ * \param[in] vhost Virtual host handle.
+ * \param[in] limit Uploads total limit. Use `0` for no limit.
+ * \retval 0 - Success.
+ * \retval EINVAL - Invalid argument.
+ */
+SG_EXTERN int sg_httpvhost_set_uplds_limit(struct sg_httpvhost *vhost, uint64_t limit);
+
+/**
+ * Gets the limit of the total uploads of the requests of the virtual host.
+ * \param[in] vhost Virtual host handle.
+ * \return Uploads total limit.
+ * \retval 0 If \p vhost is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN uint64_t sg_httpvhost_uplds_limit(struct sg_httpvhost *vhost);
+
+/**
+ * Gets the virtual host of the request, e.g. to identify the tenant in the authentication callback.
+ * \param[in] req Request handle.
+ * \return Virtual host handle, or `NULL` if the request is handled by the server callback.
+ * \retval NULL If \p req is null and sets the `errno` to `EINVAL`.
+ */
+SG_EXTERN struct sg_httpvhost *sg_httpreq_vhost(struct sg_httpreq *req);
+
 /** \} */
 
 #ifdef __cplusplus
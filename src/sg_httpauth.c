@@ -32,8 +32,10 @@
 #include "sg_macros.h"
 #include "microhttpd.h"
 #include "sagui.h"
+#include "sg_utils.h"
 #include "sg_httputils.h"
 #include "sg_strmap.h"
+#include "sg_httpsrv.h"
 #include "sg_httpauth.h"
 
 struct sg_httpauth *sg__httpauth_new(struct sg_httpres *res) {
@@ -47,8 +49,9 @@ struct sg_httpauth *sg__httpauth_new(struct sg_httpres *res) {
 void sg__httpauth_free(struct sg_httpauth *auth) {
     if (!auth)
         return;
-    sg__free(auth->usr);
-    sg__free(auth->pwd);
+    /* the credentials are allocated by libmicrohttpd, so they are not freed by the library allocator. */
+    free(auth->usr);
+    free(auth->pwd);
     sg__free(auth->realm);
     sg__free(auth);
 }
@@ -62,9 +65,13 @@ bool sg__httpauth_dispatch(struct sg_httpauth *auth) {
         auth->res->ret = MHD_NO;
         goto done;
     }
-    sg_strmap_iter(auth->res->headers, sg__httpheaders_iter, auth->res->handle);
+    sg__httpres_add_headers(auth->res);
     auth->res->ret = MHD_queue_basic_auth_fail_response(auth->res->con, auth->realm ? auth->realm : _("Sagui realm"),
                                                         auth->res->handle);
+    if (auth->res->slot && (auth->res->ret == MHD_YES)) {
+        auth->res->slot->stats.bytes_out += auth->res->size;
+        auth->res->slot->stats.status[3]++; /* 401 Unauthorized */
+    }
     return false;
 done:
     return auth->res->ret == MHD_YES;
@@ -75,7 +82,7 @@ int sg_httpauth_set_realm(struct sg_httpauth *auth, const char *realm) {
         return EINVAL;
     if (auth->realm)
         return EALREADY;
-    if (!(auth->realm = strdup(realm)))
+    if (!(auth->realm = sg__strdup(realm)))
         oom();
     return 0;
 }
@@ -0,0 +1,340 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+#include "sg_macros.h"
+#include "microhttpd.h"
+#include "sagui.h"
+#include "sg_utils.h"
+#include "sg_httpauth.h"
+#include "sg_httpreq.h"
+#include "sg_httpsrv.h"
+#include "sg_httplog.h"
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+static int sg__httplog_open(const char *path) {
+    return open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+static void sg__httplog_time(struct sg__httplog_ring *ring) {
+    static const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    struct tm tm;
+    time_t now = time(NULL);
+    size_t len;
+    if (now == ring->time)
+        return;
+    ring->time = now;
+#ifdef _WIN32
+    gmtime_s(&tm, &now);
+#else
+    gmtime_r(&now, &tm);
+#endif
+    /* the month is not taken from `%b`, which depends on the locale. */
+    len = strftime(ring->clf_time, sizeof(ring->clf_time), "%d/", &tm);
+    memcpy(ring->clf_time + len, months[tm.tm_mon], 3);
+    strftime(ring->clf_time + len + 3, sizeof(ring->clf_time) - len - 3, "/%Y:%H:%M:%S +0000", &tm);
+    strftime(ring->iso_time, sizeof(ring->iso_time), "%Y-%m-%dT%H:%M:%SZ", &tm);
+}
+
+static const char *sg__httplog_addr(struct MHD_Connection *con, char *buf, size_t size) {
+    const union MHD_ConnectionInfo *info;
+    const struct sockaddr *sa;
+    if (!con || !(info = MHD_get_connection_info(con, MHD_CONNECTION_INFO_CLIENT_ADDRESS)) ||
+        !(sa = info->client_addr))
+        return NULL;
+    if (sa->sa_family == AF_INET)
+        return inet_ntop(AF_INET, (void *) &((const struct sockaddr_in *) sa)->sin_addr, buf, size);
+    if (sa->sa_family == AF_INET6)
+        return inet_ntop(AF_INET6, (void *) &((const struct sockaddr_in6 *) sa)->sin6_addr, buf, size);
+    return NULL;
+}
+
+/* appends a string to the record, truncating it on overflow (one byte is always kept for the line break). */
+static void sg__httplog_put(char *rec, size_t size, size_t *len, const char *str) {
+    size_t n = strlen(str);
+    if (n > (size - 1 - *len))
+        n = size - 1 - *len;
+    memcpy(rec + *len, str, n);
+    *len += n;
+}
+
+/* appends a string escaped as a JSON string or as a quoted CLF field, keeping the escape sequences whole. */
+static void sg__httplog_esc(char *rec, size_t size, size_t *len, const char *str, bool json) {
+    static const char hex[] = "0123456789abcdef";
+    unsigned char c;
+    char seq[6];
+    size_t n;
+    for (; (c = (unsigned char) *str); str++) {
+        if ((c == '"') || (c == '\\')) {
+            seq[0] = '\\';
+            seq[1] = (char) c;
+            n = 2;
+        } else if ((c < 0x20) || (!json && (c > 0x7e))) {
+            if (json) {
+                memcpy(seq, "\\u00", 4);
+                n = 6;
+            } else {
+                memcpy(seq, "\\x", 2);
+                n = 4;
+            }
+            seq[n - 2] = hex[c >> 4];
+            seq[n - 1] = hex[c & 0xf];
+        } else {
+            seq[0] = (char) c;
+            n = 1;
+        }
+        if (n > (size - 1 - *len))
+            break;
+        memcpy(rec + *len, seq, n);
+        *len += n;
+    }
+}
+
+size_t sg__httplog_format(enum sg_httpsrv_log_fmt fmt, struct sg__httplog_ring *ring, struct sg_httpreq *req,
+                          uint64_t duration, char *rec, size_t size) {
+#define SG__PUT(str) sg__httplog_put(rec, size, &len, (str))
+#define SG__ESC(str) sg__httplog_esc(rec, size, &len, (str), json)
+#define SG__OPT(str)                        \
+do {                                        \
+    if (str) {                              \
+        SG__PUT("\"");                      \
+        SG__ESC(str);                       \
+        SG__PUT("\"");                      \
+    } else                                  \
+        SG__PUT(json ? "null" : "\"-\"");   \
+} while (0)
+    char addr[INET6_ADDRSTRLEN], num[32];
+    const char *remote, *usr, *referer = NULL, *agent = NULL;
+    size_t len = 0;
+    bool json = (fmt == SG_HTTPSRV_LOG_JSON);
+    sg__httplog_time(ring);
+    remote = sg__httplog_addr(req->con, addr, sizeof(addr));
+    usr = req->auth ? req->auth->usr : NULL;
+    if (req->con && (fmt != SG_HTTPSRV_LOG_COMMON)) {
+        referer = sg_httpreq_header_id(req, SG_HDR_REFERER);
+        agent = sg_httpreq_header_id(req, SG_HDR_USER_AGENT);
+    }
+    if (json) {
+        SG__PUT("{\"time\":\"");
+        SG__PUT(ring->iso_time);
+        SG__PUT("\",\"remote\":");
+        SG__OPT(remote);
+        SG__PUT(",\"user\":");
+        SG__OPT(usr);
+        SG__PUT(",\"method\":\"");
+        SG__ESC(req->method);
+        SG__PUT("\",\"path\":\"");
+        SG__ESC(req->path);
+        SG__PUT("\",\"version\":\"");
+        SG__ESC(req->version);
+        snprintf(num, sizeof(num), "\",\"status\":%u", req->res->status);
+        SG__PUT(num);
+        snprintf(num, sizeof(num), ",\"bytes\":%llu", (unsigned long long) req->res->size);
+        SG__PUT(num);
+        SG__PUT(",\"referer\":");
+        SG__OPT(referer);
+        SG__PUT(",\"user_agent\":");
+        SG__OPT(agent);
+        snprintf(num, sizeof(num), ",\"duration_us\":%llu}", (unsigned long long) duration);
+        SG__PUT(num);
+    } else {
+        SG__PUT(remote ? remote : "-");
+        SG__PUT(" - ");
+        if (usr)
+            SG__ESC(usr);
+        else
+            SG__PUT("-");
+        SG__PUT(" [");
+        SG__PUT(ring->clf_time);
+        SG__PUT("] \"");
+        SG__ESC(req->method);
+        SG__PUT(" ");
+        SG__ESC(req->path);
+        SG__PUT(" ");
+        SG__ESC(req->version);
+        snprintf(num, sizeof(num), "\" %u ", req->res->status);
+        SG__PUT(num);
+        if (req->res->size > 0) {
+            snprintf(num, sizeof(num), "%llu", (unsigned long long) req->res->size);
+            SG__PUT(num);
+        } else
+            SG__PUT("-");
+        if (fmt == SG_HTTPSRV_LOG_COMBINED) {
+            SG__PUT(" ");
+            SG__OPT(referer);
+            SG__PUT(" ");
+            SG__OPT(agent);
+        }
+    }
+    rec[len++] = '\n';
+    return len;
+#undef SG__OPT
+#undef SG__ESC
+#undef SG__PUT
+}
+
+bool sg__httplog_push(struct sg__httplog_ring *ring, const char *rec, size_t len) {
+    size_t head = ring->head, off, n;
+    if (!ring->buf)
+        sg__alloc(ring->buf, SG__HTTPLOG_RING_SIZE);
+    if (len > (SG__HTTPLOG_RING_SIZE - (head - ring->tail))) {
+        ring->dropped++;
+        return false;
+    }
+    off = head & (SG__HTTPLOG_RING_SIZE - 1);
+    n = SG__HTTPLOG_RING_SIZE - off;
+    if (n > len)
+        n = len;
+    memcpy(ring->buf + off, rec, n);
+    memcpy(ring->buf, rec + n, len - n);
+    __sync_synchronize(); /* publishes the whole record before the flusher can reach it */
+    ring->head = head + len;
+    return true;
+}
+
+void sg__httplog_write(struct sg__httplog *log, struct sg__httplog_ring *ring, struct sg_httpreq *req,
+                       uint64_t duration) {
+    char rec[SG__HTTPLOG_REC_SIZE];
+    sg__httplog_push(ring, rec, sg__httplog_format(log->fmt, ring, req, duration, rec, sizeof(rec)));
+}
+
+static void sg__httplog_out(struct sg__httplog *log) {
+    size_t off = 0;
+    ssize_t ret;
+    while (off < log->batch_len) {
+        if ((ret = write(log->fd, log->batch + off, log->batch_len - off)) < 0) {
+            if (errno == EINTR)
+                continue;
+            break; /* the batch is discarded rather than blocking the rings */
+        }
+        off += (size_t) ret;
+    }
+    log->batch_len = 0;
+}
+
+static void sg__httplog_drain(struct sg__httplog *log, struct sg__httplog_ring *ring) {
+    size_t head = ring->head, tail = ring->tail, off, n;
+    __sync_synchronize(); /* pairs with the barrier of the producer */
+    while (tail != head) {
+        if (log->batch_len == SG__HTTPLOG_BATCH_SIZE)
+            sg__httplog_out(log);
+        off = tail & (SG__HTTPLOG_RING_SIZE - 1);
+        n = head - tail;
+        if (n > (SG__HTTPLOG_RING_SIZE - off))
+            n = SG__HTTPLOG_RING_SIZE - off;
+        if (n > (SG__HTTPLOG_BATCH_SIZE - log->batch_len))
+            n = SG__HTTPLOG_BATCH_SIZE - log->batch_len;
+        memcpy(log->batch + log->batch_len, ring->buf + off, n);
+        log->batch_len += n;
+        tail += n;
+        __sync_synchronize(); /* frees the space only after it was copied */
+        ring->tail = tail;
+    }
+}
+
+void sg__httplog_flush(struct sg__httplog *log) {
+    struct sg__httpsrv_slot *slot;
+    int fd;
+    if (log->reopen) {
+        log->reopen = 0;
+        if ((fd = sg__httplog_open(log->path)) != -1) {
+            close(log->fd);
+            log->fd = fd;
+        }
+    }
+    for (slot = log->srv->slots; slot; slot = slot->next)
+        sg__httplog_drain(log, &slot->log);
+    if (log->batch_len > 0)
+        sg__httplog_out(log);
+    /* releases the drained rings of the slots no thread holds (e.g. of the closed connections in threaded mode), so
+     * idle slots do not keep a ring each. They are allocated again by the next push. */
+    sg__spin_lock(&log->srv->slots_lock);
+    for (slot = log->srv->free_slots; slot; slot = slot->next_free)
+        if (slot->log.buf && (slot->log.head == slot->log.tail)) {
+            sg__free(slot->log.buf);
+            slot->log.buf = NULL;
+        }
+    sg__spin_unlock(&log->srv->slots_lock);
+}
+
+static void *sg__httplog_loop(void *cls) {
+    struct sg__httplog *log = cls;
+    while (!log->stop) {
+        sg__httplog_flush(log);
+        sg__usleep(SG__HTTPLOG_INTERVAL);
+    }
+    return NULL;
+}
+
+struct sg__httplog *sg__httplog_new(struct sg_httpsrv *srv, const char *path, enum sg_httpsrv_log_fmt fmt) {
+    struct sg__httplog *log;
+    int errnum;
+    sg__new(log);
+    if ((log->fd = sg__httplog_open(path)) == -1) {
+        errnum = errno;
+        sg__free(log);
+        errno = errnum;
+        return NULL;
+    }
+    if (!(log->path = sg__strdup(path)))
+        oom();
+    sg__alloc(log->batch, SG__HTTPLOG_BATCH_SIZE);
+    log->srv = srv;
+    log->fmt = fmt;
+    if ((errnum = pthread_create(&log->thread, NULL, sg__httplog_loop, log)) != 0) {
+        close(log->fd);
+        sg__free(log->batch);
+        sg__free(log->path);
+        sg__free(log);
+        errno = errnum;
+        return NULL;
+    }
+    return log;
+}
+
+void sg__httplog_free(struct sg__httplog *log) {
+    if (!log)
+        return;
+    log->stop = 1;
+    pthread_join(log->thread, NULL);
+    sg__httplog_flush(log); /* writes the records left after the last iteration */
+    close(log->fd);
+    sg__free(log->batch);
+    sg__free(log->path);
+    sg__free(log);
+}
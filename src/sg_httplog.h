@@ -0,0 +1,89 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SG_HTTPLOG_H
+#define SG_HTTPLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include "sg_macros.h"
+#include "microhttpd.h"
+#include "sagui.h"
+
+#define SG__HTTPLOG_RING_SIZE 65536 /* ~64 kB, must be a power of two */
+
+#define SG__HTTPLOG_BATCH_SIZE 262144 /* ~256 kB */
+
+#define SG__HTTPLOG_REC_SIZE 2048 /* ~2 kB */
+
+#define SG__HTTPLOG_INTERVAL 100000 /* ~100 ms */
+
+struct sg_httpsrv;
+struct sg_httpreq;
+
+/* log records of a server thread, written by it and consumed by the flusher thread without locking. */
+struct sg__httplog_ring {
+    char *buf;
+    volatile size_t head;
+    volatile size_t tail;
+    uint64_t dropped;
+    time_t time;
+    char clf_time[32];
+    char iso_time[32];
+};
+
+struct sg__httplog {
+    struct sg_httpsrv *srv;
+    char *path;
+    char *batch;
+    size_t batch_len;
+    pthread_t thread;
+    enum sg_httpsrv_log_fmt fmt;
+    int fd;
+    volatile sig_atomic_t reopen;
+    volatile int stop;
+};
+
+SG__EXTERN struct sg__httplog *sg__httplog_new(struct sg_httpsrv *srv, const char *path,
+                                               enum sg_httpsrv_log_fmt fmt);
+
+SG__EXTERN void sg__httplog_free(struct sg__httplog *log);
+
+SG__EXTERN size_t sg__httplog_format(enum sg_httpsrv_log_fmt fmt, struct sg__httplog_ring *ring,
+                                     struct sg_httpreq *req, uint64_t duration, char *rec, size_t size);
+
+SG__EXTERN bool sg__httplog_push(struct sg__httplog_ring *ring, const char *rec, size_t len);
+
+SG__EXTERN void sg__httplog_write(struct sg__httplog *log, struct sg__httplog_ring *ring, struct sg_httpreq *req,
+                                  uint64_t duration);
+
+SG__EXTERN void sg__httplog_flush(struct sg__httplog *log);
+
+#endif /* SG_HTTPLOG_H */
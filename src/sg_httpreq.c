@@ -70,8 +70,10 @@ struct sg_strmap **sg_httpreq_headers(struct sg_httpreq *req) {
         errno = EINVAL;
         return NULL;
     }
-    if (!req->headers)
+    if (!req->headers) {
         MHD_get_connection_values(req->con, MHD_HEADER_KIND, sg__httpcon_iter, &req->headers);
+        req->mem_size += sg__strmap_mem_size(req->headers);
+    }
     return &req->headers;
 }
 
@@ -80,8 +82,10 @@ struct sg_strmap **sg_httpreq_cookies(struct sg_httpreq *req) {
         errno = EINVAL;
         return NULL;
     }
-    if (!req->cookies)
+    if (!req->cookies) {
         MHD_get_connection_values(req->con, MHD_COOKIE_KIND, sg__httpcon_iter, &req->cookies);
+        req->mem_size += sg__strmap_mem_size(req->cookies);
+    }
     return &req->cookies;
 }
 
@@ -90,11 +94,56 @@ struct sg_strmap **sg_httpreq_params(struct sg_httpreq *req) {
         errno = EINVAL;
         return NULL;
     }
-    if (!req->params)
+    if (!req->params) {
         MHD_get_connection_values(req->con, MHD_GET_ARGUMENT_KIND, sg__httpcon_iter, &req->params);
+        req->mem_size += sg__strmap_mem_size(req->params);
+    }
     return &req->params;
 }
 
+/* looks up a value in its map if the user has already built it (and maybe changed it), or directly in the values
+ * parsed by MHD otherwise. */
+static const char *sg__httpreq_lookup(struct sg_httpreq *req, struct sg_strmap *map, enum MHD_ValueKind kind,
+                                      const char *name) {
+    if (!req || !name) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return map ? sg_strmap_get(map, name) : MHD_lookup_connection_value(req->con, kind, name);
+}
+
+const char *sg_httpreq_header(struct sg_httpreq *req, const char *name) {
+    return sg__httpreq_lookup(req, req ? req->headers : NULL, MHD_HEADER_KIND, name);
+}
+
+const char *sg_httpreq_cookie(struct sg_httpreq *req, const char *name) {
+    return sg__httpreq_lookup(req, req ? req->cookies : NULL, MHD_COOKIE_KIND, name);
+}
+
+const char *sg_httpreq_param(struct sg_httpreq *req, const char *name) {
+    return sg__httpreq_lookup(req, req ? req->params : NULL, MHD_GET_ARGUMENT_KIND, name);
+}
+
+static int sg__httpreq_hdrs_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind, const char *key, const char *val) {
+    struct sg_httpreq *req = cls;
+    int id;
+    if (key && ((id = sg__hdr_id(key)) != -1) && !req->hdrs[id])
+        req->hdrs[id] = val;
+    return MHD_YES;
+}
+
+const char *sg_httpreq_header_id(struct sg_httpreq *req, enum sg_hdr id) {
+    if (!req || ((int) id < 0) || ((int) id >= SG__HDRS)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!req->hdrs_indexed) {
+        MHD_get_connection_values(req->con, MHD_HEADER_KIND, sg__httpreq_hdrs_iter, req);
+        req->hdrs_indexed = true;
+    }
+    return req->hdrs[id];
+}
+
 struct sg_strmap **sg_httpreq_fields(struct sg_httpreq *req) {
     if (!req) {
         errno = EINVAL;
@@ -143,6 +192,14 @@ bool sg_httpreq_is_uploading(struct sg_httpreq *req) {
     return req->is_uploading;
 }
 
+size_t sg_httpreq_mem_size(struct sg_httpreq *req) {
+    if (!req) {
+        errno = EINVAL;
+        return 0;
+    }
+    return req->mem_size;
+}
+
 struct sg_httpupld *sg_httpreq_uploads(struct sg_httpreq *req) {
     if (!req) {
         errno = EINVAL;
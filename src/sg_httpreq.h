@@ -34,6 +34,7 @@
 #include "sagui.h"
 #include "sg_httpuplds.h"
 #include "sg_httpres.h"
+#include "sg_httputils.h"
 
 struct sg_httpreq {
     struct MHD_Connection *con;
@@ -48,13 +49,21 @@ struct sg_httpreq {
     struct sg_strmap *params;
     struct sg_strmap *fields;
     struct sg_str *payload;
+    struct sg__httpsrv_slot *slot;
+    struct sg__httpsrv_metrics *metrics; /* scrape buffer sent by the response, if the metrics were requested */
+    struct sg_httpvhost *vhost; /* resolved from the Host header when the request is created */
     const char *version;
     const char *method;
     const char *path;
+    const char *hdrs[SG__HDRS]; /* well-known headers, indexed on demand */
     void *user_data;
     uint64_t total_uplds_size;
+    uint64_t started;
+    uint64_t queued;
     size_t total_fields_size;
+    size_t mem_size;
     bool is_uploading;
+    bool hdrs_indexed;
 };
 
 SG__EXTERN struct sg_httpreq *sg__httpreq_new(struct MHD_Connection *con, const char *version, const char *method,
@@ -37,6 +37,8 @@
 #include "sg_utils.h"
 #include "sg_strmap.h"
 #include "sg_httputils.h"
+#include "sg_trace.h"
+#include "sg_httpsrv.h"
 #include "sg_httpres.h"
 
 static ssize_t sg__httpfileread_cb(void *handle, __SG_UNUSED uint64_t offset, char *buf, size_t size) {
@@ -60,16 +62,34 @@ struct sg_httpres *sg__httpres_new(struct MHD_Connection *con) {
 }
 
 void sg__httpres_free(struct sg_httpres *res) {
+    int i;
     if (!res)
         return;
     sg_strmap_cleanup(&res->headers);
+    sg_httphdrs_free(res->blk);
+    for (i = 0; i < SG__HDRS; i++)
+        sg__free(res->hdrs[i]);
     MHD_destroy_response(res->handle);
     sg__free(res);
 }
 
-int sg__httpres_dispatch(struct sg_httpres *res) {
+void sg__httpres_add_headers(struct sg_httpres *res) {
+    unsigned int i;
+    if (res->blk)
+        for (i = 0; i < res->blk->count; i++)
+            MHD_add_response_header(res->handle, res->blk->pairs[i * 2], res->blk->pairs[(i * 2) + 1]);
     sg_strmap_iter(res->headers, sg__httpheaders_iter, res->handle);
+    sg__hdrs_add(res->hdrs, res->handle);
+}
+
+int sg__httpres_dispatch(struct sg_httpres *res) {
+    sg__httpres_add_headers(res);
     res->ret = MHD_queue_response(res->con, res->status, res->handle);
+    sg__trace4(response__dispatch, res, res->status, res->size, res->ret);
+    if (res->slot && (res->ret == MHD_YES)) {
+        res->slot->stats.bytes_out += res->size;
+        res->slot->stats.status[(res->status / 100) - 1]++;
+    }
     return res->ret;
 }
 
@@ -95,20 +115,78 @@ int sg_httpres_set_cookie(struct sg_httpres *res, const char *name, const char *
     return ret;
 }
 
-int sg_httpres_sendbinary(struct sg_httpres *res, void *buf, size_t size, const char *content_type,
-                          unsigned int status) {
+int sg_httpres_set_header_id(struct sg_httpres *res, enum sg_hdr id, const char *val) {
+    char *dup = NULL;
+    if (!res || ((int) id < 0) || ((int) id >= SG__HDRS))
+        return EINVAL;
+    if (val && !(dup = sg__strdup(val)))
+        oom();
+    sg__free(res->hdrs[id]);
+    res->hdrs[id] = dup;
+    return 0;
+}
+
+int sg_httphdrs_new(struct sg_strmap *headers, struct sg_httphdrs **hdrs) {
+    struct sg_strmap *header;
+    size_t size = 0;
+    unsigned int i = 0;
+    char *str;
+    if (!hdrs)
+        return EINVAL;
+    for (header = headers; header; header = header->next) {
+        if (!sg__is_header_name(header->name) || !sg__is_header_val(header->val))
+            return EINVAL;
+        size += sizeof(char *) * 2 + header->len + header->val_len + 2;
+    }
+    sg__alloc(*hdrs, sizeof(struct sg_httphdrs) + size);
+    (*hdrs)->pairs = (const char **) (*hdrs + 1);
+    (*hdrs)->count = sg_strmap_count(headers);
+    (*hdrs)->refs = 1;
+    str = (char *) ((*hdrs)->pairs + ((*hdrs)->count * 2));
+    for (header = headers; header; header = header->next) {
+        (*hdrs)->pairs[i++] = memcpy(str, header->name, header->len + 1);
+        str += header->len + 1;
+        (*hdrs)->pairs[i++] = memcpy(str, header->val, header->val_len + 1);
+        str += header->val_len + 1;
+    }
+    return 0;
+}
+
+void sg_httphdrs_free(struct sg_httphdrs *hdrs) {
+    if (hdrs && (sg__atomic_sub(&hdrs->refs, 1) == 0))
+        sg__free(hdrs);
+}
+
+int sg_httpres_set_headers_block(struct sg_httpres *res, struct sg_httphdrs *hdrs) {
+    if (!res)
+        return EINVAL;
+    if (hdrs)
+        sg__atomic_add(&hdrs->refs, 1);
+    sg_httphdrs_free(res->blk);
+    res->blk = hdrs;
+    return 0;
+}
+
+int sg__httpres_sendbuf(struct sg_httpres *res, void *buf, size_t size, const char *content_type,
+                        unsigned int status, enum MHD_ResponseMemoryMode mode) {
     if (!res || !buf || ((ssize_t) size < 0) || !content_type || (status < 100) || (status > 599))
         return EINVAL;
     if (res->handle)
         return EALREADY;
-    if (!(res->handle = MHD_create_response_from_buffer(size, buf, MHD_RESPMEM_MUST_COPY)))
+    if (!(res->handle = MHD_create_response_from_buffer(size, buf, mode)))
         oom();
     if (strlen(content_type) > 0)
         sg_strmap_set(&res->headers, MHD_HTTP_HEADER_CONTENT_TYPE, content_type);
+    res->size = size;
     res->status = status;
     return 0;
 }
 
+int sg_httpres_sendbinary(struct sg_httpres *res, void *buf, size_t size, const char *content_type,
+                          unsigned int status) {
+    return sg__httpres_sendbuf(res, buf, size, content_type, status, MHD_RESPMEM_MUST_COPY);
+}
+
 int sg_httpres_sendfile(struct sg_httpres *res, size_t block_size, uint64_t max_size, const char *filename,
                         bool rendered, unsigned int status) {
     FILE *file;
@@ -170,11 +248,12 @@ int sg_httpres_sendfile(struct sg_httpres *res, size_t block_size, uint64_t max_
         errnum = ENOMEM;
         goto fail;
     }
-    sg__free(absolute_path);
+    free(absolute_path); /* allocated by `realpath()` */
+    res->size = (uint64_t) sbuf.st_size;
     res->status = status;
     return 0;
 fail:
-    sg__free(absolute_path);
+    free(absolute_path);
     if (file) {
         if (errnum == 0)
             errnum = fclose(file);
@@ -202,6 +281,7 @@ int sg_httpres_sendstream(struct sg_httpres *res, uint64_t size, size_t block_si
         errnum = ENOMEM;
         goto failed;
     }
+    res->size = size;
     res->status = status;
     return 0;
 failed:
@@ -32,11 +32,26 @@
 #include "sg_macros.h"
 #include "microhttpd.h"
 #include "sagui.h"
+#include "sg_httputils.h"
+
+struct sg__httpsrv_slot;
+
+/* validated headers stored in a single allocation: the block, the name and value of each header, then their
+ * strings. */
+struct sg_httphdrs {
+    const char **pairs;
+    unsigned int count;
+    unsigned int refs;
+};
 
 struct sg_httpres {
     struct MHD_Connection *con;
     struct MHD_Response *handle;
     struct sg_strmap *headers;
+    struct sg_httphdrs *blk; /* prebuilt headers shared by several responses */
+    char *hdrs[SG__HDRS]; /* well-known headers set by identifier */
+    struct sg__httpsrv_slot *slot;
+    uint64_t size;
     unsigned int status;
     int ret;
 };
@@ -45,6 +60,11 @@ SG__EXTERN struct sg_httpres *sg__httpres_new(struct MHD_Connection *con);
 
 SG__EXTERN void sg__httpres_free(struct sg_httpres *res);
 
+SG__EXTERN void sg__httpres_add_headers(struct sg_httpres *res);
+
 SG__EXTERN int sg__httpres_dispatch(struct sg_httpres *res);
 
+SG__EXTERN int sg__httpres_sendbuf(struct sg_httpres *res, void *buf, size_t size, const char *content_type,
+                                   unsigned int status, enum MHD_ResponseMemoryMode mode);
+
 #endif /* SG_HTTPRES_H */
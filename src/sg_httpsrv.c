@@ -29,88 +29,853 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
 #include "sg_macros.h"
+#include "utlist.h"
 #include "microhttpd.h"
 #include "sagui.h"
+#include "sg_utils.h"
+#include "sg_trace.h"
 #include "sg_httpsrv.h"
+#include "sg_httplog.h"
 #include "sg_httpauth.h"
 #include "sg_httpreq.h"
+#include "sg_httpvhost.h"
+
+/* statistics slot of the calling pool thread, set when the thread starts to update the counters without locking. */
+static sg__thread struct sg__httpsrv_slot *sg__httpsrv_thr_slot;
+
+static struct sg__httpsrv_slot *sg__httpsrv_slot_acquire(struct sg_httpsrv *srv) {
+    struct sg__httpsrv_slot *slot;
+    sg__spin_lock(&srv->slots_lock);
+    if ((slot = srv->free_slots)) {
+        srv->free_slots = slot->next_free;
+    } else {
+        sg__new(slot);
+        slot->next = srv->slots;
+        __sync_synchronize(); /* publishes the zeroed slot before the readers can reach it */
+        srv->slots = slot;
+    }
+    sg__spin_unlock(&srv->slots_lock);
+    return slot;
+}
+
+static void sg__httpsrv_slot_release(struct sg_httpsrv *srv, struct sg__httpsrv_slot *slot) {
+    sg__spin_lock(&srv->slots_lock);
+    slot->next_free = srv->free_slots;
+    srv->free_slots = slot;
+    sg__spin_unlock(&srv->slots_lock);
+}
+
+#ifdef __linux__
+
+/* reads the CPUs of a NUMA node allowed for the process, returning their count, or `-1` if the node does not exist. */
+static int sg__httpsrv_node_cpus(unsigned int node, const cpu_set_t *allowed, cpu_set_t *cpus) {
+    char path[64];
+    FILE *file;
+    unsigned int first, last;
+    int c, count = 0;
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+    if (!(file = fopen(path, "r")))
+        return -1;
+    CPU_ZERO(cpus);
+    /* the list is formatted as ranges, e.g. "0-7,16-23". */
+    while (fscanf(file, "%u", &first) == 1) {
+        last = first;
+        if ((c = fgetc(file)) == '-') {
+            if (fscanf(file, "%u", &last) != 1)
+                break;
+            c = fgetc(file);
+        }
+        for (; (first <= last) && (first < CPU_SETSIZE); first++)
+            if (CPU_ISSET(first, allowed)) {
+                CPU_SET(first, cpus);
+                count++;
+            }
+        if (c != ',')
+            break;
+    }
+    fclose(file);
+    return count;
+}
+
+/* orders the CPUs to be assigned to the threads, filling a node before the next one in the compact policy, or
+ * alternating the nodes in the scatter one. */
+static int sg__httpsrv_cpus_build(struct sg_httpsrv *srv) {
+    cpu_set_t allowed, nodes[SG__HTTPSRV_NODES];
+    int cursors[SG__HTTPSRV_NODES];
+    unsigned int node, node_count = 0, total = 0, i;
+    int count, cpu;
+    if ((srv->affinity == SG_HTTPSRV_AFFINITY_NONE) || srv->cpus)
+        return 0;
+    if (srv->affinity == SG_HTTPSRV_AFFINITY_LIST) {
+        if (!(srv->cpus = sg__malloc(srv->affinity_list_len * sizeof(unsigned int))))
+            return ENOMEM;
+        memcpy(srv->cpus, srv->affinity_list, srv->affinity_list_len * sizeof(unsigned int));
+        srv->cpus_len = srv->affinity_list_len;
+        return 0;
+    }
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return errno;
+    for (node = 0; node < SG__HTTPSRV_NODES; node++) {
+        if ((count = sg__httpsrv_node_cpus(node, &allowed, &nodes[node_count])) <= 0)
+            continue;
+        total += (unsigned int) count;
+        node_count++;
+    }
+    if (node_count == 0) {
+        /* no NUMA information (e.g. kernels without `CONFIG_NUMA`), handles all CPUs as a single node. */
+        memcpy(&nodes[0], &allowed, sizeof(allowed));
+        total = (unsigned int) CPU_COUNT(&allowed);
+        node_count = 1;
+    }
+    if (!(srv->cpus = sg__malloc(total * sizeof(unsigned int))))
+        return ENOMEM;
+    if (srv->affinity == SG_HTTPSRV_AFFINITY_COMPACT) {
+        for (i = 0; i < node_count; i++)
+            for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                if (CPU_ISSET(cpu, &nodes[i]))
+                    srv->cpus[srv->cpus_len++] = (unsigned int) cpu;
+        return 0;
+    }
+    memset(cursors, 0, sizeof(cursors));
+    while (srv->cpus_len < total)
+        for (i = 0; i < node_count; i++) {
+            while ((cursors[i] < CPU_SETSIZE) && !CPU_ISSET(cursors[i], &nodes[i]))
+                cursors[i]++;
+            if (cursors[i] < CPU_SETSIZE)
+                srv->cpus[srv->cpus_len++] = (unsigned int) cursors[i]++;
+        }
+    return 0;
+}
+
+/* pins the calling thread to a CPU of the affinity policy, in a best-effort way. */
+static void sg__httpsrv_thr_pin(struct sg_httpsrv *srv, unsigned int idx) {
+    cpu_set_t set;
+    if (srv->cpus_len == 0)
+        return;
+    CPU_ZERO(&set);
+    CPU_SET(srv->cpus[idx % srv->cpus_len], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+#else
+
+static int sg__httpsrv_cpus_build(__SG_UNUSED struct sg_httpsrv *srv) {
+    return 0;
+}
+
+static void sg__httpsrv_thr_pin(__SG_UNUSED struct sg_httpsrv *srv, __SG_UNUSED unsigned int idx) {
+}
+
+#endif
+
+static void sg__httpsrv_cpus_free(struct sg_httpsrv *srv) {
+    sg__free(srv->cpus);
+    srv->cpus = NULL;
+    srv->cpus_len = 0;
+}
+
+static void sg__httpsrv_slots_recycle(struct sg_httpsrv *srv) {
+    struct sg__httpsrv_slot *slot;
+    sg__spin_lock(&srv->slots_lock);
+    srv->free_slots = NULL;
+    for (slot = srv->slots; slot; slot = slot->next) {
+        slot->next_free = srv->free_slots;
+        srv->free_slots = slot;
+    }
+    sg__spin_unlock(&srv->slots_lock);
+}
+
+static unsigned int sg__httpsrv_lat_idx(uint64_t usec) {
+    unsigned int exp;
+    if (usec < (1 << SG__LAT_SUB_BITS))
+        return (unsigned int) usec;
+    if (usec > UINT32_MAX)
+        usec = UINT32_MAX;
+    exp = 63 - (unsigned int) __builtin_clzll(usec);
+    return ((exp - SG__LAT_SUB_BITS + 1) << SG__LAT_SUB_BITS) +
+           (unsigned int) ((usec >> (exp - SG__LAT_SUB_BITS)) & ((1 << SG__LAT_SUB_BITS) - 1));
+}
+
+/* highest latency (in microseconds) counted by the bucket. */
+static uint64_t sg__httpsrv_lat_max(unsigned int idx) {
+    unsigned int grp = idx >> SG__LAT_SUB_BITS;
+    uint64_t sub = idx & ((1 << SG__LAT_SUB_BITS) - 1);
+    if (grp == 0)
+        return sub;
+    return (((1 << SG__LAT_SUB_BITS) + sub + 1) << (grp - 1)) - 1;
+}
+
+static void sg__httpsrv_lat_add(struct sg__httpsrv_slot *slot, enum sg_httpsrv_phase phase, uint64_t usec) {
+    slot->lats[phase][sg__httpsrv_lat_idx(usec)]++;
+    slot->lat_sums[phase] += usec;
+}
+
+static uint64_t sg__httpsrv_lat_merge(struct sg_httpsrv *srv, enum sg_httpsrv_phase phase,
+                                      uint64_t buckets[SG__LAT_BUCKETS]) {
+    struct sg__httpsrv_slot *slot;
+    uint64_t total = 0;
+    unsigned int i;
+    memset(buckets, 0, SG__LAT_BUCKETS * sizeof(uint64_t));
+    for (slot = srv->slots; slot; slot = slot->next)
+        for (i = 0; i < SG__LAT_BUCKETS; i++) {
+            buckets[i] += slot->lats[phase][i];
+            total += slot->lats[phase][i];
+        }
+    return total;
+}
+
+static void sg__httpsrv_metrics_printf(struct sg__httpsrv_metrics *metrics, size_t *len, const char *fmt, ...) {
+    va_list ap;
+    size_t size;
+    char *buf;
+    int ret;
+    for (;;) {
+        va_start(ap, fmt);
+        ret = vsnprintf(metrics->buf + *len, metrics->size - *len, fmt, ap);
+        va_end(ap);
+        if ((ret >= 0) && ((size_t) ret < (metrics->size - *len)))
+            break;
+        size = (metrics->size * 2) + ((ret > 0) ? (size_t) ret : 0);
+        if (!(buf = sg__realloc(metrics->buf, size)))
+            oom();
+        metrics->buf = buf;
+        metrics->size = size;
+    }
+    *len += (size_t) ret;
+}
+
+static void sg__httpsrv_metrics_counter(struct sg__httpsrv_metrics *metrics, size_t *len, const char *name,
+                                        const char *help, const char *type, uint64_t val) {
+    sg__httpsrv_metrics_printf(metrics, len, "# HELP %s %s\n# TYPE %s %s\n%s %llu\n", name, help, name, type, name,
+                               (unsigned long long) val);
+}
+
+/* takes a free buffer of the slot, so the scrapes of a thread reuse the same buffers. A new one is allocated only
+ * while the previous responses are still being sent. */
+static struct sg__httpsrv_metrics *sg__httpsrv_metrics_acquire(struct sg__httpsrv_slot *slot) {
+    struct sg__httpsrv_metrics *metrics = slot->metrics;
+    if (metrics) {
+        slot->metrics = metrics->next;
+        metrics->next = NULL;
+        return metrics;
+    }
+    sg__new(metrics);
+    metrics->size = 16384; /* ~16 kB */
+    sg__alloc(metrics->buf, metrics->size);
+    return metrics;
+}
+
+static void sg__httpsrv_metrics_release(struct sg__httpsrv_slot *slot, struct sg__httpsrv_metrics *metrics) {
+    metrics->next = slot->metrics;
+    slot->metrics = metrics;
+}
+
+static void sg__httpsrv_metrics_free(struct sg__httpsrv_metrics *metrics) {
+    struct sg__httpsrv_metrics *next;
+    for (; metrics; metrics = next) {
+        next = metrics->next;
+        sg__free(metrics->buf);
+        sg__free(metrics);
+    }
+}
+
+/* renders the server metrics in the Prometheus text format into a scrape buffer. */
+static size_t sg__httpsrv_metrics_render(struct sg_httpsrv *srv, struct sg__httpsrv_metrics *metrics) {
+#define SG__METRIC(name) "sagui_" name
+#define SG__LAT_METRIC SG__METRIC("request_duration_seconds")
+    static const char *phases[SG__HTTPSRV_PHASES] = {"headers", "body", "handler", "queue", "complete", "total"};
+    struct sg_httpsrv_stats stats;
+    struct sg__httpsrv_slot *s;
+    uint64_t buckets[SG__LAT_BUCKETS], count, sum;
+    size_t len = 0;
+    unsigned int phase, i;
+    sg_httpsrv_stats(srv, &stats);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("requests_total"), "Requests received.", "counter",
+                                stats.reqs);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("received_bytes_total"), "Bytes of request payloads received.",
+                                "counter", stats.bytes_in);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("sent_bytes_total"), "Bytes of response bodies sent.",
+                                "counter", stats.bytes_out);
+    sg__httpsrv_metrics_printf(metrics, &len, "# HELP %s Responses sent per status class.\n# TYPE %s counter\n",
+                               SG__METRIC("responses_total"), SG__METRIC("responses_total"));
+    for (i = 0; i < 5; i++)
+        sg__httpsrv_metrics_printf(metrics, &len, "%s{code=\"%uxx\"} %llu\n", SG__METRIC("responses_total"), i + 1,
+                                   (unsigned long long) stats.status[i]);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("connections_opened_total"), "Connections accepted.",
+                                "counter", stats.cons_opened);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("connections_closed_total"), "Connections closed.",
+                                "counter", stats.cons_closed);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("connections_active"), "Connections currently active.",
+                                "gauge", stats.cons_active);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("uploads_total"), "Files uploaded.", "counter", stats.uplds);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("uploaded_bytes_total"), "Bytes of files uploaded.",
+                                "counter", stats.uplds_bytes);
+    sg__httpsrv_metrics_counter(metrics, &len, SG__METRIC("log_dropped_total"), "Access log records dropped.",
+                                "counter", stats.log_dropped);
+    sg__httpsrv_metrics_printf(metrics, &len, "# HELP %s Request latencies per phase.\n# TYPE %s histogram\n",
+                               SG__LAT_METRIC, SG__LAT_METRIC);
+    for (phase = 0; phase < SG__HTTPSRV_PHASES; phase++) {
+        sg__httpsrv_lat_merge(srv, (enum sg_httpsrv_phase) phase, buckets);
+        sum = 0;
+        for (s = srv->slots; s; s = s->next)
+            sum += s->lat_sums[phase];
+        /* one cumulative bucket per power of two keeps the series few and aggregatable between instances. */
+        count = 0;
+        for (i = 0; i < SG__LAT_BUCKETS; i++) {
+            count += buckets[i];
+            if ((i & ((1 << SG__LAT_SUB_BITS) - 1)) == ((1 << SG__LAT_SUB_BITS) - 1))
+                sg__httpsrv_metrics_printf(metrics, &len, "%s_bucket{phase=\"%s\",le=\"%g\"} %llu\n", SG__LAT_METRIC,
+                                           phases[phase], (double) (sg__httpsrv_lat_max(i) + 1) / 1e6,
+                                           (unsigned long long) count);
+        }
+        sg__httpsrv_metrics_printf(metrics, &len, "%s_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n"
+                                               "%s_sum{phase=\"%s\"} %g\n"
+                                               "%s_count{phase=\"%s\"} %llu\n",
+                                   SG__LAT_METRIC, phases[phase], (unsigned long long) count,
+                                   SG__LAT_METRIC, phases[phase], (double) sum / 1e6,
+                                   SG__LAT_METRIC, phases[phase], (unsigned long long) count);
+    }
+    return len;
+#undef SG__LAT_METRIC
+#undef SG__METRIC
+}
+
+static struct sg__httpsrv_con *sg__httpsrv_con_ctx(struct MHD_Connection *con) {
+    const union MHD_ConnectionInfo *info;
+    if (!con || !(info = MHD_get_connection_info(con, MHD_CONNECTION_INFO_SOCKET_CONTEXT)))
+        return NULL;
+    return info->socket_context;
+}
+
+/* takes a connection out of the idle ones when it starts handling a request. */
+static void sg__httpsrv_con_busy(struct sg__httpsrv_con *ctx) {
+    if (ctx->threaded) {
+        sg__atomic_add(&ctx->busy, 1);
+        return;
+    }
+    DL_DELETE(ctx->slot->idle, ctx);
+    ctx->busy = 1;
+}
+
+static void sg__httpsrv_con_idle(struct sg__httpsrv_con *ctx) {
+    if (ctx->threaded) {
+        sg__atomic_sub(&ctx->busy, 1);
+        return;
+    }
+    ctx->busy = 0;
+    DL_APPEND(ctx->slot->idle, ctx);
+}
 
 static void sg__httperr_cb(__SG_UNUSED void *cls, const char *err) {
     if (isatty(fileno(stderr)) && (fprintf(stderr, "%s", err) > 0))
         fflush(stderr);
 }
 
+void sg__httpsrv_verr(struct sg_httpsrv *srv, struct sg_httpreq *req, enum sg_err_code code,
+                      enum sg_err_subsys subsys, int errnum, const char *fmt, va_list ap) {
+    struct sg_err err;
+    char msg[SG__HTTPSRV_ERR_SIZE];
+    vsnprintf(msg, sizeof(msg), fmt, ap); /* a truncated message is still worth reporting */
+    if (!srv->err2_cb) {
+        srv->err_cb(srv->err_cls, msg);
+        return;
+    }
+    err.code = code;
+    err.subsys = subsys;
+    err.errnum = errnum;
+    err.req = req;
+    err.msg = msg;
+    srv->err2_cb(srv->err2_cls, &err);
+}
+
+void sg__httpsrv_err(struct sg_httpsrv *srv, struct sg_httpreq *req, enum sg_err_code code,
+                     enum sg_err_subsys subsys, int errnum, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    sg__httpsrv_verr(srv, req, code, subsys, errnum, fmt, ap);
+    va_end(ap);
+}
+
 static void sg__httpsrv_oel(void *cls, const char *fmt, va_list ap) {
-    struct sg_httpsrv *srv = cls;
-    va_list ap_cpy;
-    size_t size;
-    char *err;
-    va_copy(ap_cpy, ap);
-    size = (size_t) vsnprintf(NULL, 0, fmt, ap_cpy) + 1;
-    va_end(ap_cpy);
-    sg__alloc(err, size);
-    vsnprintf(err, size, fmt, ap);
-    srv->err_cb(srv->err_cls, err);
-    sg__free(err);
+    sg__httpsrv_verr(cls, NULL, SG_ERR_HTTPD, SG_ERR_SUBSYS_HTTPSRV, 0, fmt, ap);
 }
 
 static int sg__httpsrv_ahc(void *cls, struct MHD_Connection *con, const char *url, const char *method,
                            const char *version, const char *upld_data, size_t *upld_data_size, void **con_cls) {
     struct sg_httpsrv *srv = cls;
     struct sg_httpreq *req = *con_cls;
+    struct sg__httpsrv_con *ctx;
+    uint64_t now, handled = 0;
+    size_t len;
+    int ret;
+    bool passed;
     if (!req) {
         *con_cls = (req = sg__httpreq_new(con, version, method, url));
+        sg__trace3(request__new, req, method, url);
+        if ((ctx = sg__httpsrv_con_ctx(con))) {
+            req->slot = req->res->slot = ctx->slot;
+            req->started = sg__monotonic();
+            req->slot->stats.reqs++;
+            sg__httpsrv_lat_add(req->slot, SG_HTTPSRV_PHASE_HEADERS, req->started - ctx->idle_since);
+            sg__httpsrv_con_busy(ctx);
+        }
+        if (srv->vhosts_tbl)
+            req->vhost = sg__httpvhost_find(srv, MHD_lookup_connection_value(con, MHD_HEADER_KIND,
+                                                                             MHD_HTTP_HEADER_HOST));
         if (srv->auth_cb) {
             req->res->ret = srv->auth_cb(srv->auth_cls, req->auth, req, req->res);
-            if (!sg__httpauth_dispatch(req->auth))
+            if (sg__atomic_get(&srv->draining))
+                sg_strmap_set(&req->res->headers, MHD_HTTP_HEADER_CONNECTION, "close");
+            passed = sg__httpauth_dispatch(req->auth);
+            sg__trace2(auth__dispatch, req, passed);
+            if (!passed)
                 return req->res->ret;
         }
         return MHD_YES;
     }
     if (sg__httpuplds_process(srv, req, con, upld_data, upld_data_size, &req->res->ret))
         return req->res->ret;
-    srv->req_cb(srv->req_cls, req, req->res);
-    return sg__httpres_dispatch(req->res);
+    if (req->slot) {
+        handled = sg__monotonic();
+        sg__httpsrv_lat_add(req->slot, SG_HTTPSRV_PHASE_BODY, handled - req->started);
+    }
+    if (srv->metrics_path && req->slot && (strcmp(req->path, srv->metrics_path) == 0) &&
+        ((strcmp(req->method, MHD_HTTP_METHOD_GET) == 0) || (strcmp(req->method, MHD_HTTP_METHOD_HEAD) == 0))) {
+        /* the buffer is sent in place, and given back to the slot when the request completes. */
+        req->metrics = sg__httpsrv_metrics_acquire(req->slot);
+        len = sg__httpsrv_metrics_render(srv, req->metrics);
+        sg__httpres_sendbuf(req->res, req->metrics->buf, len, "text/plain; version=0.0.4; charset=utf-8", 200,
+                            MHD_RESPMEM_PERSISTENT);
+    } else {
+        sg__trace3(handler__entry, req, req->method, req->path);
+        if (req->vhost)
+            sg__httpvhost_handle(req->vhost, req, req->res);
+        else
+            srv->req_cb(srv->req_cls, req, req->res);
+        sg__trace2(handler__exit, req, req->res->status);
+    }
+    if (sg__atomic_get(&srv->draining))
+        sg_strmap_set(&req->res->headers, MHD_HTTP_HEADER_CONNECTION, "close");
+    if (!req->slot)
+        return sg__httpres_dispatch(req->res);
+    now = sg__monotonic();
+    sg__httpsrv_lat_add(req->slot, SG_HTTPSRV_PHASE_HANDLER, now - handled);
+    ret = sg__httpres_dispatch(req->res);
+    req->queued = sg__monotonic();
+    sg__httpsrv_lat_add(req->slot, SG_HTTPSRV_PHASE_QUEUE, req->queued - now);
+    return ret;
 }
 
-static void sg__httpsrv_rcc(void *cls, __SG_UNUSED struct MHD_Connection *con, void **con_cls,
-                            __SG_UNUSED enum MHD_RequestTerminationCode toe) {
-    if (*con_cls) {
-        sg__httpuplds_cleanup(cls, *con_cls);
-        sg__httpreq_free(*con_cls);
+static void sg__httpsrv_rcc(void *cls, struct MHD_Connection *con, void **con_cls,
+                            enum MHD_RequestTerminationCode toe) {
+    struct sg_httpsrv *srv = cls;
+    struct sg_httpreq *req = *con_cls;
+    struct sg__httpsrv_con *ctx;
+    uint64_t now;
+    if (req) {
+        sg__trace2(request__done, req, toe);
+        if (req->slot) {
+            now = sg__monotonic();
+            if (req->queued > 0) {
+                sg__httpsrv_lat_add(req->slot, SG_HTTPSRV_PHASE_COMPLETE, now - req->queued);
+                sg__httpsrv_lat_add(req->slot, SG_HTTPSRV_PHASE_TOTAL, now - req->started);
+            }
+            if ((ctx = sg__httpsrv_con_ctx(con))) {
+                ctx->idle_since = now;
+                sg__httpsrv_con_idle(ctx);
+            }
+            if (srv->log)
+                sg__httplog_write(srv->log, &req->slot->log, req, now - req->started);
+            if (req->metrics)
+                sg__httpsrv_metrics_release(req->slot, req->metrics);
+            req->slot->done++;
+        }
+        sg__httpuplds_cleanup(srv, req);
+        sg__httpreq_free(req);
+        if (srv && sg__atomic_get(&srv->draining)) {
+            if (toe == MHD_REQUEST_TERMINATED_COMPLETED_OK)
+                sg__atomic_add(&srv->drained, 1);
+            else
+                sg__atomic_add(&srv->aborted, 1);
+        }
     }
     *con_cls = NULL;
 }
 
-static void sg__httpsrv_addopt(struct MHD_OptionItem ops[8], unsigned char *pos,
-                               enum MHD_OPTION opt, intptr_t val, void *ptr) {
+/* counts the in-flight requests from the counters of the slots, which are updated without atomics by their
+ * threads, so a stale read only delays the draining to the next check. */
+static bool sg__httpsrv_inflight(struct sg_httpsrv *srv) {
+    struct sg__httpsrv_slot *slot;
+    int64_t count = 0;
+    for (slot = srv->slots; slot; slot = slot->next)
+        count += (int64_t) (slot->stats.reqs - slot->done);
+    return count > 0;
+}
+
+static void sg__httpsrv_sock_setopt(MHD_socket fd, int level, int name, int val) {
+    if (val >= 0)
+        setsockopt(fd, level, name, (const char *) &val, sizeof(val));
+}
+
+static bool sg__httpsrv_con_threaded(struct MHD_Connection *con) {
+    const union MHD_ConnectionInfo *info = MHD_get_connection_info(con, MHD_CONNECTION_INFO_DAEMON);
+    return info && (MHD_get_daemon_info(info->daemon, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_THREAD_PER_CONNECTION);
+}
+
+static void sg__httpsrv_snc(void *cls, struct MHD_Connection *con, void **socket_context,
+                            enum MHD_ConnectionNotificationCode toe) {
+    struct sg_httpsrv *srv = cls;
+    struct sg__httpsrv_con *ctx;
+    const union MHD_ConnectionInfo *info;
+    if (toe == MHD_CONNECTION_NOTIFY_CLOSED) {
+        if ((ctx = *socket_context)) {
+            ctx->slot->stats.cons_closed++;
+            if (ctx->threaded) {
+                sg__spin_lock(&srv->slots_lock);
+                DL_DELETE(srv->tcons, ctx);
+                sg__spin_unlock(&srv->slots_lock);
+                sg__httpsrv_slot_release(srv, ctx->slot);
+            } else if (!ctx->busy)
+                DL_DELETE(ctx->slot->idle, ctx);
+            sg__free(ctx);
+            *socket_context = NULL;
+        }
+        return;
+    }
+    sg__new(ctx);
+    ctx->con = con;
+    ctx->fd = MHD_INVALID_SOCKET;
+    ctx->threaded = sg__httpsrv_con_threaded(con);
+    if ((info = MHD_get_connection_info(con, MHD_CONNECTION_INFO_CONNECTION_FD)))
+        ctx->fd = info->connect_fd;
+    /* a thread per connection owns its slot while the connection lives, otherwise the thread slot is used. */
+    if (ctx->threaded) {
+        ctx->slot = sg__httpsrv_slot_acquire(srv);
+        sg__spin_lock(&srv->slots_lock);
+        DL_APPEND(srv->tcons, ctx);
+        sg__spin_unlock(&srv->slots_lock);
+    } else {
+        ctx->slot = sg__httpsrv_thr_slot;
+        DL_APPEND(ctx->slot->idle, ctx);
+    }
+    ctx->slot->stats.cons_opened++;
+    ctx->idle_since = sg__monotonic();
+    *socket_context = ctx;
+    if (!info)
+        return;
+    /* best-effort: options not applicable to the socket family (e.g. `TCP_NODELAY` on Unix sockets) are ignored. */
+    sg__httpsrv_sock_setopt(info->connect_fd, IPPROTO_TCP, TCP_NODELAY, srv->sockopts[SG_HTTPSRV_SOCKOPT_NODELAY]);
+    sg__httpsrv_sock_setopt(info->connect_fd, SOL_SOCKET, SO_SNDBUF, srv->sockopts[SG_HTTPSRV_SOCKOPT_SNDBUF]);
+    sg__httpsrv_sock_setopt(info->connect_fd, SOL_SOCKET, SO_RCVBUF, srv->sockopts[SG_HTTPSRV_SOCKOPT_RCVBUF]);
+#ifdef SO_BUSY_POLL
+    sg__httpsrv_sock_setopt(info->connect_fd, SOL_SOCKET, SO_BUSY_POLL, srv->sockopts[SG_HTTPSRV_SOCKOPT_BUSY_POLL]);
+#endif
+    if (srv->accept_cb)
+        srv->accept_cb(srv->accept_cls, (int) info->connect_fd);
+}
+
+static void sg__httpsrv_sock_close(MHD_socket fd) {
+    if (fd == MHD_INVALID_SOCKET)
+        return;
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+static void sg__httpsrv_addopt(struct MHD_OptionItem *ops, unsigned char *pos, enum MHD_OPTION opt, intptr_t val,
+                               void *ptr) {
     ops[*pos].option = opt;
     ops[*pos].value = val;
     ops[*pos].ptr_value = ptr;
     (*pos)++;
 }
 
+static MHD_socket sg__httpsrv_sock_dup(MHD_socket fd) {
+#ifdef _WIN32
+    WSAPROTOCOL_INFOW info;
+    if (WSADuplicateSocketW(fd, GetCurrentProcessId(), &info) != 0)
+        return MHD_INVALID_SOCKET;
+    return WSASocketW(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, &info, 0, WSA_FLAG_OVERLAPPED);
+#else
+    return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+#endif
+}
+
+/* waits for the sockets of the daemons driven by the thread, one per listener, then lets them handle their
+ * connections. The daemons choose their own polling (e.g. epoll), so only a few descriptors are waited here. */
+static void *sg__httpsrv_pool_loop(void *cls) {
+    struct sg__httpsrv_thr *thr = cls;
+    struct sg_httpsrv *srv = thr->srv;
+    struct sg__httpsrv_lsn *lsn;
+    struct sg__httpsrv_con *ctx;
+    struct MHD_Daemon *handle;
+    fd_set rs, ws, es;
+    struct timeval tv;
+    MHD_UNSIGNED_LONG_LONG ms, timeout;
+    MHD_socket max;
+    bool timed;
+    /* pins the thread before it touches its slot, so a new slot is allocated on the thread's NUMA node. */
+    sg__httpsrv_thr_pin(srv, thr->idx);
+    if (!thr->slot)
+        thr->slot = sg__httpsrv_slot_acquire(srv);
+    sg__httpsrv_thr_slot = thr->slot;
+    /* the idle connections are closed by the thread which owns them once the server drains, the others are closed
+     * after their responses, which include `Connection: close`. */
+    if (sg__atomic_get(&srv->draining))
+        DL_FOREACH(thr->slot->idle, ctx)
+            MHD_set_connection_option(ctx->con, MHD_CONNECTION_OPTION_TIMEOUT, 1);
+    while (!sg__atomic_get(&srv->pool.stop)) {
+        FD_ZERO(&rs);
+        FD_ZERO(&ws);
+        FD_ZERO(&es);
+        max = MHD_INVALID_SOCKET;
+        timeout = 0;
+        timed = false;
+#ifndef _WIN32
+        FD_SET(srv->pool.wake[0], &rs);
+        max = srv->pool.wake[0];
+#endif
+        LL_FOREACH(srv->lsns, lsn) {
+            if (!lsn->workers)
+                continue;
+            handle = lsn->workers[thr->idx];
+            /* a socket not fitting the sets (e.g. above `FD_SETSIZE` when epoll is not available) is not waited, so
+             * the wait is bounded to let the daemon retry it. */
+            if ((MHD_get_fdset2(handle, &rs, &ws, &es, &max, FD_SETSIZE) != MHD_YES) &&
+                (!timed || (timeout > SG__HTTPSRV_POOL_TICK))) {
+                timeout = SG__HTTPSRV_POOL_TICK;
+                timed = true;
+            }
+            if ((MHD_get_timeout(handle, &ms) == MHD_YES) && (!timed || (ms < timeout))) {
+                timeout = ms;
+                timed = true;
+            }
+        }
+#ifdef _WIN32
+        if (!timed || (timeout > SG__HTTPSRV_POOL_TICK)) {
+            timeout = SG__HTTPSRV_POOL_TICK;
+            timed = true;
+        }
+#endif
+        if (max == MHD_INVALID_SOCKET) {
+            /* nothing to wait (e.g. quiesced listeners without connections), where `select()` would fail at once. */
+            sg__usleep((timed ? timeout : SG__HTTPSRV_POOL_TICK) * 1000);
+        } else {
+            tv.tv_sec = (long) (timeout / 1000);
+            tv.tv_usec = (long) ((timeout % 1000) * 1000);
+            if (select((int) max + 1, &rs, &ws, &es, timed ? &tv : NULL) < 0) {
+                FD_ZERO(&rs);
+                FD_ZERO(&ws);
+                FD_ZERO(&es);
+            }
+        }
+        /* dispatches the ready sockets without polling them again, and lets the daemons handle their timeouts. */
+        LL_FOREACH(srv->lsns, lsn) {
+            if (lsn->workers)
+                MHD_run_from_select(lsn->workers[thr->idx], &rs, &ws, &es);
+        }
+    }
+    return NULL;
+}
+
+static void sg__httpsrv_pool_join(struct sg_httpsrv *srv, unsigned int count) {
+    unsigned int i;
+    sg__atomic_add(&srv->pool.stop, 1);
+#ifndef _WIN32
+    while ((write(srv->pool.wake[1], "", 1) == -1) && (errno == EINTR))
+        ;
+#endif
+    for (i = 0; i < count; i++)
+        pthread_join(srv->pool.thrs[i].thread, NULL);
+#ifndef _WIN32
+    close(srv->pool.wake[0]);
+    close(srv->pool.wake[1]);
+#endif
+    srv->pool.running = false;
+}
+
+static int sg__httpsrv_pool_start(struct sg_httpsrv *srv) {
+    pthread_attr_t attr;
+    unsigned int i;
+    int errnum;
+    if (!srv->pool.thrs || srv->pool.running)
+        return 0;
+#ifndef _WIN32
+    if (pipe(srv->pool.wake) != 0)
+        return errno;
+    fcntl(srv->pool.wake[0], F_SETFD, FD_CLOEXEC);
+    fcntl(srv->pool.wake[1], F_SETFD, FD_CLOEXEC);
+#endif
+    srv->pool.stop = 0;
+    srv->pool.running = true;
+    if ((errnum = pthread_attr_init(&attr)) != 0) {
+        sg__httpsrv_pool_join(srv, 0);
+        return errnum;
+    }
+    if (srv->thr_stack_size > 0)
+        pthread_attr_setstacksize(&attr, srv->thr_stack_size);
+    for (i = 0; i < srv->pool.size; i++)
+        if ((errnum = pthread_create(&srv->pool.thrs[i].thread, &attr, sg__httpsrv_pool_loop,
+                                     &srv->pool.thrs[i])) != 0) {
+            sg__httpsrv_pool_join(srv, i);
+            break;
+        }
+    pthread_attr_destroy(&attr);
+    return errnum;
+}
+
+/* stops the threads of the pool, e.g. to change the listeners they iterate, keeping the daemons and their
+ * connections. */
+static void sg__httpsrv_pool_pause(struct sg_httpsrv *srv) {
+    if (srv->pool.running)
+        sg__httpsrv_pool_join(srv, srv->pool.size);
+}
+
+static void sg__httpsrv_pool_free(struct sg_httpsrv *srv) {
+    sg__httpsrv_pool_pause(srv);
+    sg__free(srv->pool.thrs);
+    srv->pool.thrs = NULL;
+    srv->pool.size = 0;
+}
+
+static struct MHD_Daemon *sg__httpsrv_start(struct sg_httpsrv *srv, unsigned int flags, uint16_t port,
+                                            struct MHD_OptionItem *ops, MHD_socket fd, unsigned int con_limit) {
+    struct MHD_OptionItem extra[3];
+    unsigned char pos = 0;
+    if (fd != MHD_INVALID_SOCKET)
+        sg__httpsrv_addopt(extra, &pos, MHD_OPTION_LISTEN_SOCKET, (intptr_t) fd, NULL);
+    if (con_limit > 0)
+        sg__httpsrv_addopt(extra, &pos, MHD_OPTION_CONNECTION_LIMIT, con_limit, NULL);
+    sg__httpsrv_addopt(extra, &pos, MHD_OPTION_END, 0, NULL);
+    return MHD_start_daemon(flags, port, NULL, NULL, sg__httpsrv_ahc, srv,
+                            MHD_OPTION_ARRAY, ops,
+                            MHD_OPTION_ARRAY, extra,
+                            MHD_OPTION_END);
+}
+
+/* starts a daemon for each thread of the pool, all of them accepting from the same listening socket. */
+static struct MHD_Daemon **sg__httpsrv_start_workers(struct sg_httpsrv *srv, unsigned int flags, uint16_t port,
+                                                     struct MHD_OptionItem *ops) {
+    struct MHD_Daemon **workers;
+    MHD_socket fd = (MHD_socket) srv->listen_fd;
+    unsigned int size, limit, i;
+    int errnum;
+    if (!srv->pool.thrs) {
+        size = (srv->thr_pool_size > 0) ? srv->thr_pool_size : 1;
+        sg__alloc(srv->pool.thrs, size * sizeof(struct sg__httpsrv_thr));
+        for (i = 0; i < size; i++) {
+            srv->pool.thrs[i].srv = srv;
+            srv->pool.thrs[i].idx = i;
+        }
+        srv->pool.size = size;
+    }
+    size = srv->pool.size;
+    sg__alloc(workers, size * sizeof(struct MHD_Daemon *));
+    for (i = 0; i < size; i++) {
+        /* splits the connection limit of the listener between the threads, as the pools of libmicrohttpd do. */
+        limit = (srv->con_limit / size) + ((i < (srv->con_limit % size)) ? 1 : 0);
+        if ((srv->con_limit > 0) && (limit == 0))
+            limit = 1;
+        if ((i > 0) &&
+            ((fd = sg__httpsrv_sock_dup(MHD_get_daemon_info(workers[0], MHD_DAEMON_INFO_LISTEN_FD)->listen_fd)) ==
+             MHD_INVALID_SOCKET))
+            break;
+        if (!(workers[i] = sg__httpsrv_start(srv, flags, port, ops, fd, limit))) {
+            if (i > 0)
+                sg__httpsrv_sock_close(fd);
+            break;
+        }
+    }
+    if (i == size)
+        return workers;
+    errnum = errno;
+    while (i > 0) {
+        if ((--i == 0) && (srv->listen_fd != -1))
+            MHD_quiesce_daemon(workers[0]); /* hands the inherited socket back to the caller */
+        MHD_stop_daemon(workers[i]);
+    }
+    sg__free(workers);
+    errno = errnum;
+    return NULL;
+}
+
+static void sg__httpsrv_lsn_free(struct sg_httpsrv *srv, struct sg__httpsrv_lsn *lsn) {
+    unsigned int i;
+    if (lsn->workers) {
+        for (i = 0; i < srv->pool.size; i++)
+            MHD_stop_daemon(lsn->workers[i]);
+        sg__free(lsn->workers);
+    } else
+        MHD_stop_daemon(lsn->handle);
+    if (lsn->unix_path) {
+        unlink(lsn->unix_path);
+        sg__free(lsn->unix_path);
+    }
+    sg__free(lsn);
+}
+
 static bool sg__httpsrv_listen(struct sg_httpsrv *srv, const char *key, const char *pwd, const char *cert,
                                const char *trust, const char *dhparams, uint16_t port, bool threaded) {
-    struct MHD_OptionItem ops[8];
+    struct MHD_OptionItem ops[24];
+    struct MHD_Daemon *handle, **workers = NULL;
+    struct sg__httpsrv_lsn *lsn;
     unsigned int flags;
     unsigned char pos = 0;
+    int errnum;
     if (!srv || !srv->upld_cb || !srv->upld_write_cb || !srv->upld_save_cb || !srv->upld_save_as_cb ||
-        !srv->uplds_dir || (srv->post_buf_size < 256)) {
+        !srv->uplds_dir || (srv->post_buf_size < 256) ||
+        ((srv->con_mem_limit > 0) && (srv->con_mem_increment >= srv->con_mem_limit))) {
         errno = EINVAL;
         return false;
     }
-    flags = MHD_USE_DUAL_STACK | MHD_USE_ERROR_LOG |
-            (threaded ? MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_THREAD_PER_CONNECTION : MHD_USE_AUTO_INTERNAL_THREAD);
+    if ((errnum = sg__httpsrv_cpus_build(srv)) != 0) {
+        errno = errnum;
+        return false;
+    }
+    if (srv->log_path && !srv->log && !(srv->log = sg__httplog_new(srv, srv->log_path, srv->log_fmt))) {
+        if (!srv->lsns)
+            sg__httpsrv_cpus_free(srv);
+        return false;
+    }
+    /* out of the threaded mode, the daemons are driven by the threads of the pool shared by all the listeners. */
+    flags = MHD_USE_DUAL_STACK | MHD_USE_ERROR_LOG | MHD_USE_ITC |
+            (threaded ? MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_THREAD_PER_CONNECTION : MHD_USE_AUTO);
     sg__httpsrv_addopt(ops, &pos, MHD_OPTION_EXTERNAL_LOGGER, (intptr_t) sg__httpsrv_oel, srv);
     sg__httpsrv_addopt(ops, &pos, MHD_OPTION_NOTIFY_COMPLETED, (intptr_t) sg__httpsrv_rcc, srv);
-    if (srv->con_limit > 0)
-        sg__httpsrv_addopt(ops, &pos, MHD_OPTION_CONNECTION_LIMIT, srv->con_limit, NULL);
+    sg__httpsrv_addopt(ops, &pos, MHD_OPTION_NOTIFY_CONNECTION, (intptr_t) sg__httpsrv_snc, srv);
     if (srv->con_timeout > 0)
         sg__httpsrv_addopt(ops, &pos, MHD_OPTION_CONNECTION_TIMEOUT, srv->con_timeout, NULL);
-    if (srv->thr_pool_size > 0)
-        sg__httpsrv_addopt(ops, &pos, MHD_OPTION_THREAD_POOL_SIZE, srv->thr_pool_size, NULL);
+    if (srv->con_mem_limit > 0)
+        sg__httpsrv_addopt(ops, &pos, MHD_OPTION_CONNECTION_MEMORY_LIMIT, (intptr_t) srv->con_mem_limit, NULL);
+    if (srv->con_mem_increment > 0)
+        sg__httpsrv_addopt(ops, &pos, MHD_OPTION_CONNECTION_MEMORY_INCREMENT, (intptr_t) srv->con_mem_increment,
+                           NULL);
+    if (srv->thr_stack_size > 0)
+        sg__httpsrv_addopt(ops, &pos, MHD_OPTION_THREAD_STACK_SIZE, (intptr_t) srv->thr_stack_size, NULL);
+    if (srv->sockopts[SG_HTTPSRV_SOCKOPT_BACKLOG] > 0)
+        sg__httpsrv_addopt(ops, &pos, MHD_OPTION_LISTEN_BACKLOG_SIZE, srv->sockopts[SG_HTTPSRV_SOCKOPT_BACKLOG], NULL);
+    if (srv->sockopts[SG_HTTPSRV_SOCKOPT_REUSEPORT] > 0)
+        sg__httpsrv_addopt(ops, &pos, MHD_OPTION_LISTENING_ADDRESS_REUSE, 1, NULL);
+    if (srv->sockopts[SG_HTTPSRV_SOCKOPT_FASTOPEN] > 0) {
+        flags |= MHD_USE_TCP_FASTOPEN;
+        sg__httpsrv_addopt(ops, &pos, MHD_OPTION_TCP_FASTOPEN_QUEUE_SIZE,
+                           srv->sockopts[SG_HTTPSRV_SOCKOPT_FASTOPEN], NULL);
+    }
     if (key && cert) {
         flags |= MHD_USE_TLS;
         sg__httpsrv_addopt(ops, &pos, MHD_OPTION_HTTPS_MEM_KEY, 0, (void *) key);
@@ -123,9 +888,59 @@ static bool sg__httpsrv_listen(struct sg_httpsrv *srv, const char *key, const ch
             sg__httpsrv_addopt(ops, &pos, MHD_OPTION_HTTPS_MEM_DHPARAMS, 0, (void *) dhparams);
     }
     sg__httpsrv_addopt(ops, &pos, MHD_OPTION_END, 0, NULL);
-    return (srv->handle = MHD_start_daemon(flags, port, NULL, NULL, sg__httpsrv_ahc, srv,
-                                           MHD_OPTION_ARRAY, ops,
-                                           MHD_OPTION_END));
+    /* the threads of the pool iterate the listeners, so they are paused while a listener is added. */
+    sg__httpsrv_pool_pause(srv);
+    if (threaded)
+        handle = sg__httpsrv_start(srv, flags, port, ops, (MHD_socket) srv->listen_fd, srv->con_limit);
+    else
+        handle = (workers = sg__httpsrv_start_workers(srv, flags, port, ops)) ? workers[0] : NULL;
+    if (!handle) {
+        errnum = errno;
+        goto fail;
+    }
+    sg__new(lsn);
+    lsn->handle = handle;
+    lsn->workers = workers;
+    LL_PREPEND(srv->lsns, lsn);
+    if ((errnum = sg__httpsrv_pool_start(srv)) != 0) {
+        LL_DELETE(srv->lsns, lsn);
+        if (srv->listen_fd != -1)
+            MHD_quiesce_daemon(handle); /* hands the inherited socket back to the caller */
+        sg__httpsrv_lsn_free(srv, lsn);
+        goto fail;
+    }
+    srv->listen_fd = -1; /* the inherited socket is owned by the daemon from now on */
+    if (!srv->handle)
+        srv->handle = handle;
+    return true;
+fail:
+    if (srv->lsns) {
+        sg__httpsrv_pool_start(srv); /* resumes the other listeners */
+    } else {
+        sg__httplog_free(srv->log);
+        srv->log = NULL;
+        sg__httpsrv_cpus_free(srv);
+        sg__httpsrv_pool_free(srv);
+        sg__httpsrv_slots_recycle(srv);
+    }
+    errno = errnum;
+    return false;
+}
+
+static void sg__httpsrv_stop(struct sg_httpsrv *srv) {
+    struct sg__httpsrv_lsn *lsn, *tmp;
+    /* stops the threads before the daemons they drive, which then close their connections in this thread. */
+    sg__httpsrv_pool_pause(srv);
+    LL_FOREACH_SAFE(srv->lsns, lsn, tmp) {
+        LL_DELETE(srv->lsns, lsn);
+        sg__httpsrv_lsn_free(srv, lsn);
+    }
+    sg__httpsrv_pool_free(srv);
+    srv->handle = NULL;
+    sg__httplog_free(srv->log);
+    srv->log = NULL;
+    sg__httpsrv_cpus_free(srv);
+    sg__httpsrv_slots_recycle(srv);
 }
 
 struct sg_httpsrv *sg_httpsrv_new2(sg_httpauth_cb auth_cb, void *auth_cls, sg_httpreq_cb req_cb, void *req_cls,
@@ -149,6 +964,8 @@ struct sg_httpsrv *sg_httpsrv_new2(sg_httpauth_cb auth_cb, void *auth_cls, sg_ht
     srv->err_cb = err_cb;
     srv->err_cls = err_cls;
     srv->uplds_dir = sg_tmpdir();
+    srv->listen_fd = -1;
+    memset(srv->sockopts, -1, sizeof(srv->sockopts));
 #ifdef __arm__
     srv->post_buf_size = 1024; /* ~1 Kb */
     srv->payld_limit = 1048576; /* ~1 MB */
@@ -166,10 +983,21 @@ struct sg_httpsrv *sg_httpsrv_new(sg_httpreq_cb cb, void *cls) {
 }
 
 void sg_httpsrv_free(struct sg_httpsrv *srv) {
+    struct sg__httpsrv_slot *slot;
     if (!srv)
         return;
     sg__free(srv->uplds_dir);
     sg_httpsrv_shutdown(srv);
+    sg__httpvhosts_free(srv);
+    while ((slot = srv->slots)) {
+        srv->slots = slot->next;
+        sg__httpsrv_metrics_free(slot->metrics);
+        sg__free(slot->log.buf);
+        sg__free(slot);
+    }
+    sg__free(srv->metrics_path);
+    sg__free(srv->log_path);
+    sg__free(srv->affinity_list);
     sg__free(srv);
 }
 
@@ -198,16 +1026,144 @@ bool sg_httpsrv_listen(struct sg_httpsrv *srv, uint16_t port, bool threaded) {
     return sg__httpsrv_listen(srv, NULL, NULL, NULL, NULL, NULL, port, threaded);
 }
 
+#ifndef _WIN32
+
+/* checks whether a server is accepting connections on a socket file. A short-lived socket is used, since the state
+ * of a socket after a failed `connect()` is unspecified and it must not be reused for listening. */
+static bool sg__httpsrv_unix_alive(const struct sockaddr_un *addr) {
+    int fd;
+    bool alive;
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        return false;
+    alive = connect(fd, (const struct sockaddr *) addr, sizeof(*addr)) == 0;
+    close(fd);
+    return alive;
+}
+
+bool sg_httpsrv_listen_unix(struct sg_httpsrv *srv, const char *path, unsigned int mode, bool threaded) {
+    struct sockaddr_un addr;
+    struct stat sbuf;
+    int fd, backlog, errnum;
+    if (!srv || !path || (strlen(path) < 1) || (strlen(path) >= sizeof(addr.sun_path)) || (mode > 07777)) {
+        errno = EINVAL;
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path));
+    if ((lstat(path, &sbuf) == 0) && S_ISSOCK(sbuf.st_mode)) {
+        if (sg__httpsrv_unix_alive(&addr)) {
+            errno = EADDRINUSE;
+            return false;
+        }
+        unlink(path); /* stale socket left by a dead server */
+    }
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        return false;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        errnum = errno;
+        goto fail;
+    }
+    backlog = srv->sockopts[SG_HTTPSRV_SOCKOPT_BACKLOG];
+    if (((mode > 0) && (chmod(path, (mode_t) mode) != 0)) || (listen(fd, (backlog > 0) ? backlog : SOMAXCONN) != 0)) {
+        errnum = errno;
+        goto fail_unlink;
+    }
+    srv->listen_fd = fd;
+    if (!sg__httpsrv_listen(srv, NULL, NULL, NULL, NULL, NULL, 0, threaded)) {
+        errnum = errno;
+        srv->listen_fd = -1;
+        goto fail_unlink;
+    }
+    if (!(srv->lsns->unix_path = sg__strdup(path)))
+        oom();
+    return true;
+fail_unlink:
+    unlink(path);
+fail:
+    close(fd);
+    errno = errnum;
+    return false;
+}
+
+#endif
+
 int sg_httpsrv_shutdown(struct sg_httpsrv *srv) {
     if (!srv)
         return EINVAL;
-    if (srv->handle) {
-        MHD_stop_daemon(srv->handle);
-        srv->handle = NULL;
+    if (srv->lsns)
+        sg__httpsrv_stop(srv);
+    return 0;
+}
+
+/* closes the idle connections of the threaded listeners. Their threads can't be reached while they wait for a
+ * request, so the reading is shut down to wake them up, and they close the connection as if the client did. */
+static void sg__httpsrv_tcons_close_idle(struct sg_httpsrv *srv) {
+    struct sg__httpsrv_con *ctx;
+    sg__spin_lock(&srv->slots_lock);
+    DL_FOREACH(srv->tcons, ctx) {
+        if ((ctx->fd == MHD_INVALID_SOCKET) || sg__atomic_get(&ctx->busy))
+            continue;
+#ifdef _WIN32
+        shutdown(ctx->fd, SD_RECEIVE);
+#else
+        shutdown(ctx->fd, SHUT_RD);
+#endif
+    }
+    sg__spin_unlock(&srv->slots_lock);
+}
+
+int sg_httpsrv_drain(struct sg_httpsrv *srv, unsigned int timeout, unsigned int *drained, unsigned int *aborted) {
+    struct sg__httpsrv_lsn *lsn;
+    uint64_t deadline;
+    unsigned int i;
+    if (!srv)
+        return EINVAL;
+    if (srv->lsns) {
+        srv->drained = 0;
+        srv->aborted = 0;
+        sg__atomic_add(&srv->draining, 1);
+        sg__httpsrv_pool_pause(srv);
+        LL_FOREACH(srv->lsns, lsn) {
+            if (!lsn->workers) {
+                sg__httpsrv_sock_close(MHD_quiesce_daemon(lsn->handle));
+                continue;
+            }
+            for (i = 0; i < srv->pool.size; i++)
+                sg__httpsrv_sock_close(MHD_quiesce_daemon(lsn->workers[i]));
+        }
+        sg__httpsrv_tcons_close_idle(srv);
+        sg__httpsrv_pool_start(srv); /* the in-flight requests are finished by the pool */
+        deadline = sg__monotonic() + ((uint64_t) timeout * 1000000);
+        while (sg__httpsrv_inflight(srv) && (sg__monotonic() < deadline))
+            sg__usleep(10000); /* ~10 ms */
+        sg__httpsrv_stop(srv);
+        sg__atomic_sub(&srv->draining, 1);
     }
+    if (drained)
+        *drained = srv->drained;
+    if (aborted)
+        *aborted = srv->aborted;
     return 0;
 }
 
+int sg_httpsrv_export_fd(struct sg_httpsrv *srv) {
+    const union MHD_DaemonInfo *info;
+    if (!srv || !srv->handle ||
+        !(info = MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_LISTEN_FD)) ||
+        (info->listen_fd == MHD_INVALID_SOCKET)) {
+        errno = EINVAL;
+        return -1;
+    }
+#ifdef _WIN32
+    errno = ENOSYS;
+    return -1;
+#else
+    return dup(info->listen_fd);
+#endif
+}
+
 uint16_t sg_httpsrv_port(struct sg_httpsrv *srv) {
     if (!srv) {
         errno = EINVAL;
@@ -242,7 +1198,7 @@ int sg_httpsrv_set_upld_dir(struct sg_httpsrv *srv, const char *dir) {
     if (!srv || !dir)
         return EINVAL;
     sg__free(srv->uplds_dir);
-    srv->uplds_dir = strdup(dir);
+    srv->uplds_dir = sg__strdup(dir);
     return 0;
 }
 
@@ -314,6 +1270,51 @@ unsigned int sg_httpsrv_thr_pool_size(struct sg_httpsrv *srv) {
     return srv->thr_pool_size;
 }
 
+int sg_httpsrv_set_thr_stack_size(struct sg_httpsrv *srv, size_t size) {
+    if (!srv)
+        return EINVAL;
+    srv->thr_stack_size = size;
+    return 0;
+}
+
+size_t sg_httpsrv_thr_stack_size(struct sg_httpsrv *srv) {
+    if (!srv) {
+        errno = EINVAL;
+        return 0;
+    }
+    return srv->thr_stack_size;
+}
+
+int sg_httpsrv_set_thr_affinity(struct sg_httpsrv *srv, enum sg_httpsrv_affinity affinity, const unsigned int *cpus,
+                                unsigned int count) {
+    unsigned int *list = NULL;
+    if (!srv || ((int) affinity < SG_HTTPSRV_AFFINITY_NONE) || (affinity > SG_HTTPSRV_AFFINITY_LIST) ||
+        ((affinity == SG_HTTPSRV_AFFINITY_LIST) && (!cpus || (count == 0))))
+        return EINVAL;
+#ifndef __linux__
+    if (affinity != SG_HTTPSRV_AFFINITY_NONE)
+        return ENOTSUP;
+#endif
+    if (affinity == SG_HTTPSRV_AFFINITY_LIST) {
+        if (!(list = sg__malloc(count * sizeof(unsigned int))))
+            return ENOMEM;
+        memcpy(list, cpus, count * sizeof(unsigned int));
+    }
+    sg__free(srv->affinity_list);
+    srv->affinity_list = list;
+    srv->affinity_list_len = list ? count : 0;
+    srv->affinity = affinity;
+    return 0;
+}
+
+enum sg_httpsrv_affinity sg_httpsrv_thr_affinity(struct sg_httpsrv *srv) {
+    if (!srv) {
+        errno = EINVAL;
+        return SG_HTTPSRV_AFFINITY_NONE;
+    }
+    return srv->affinity;
+}
+
 int sg_httpsrv_set_con_timeout(struct sg_httpsrv *srv, unsigned int timeout) {
     if (!srv)
         return EINVAL;
@@ -343,3 +1344,187 @@ unsigned int sg_httpsrv_con_limit(struct sg_httpsrv *srv) {
     }
     return srv->con_limit;
 }
+
+int sg_httpsrv_set_con_mem_limit(struct sg_httpsrv *srv, size_t limit) {
+    if (!srv)
+        return EINVAL;
+    srv->con_mem_limit = limit;
+    return 0;
+}
+
+size_t sg_httpsrv_con_mem_limit(struct sg_httpsrv *srv) {
+    if (!srv) {
+        errno = EINVAL;
+        return 0;
+    }
+    return srv->con_mem_limit;
+}
+
+int sg_httpsrv_set_con_mem_increment(struct sg_httpsrv *srv, size_t increment) {
+    if (!srv)
+        return EINVAL;
+    srv->con_mem_increment = increment;
+    return 0;
+}
+
+size_t sg_httpsrv_con_mem_increment(struct sg_httpsrv *srv) {
+    if (!srv) {
+        errno = EINVAL;
+        return 0;
+    }
+    return srv->con_mem_increment;
+}
+
+int sg_httpsrv_set_req_mem_limit(struct sg_httpsrv *srv, size_t limit) {
+    if (!srv)
+        return EINVAL;
+    srv->req_mem_limit = limit;
+    return 0;
+}
+
+size_t sg_httpsrv_req_mem_limit(struct sg_httpsrv *srv) {
+    if (!srv) {
+        errno = EINVAL;
+        return 0;
+    }
+    return srv->req_mem_limit;
+}
+
+int sg_httpsrv_set_listen_fd(struct sg_httpsrv *srv, int fd) {
+    if (!srv || (fd < -1))
+        return EINVAL;
+    srv->listen_fd = fd;
+    return 0;
+}
+
+int sg_httpsrv_listen_fd(struct sg_httpsrv *srv) {
+    const union MHD_DaemonInfo *info;
+    if (!srv) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (srv->handle && (info = MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_LISTEN_FD)))
+        return (int) info->listen_fd;
+    return srv->listen_fd;
+}
+
+int sg_httpsrv_set_sockopt(struct sg_httpsrv *srv, enum sg_httpsrv_sockopt opt, int val) {
+    if (!srv || ((int) opt < 0) || (opt >= SG__HTTPSRV_SOCKOPTS) || (val < -1))
+        return EINVAL;
+    srv->sockopts[opt] = val;
+    return 0;
+}
+
+int sg_httpsrv_sockopt(struct sg_httpsrv *srv, enum sg_httpsrv_sockopt opt) {
+    if (!srv || ((int) opt < 0) || (opt >= SG__HTTPSRV_SOCKOPTS)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return srv->sockopts[opt];
+}
+
+int sg_httpsrv_set_accept_cb(struct sg_httpsrv *srv, sg_httpsrv_accept_cb cb, void *cls) {
+    if (!srv)
+        return EINVAL;
+    srv->accept_cb = cb;
+    srv->accept_cls = cls;
+    return 0;
+}
+
+int sg_httpsrv_set_err_cb(struct sg_httpsrv *srv, sg_httpsrv_err_cb cb, void *cls) {
+    if (!srv)
+        return EINVAL;
+    srv->err2_cb = cb;
+    srv->err2_cls = cls;
+    return 0;
+}
+
+int sg_httpsrv_stats(struct sg_httpsrv *srv, struct sg_httpsrv_stats *stats) {
+    struct sg__httpsrv_slot *slot;
+    unsigned char i;
+    if (!srv || !stats)
+        return EINVAL;
+    memset(stats, 0, sizeof(struct sg_httpsrv_stats));
+    /* the counters are read without locking, so the snapshot is only approximate while the server is running. */
+    for (slot = srv->slots; slot; slot = slot->next) {
+        stats->reqs += slot->stats.reqs;
+        stats->bytes_in += slot->stats.bytes_in;
+        stats->bytes_out += slot->stats.bytes_out;
+        for (i = 0; i < 5; i++)
+            stats->status[i] += slot->stats.status[i];
+        stats->cons_opened += slot->stats.cons_opened;
+        stats->cons_closed += slot->stats.cons_closed;
+        stats->uplds += slot->stats.uplds;
+        stats->uplds_bytes += slot->stats.uplds_bytes;
+        stats->log_dropped += slot->log.dropped;
+    }
+    if (stats->cons_opened > stats->cons_closed)
+        stats->cons_active = stats->cons_opened - stats->cons_closed;
+    return 0;
+}
+
+uint64_t sg_httpsrv_lat_quantile(struct sg_httpsrv *srv, enum sg_httpsrv_phase phase, double q) {
+    uint64_t buckets[SG__LAT_BUCKETS], total, rank, count = 0;
+    unsigned int i;
+    if (!srv || ((int) phase < 0) || (phase >= SG__HTTPSRV_PHASES) || !(q >= 0) || (q > 1)) {
+        errno = EINVAL;
+        return 0;
+    }
+    if ((total = sg__httpsrv_lat_merge(srv, phase, buckets)) == 0)
+        return 0;
+    rank = (uint64_t) (q * (double) total);
+    if ((rank == 0) || ((double) rank < (q * (double) total)))
+        rank++;
+    for (i = 0; i < SG__LAT_BUCKETS; i++) {
+        count += buckets[i];
+        if (count >= rank)
+            return sg__httpsrv_lat_max(i);
+    }
+    return sg__httpsrv_lat_max(SG__LAT_BUCKETS - 1);
+}
+
+int sg_httpsrv_set_metrics_path(struct sg_httpsrv *srv, const char *path) {
+    if (!srv || (path && (path[0] != '/')))
+        return EINVAL;
+    sg__free(srv->metrics_path);
+    srv->metrics_path = NULL;
+    if (path && !(srv->metrics_path = sg__strdup(path)))
+        oom();
+    return 0;
+}
+
+const char *sg_httpsrv_metrics_path(struct sg_httpsrv *srv) {
+    if (!srv) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return srv->metrics_path;
+}
+
+int sg_httpsrv_set_access_log(struct sg_httpsrv *srv, const char *path, enum sg_httpsrv_log_fmt fmt) {
+    if (!srv || (path && (strlen(path) < 1)) || ((int) fmt < 0) || (fmt > SG_HTTPSRV_LOG_JSON))
+        return EINVAL;
+    sg__free(srv->log_path);
+    srv->log_path = NULL;
+    if (path && !(srv->log_path = sg__strdup(path)))
+        oom();
+    srv->log_fmt = fmt;
+    return 0;
+}
+
+const char *sg_httpsrv_access_log(struct sg_httpsrv *srv) {
+    if (!srv) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return srv->log_path;
+}
+
+int sg_httpsrv_reopen_access_log(struct sg_httpsrv *srv) {
+    struct sg__httplog *log;
+    if (!srv)
+        return EINVAL;
+    if ((log = srv->log))
+        log->reopen = 1;
+    return 0;
+}
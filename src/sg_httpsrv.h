@@ -29,11 +29,92 @@
 #define SG_HTTPSRV_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include "sg_macros.h"
 #include "microhttpd.h"
 #include "sagui.h"
+#include "sg_httplog.h"
+
+#define SG__HTTPSRV_SOCKOPTS (SG_HTTPSRV_SOCKOPT_BUSY_POLL + 1)
+
+#define SG__HTTPSRV_PHASES (SG_HTTPSRV_PHASE_TOTAL + 1)
+
+#define SG__HTTPSRV_ERR_SIZE 512
+
+/* maximum number of NUMA nodes considered by the thread affinity policies. */
+#define SG__HTTPSRV_NODES 16 /* ~512 bytes */
+
+/* maximum time (in milliseconds) a pooled thread waits before checking if it must stop, where it can't be woken up
+ * by a pipe. */
+#define SG__HTTPSRV_POOL_TICK 100
+
+/* log-linear latency buckets: 8 sub-buckets per power of two, covering up to 2^32 us (~71 minutes). */
+#define SG__LAT_SUB_BITS 3
+#define SG__LAT_BUCKETS ((32 - SG__LAT_SUB_BITS + 1) << SG__LAT_SUB_BITS)
+
+/* buffer of a metrics scrape, sent without copying and given back to its slot when the request completes. */
+struct sg__httpsrv_metrics {
+    struct sg__httpsrv_metrics *next;
+    char *buf;
+    size_t size;
+};
+
+struct sg__httpsrv_slot {
+    struct sg_httpsrv_stats stats;
+    uint64_t done; /* requests completed, to count the ones in-flight from `stats.reqs` */
+    uint64_t lats[SG__HTTPSRV_PHASES][SG__LAT_BUCKETS];
+    uint64_t lat_sums[SG__HTTPSRV_PHASES];
+    struct sg__httplog_ring log;
+    struct sg__httpsrv_metrics *metrics; /* free buffers of the metrics scrapes */
+    struct sg__httpsrv_con *idle; /* idle connections of a pooled thread, closed by it when the server drains */
+    struct sg__httpsrv_slot *next;
+    struct sg__httpsrv_slot *next_free;
+};
+
+struct sg__httpsrv_con {
+    struct sg__httpsrv_slot *slot;
+    struct MHD_Connection *con;
+    struct sg__httpsrv_con *prev; /* in the idle connections of the slot, or the threaded connections of the server */
+    struct sg__httpsrv_con *next;
+    uint64_t idle_since; /* time the connection was accepted or its last request was completed */
+    MHD_socket fd;
+    int busy; /* handling a request, read by the draining thread in threaded mode */
+    bool threaded;
+};
+
+struct sg__httpsrv_lsn {
+    struct sg__httpsrv_lsn *next;
+    struct MHD_Daemon *handle;
+    struct MHD_Daemon **workers; /* one daemon per pooled thread, sharing the listening socket; `NULL` in threaded mode */
+    char *unix_path;
+};
+
+struct sg__httpsrv_thr {
+    pthread_t thread;
+    struct sg_httpsrv *srv;
+    struct sg__httpsrv_slot *slot; /* kept while the server listens, since the connections of the thread point to it */
+    unsigned int idx;
+};
+
+/* threads shared by all the listeners not using the threaded mode, each one driving a daemon of every listener. */
+struct sg__httpsrv_pool {
+    struct sg__httpsrv_thr *thrs;
+    unsigned int size;
+    int wake[2]; /* pipe to wake the threads up when they must stop */
+    int stop;
+    bool running;
+};
 
 struct sg_httpsrv {
     struct MHD_Daemon *handle;
+    struct sg__httpsrv_lsn *lsns;
+    struct sg__httpsrv_pool pool;
+    struct sg__httpsrv_slot *slots;
+    struct sg__httpsrv_slot *free_slots;
+    struct sg__httpsrv_con *tcons; /* connections of the threaded listeners, guarded by `slots_lock` */
+    struct sg__httplog *log;
     sg_httpauth_cb auth_cb;
     sg_httpupld_cb upld_cb;
     sg_write_cb upld_write_cb;
@@ -42,17 +123,48 @@ struct sg_httpsrv {
     sg_save_as_cb upld_save_as_cb;
     sg_httpreq_cb req_cb;
     sg_err_cb err_cb;
+    sg_httpsrv_err_cb err2_cb;
+    sg_httpsrv_accept_cb accept_cb;
     void *auth_cls;
     void *upld_cls;
     void *req_cls;
     void *err_cls;
+    void *err2_cls;
+    void *accept_cls;
     char *uplds_dir;
+    struct sg_httpvhost *vhosts;
+    struct sg_httpvhost **vhosts_tbl; /* hosts table, only changed while the server is not listening */
+    unsigned int vhosts_size;
+    char *metrics_path;
+    char *log_path;
+    enum sg_httpsrv_log_fmt log_fmt;
     size_t post_buf_size;
     size_t payld_limit;
+    size_t con_mem_limit;
+    size_t con_mem_increment;
+    size_t req_mem_limit;
     uint64_t uplds_limit;
     unsigned int thr_pool_size;
+    size_t thr_stack_size;
+    enum sg_httpsrv_affinity affinity;
+    unsigned int *affinity_list; /* CPUs set by the user for `SG_HTTPSRV_AFFINITY_LIST` */
+    unsigned int affinity_list_len;
+    unsigned int *cpus; /* CPUs assigned in order to the threads, built when the server starts listening */
+    unsigned int cpus_len;
     unsigned int con_timeout;
     unsigned int con_limit;
+    int listen_fd;
+    int sockopts[SG__HTTPSRV_SOCKOPTS];
+    unsigned int drained;
+    unsigned int aborted;
+    int slots_lock;
+    int draining;
 };
 
+SG__EXTERN void sg__httpsrv_verr(struct sg_httpsrv *srv, struct sg_httpreq *req, enum sg_err_code code,
+                                  enum sg_err_subsys subsys, int errnum, const char *fmt, va_list ap);
+
+SG__EXTERN void sg__httpsrv_err(struct sg_httpsrv *srv, struct sg_httpreq *req, enum sg_err_code code,
+                                 enum sg_err_subsys subsys, int errnum, const char *fmt, ...);
+
 #endif /* SG_HTTPSRV_H */
@@ -31,15 +31,17 @@
 #include "uthash.h"
 #include "sagui.h"
 #include "sg_utils.h"
+#include "sg_trace.h"
 #include "sg_str.h"
 #include "sg_strmap.h"
 #include "sg_httpreq.h"
+#include "sg_httpvhost.h"
 
 static void sg__httpuplds_add(struct sg_httpsrv *srv, struct sg_httpreq *req, const char *fieldname,
                               const char *filename, const char *content_type, const char *transfer_encoding) {
     sg__new(req->curr_upld);
     LL_APPEND(req->uplds, req->curr_upld);
-    req->curr_upld->dir = sg__strdup(srv->uplds_dir);
+    req->curr_upld->dir = sg__strdup(sg__httpvhost_uplds_dir(srv, req));
     req->curr_upld->field = sg__strdup(fieldname);
     req->curr_upld->name = sg__strdup(filename);
     req->curr_upld->mime = sg__strdup(content_type);
@@ -61,59 +63,63 @@ static void sg__httpuplds_free(struct sg_httpsrv *srv, struct sg_httpreq *req) {
     sg__free(req->curr_upld);
 }
 
-static void sg__httpuplds_err(struct sg_httpsrv *srv, const char *fmt, ...) {
+/* request whose payload is being processed by the calling thread, reported along with the upload errors. */
+static sg__thread struct sg_httpreq *sg__httpuplds_req;
+
+static void sg__httpuplds_err(struct sg_httpsrv *srv, enum sg_err_code code, int errnum, const char *fmt, ...) {
     va_list ap;
-    size_t size;
-    char *err;
-    va_start(ap, fmt);
-    size = (size_t) vsnprintf(NULL, 0, fmt, ap) + 1;
-    va_end(ap);
-    sg__alloc(err, size);
     va_start(ap, fmt);
-    vsnprintf(err, size, fmt, ap);
+    sg__httpsrv_verr(srv, sg__httpuplds_req, code, SG_ERR_SUBSYS_HTTPUPLDS, errnum, fmt, ap);
     va_end(ap);
-    srv->err_cb(srv->err_cls, err);
-    sg__free(err);
 }
 
 static int sg__httpuplds_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind, const char *key, const char *filename,
                               const char *content_type, const char *transfer_encoding, const char *data,
                               uint64_t off, size_t size) {
     struct sg__httpupld_holder *holder;
-    char *val;
     if (/*kind == MHD_POSTDATA_KIND && */ size > 0) {
         holder = cls;
         if (filename) {
             if (off == 0) {
+                if (holder->req->slot)
+                    holder->req->slot->stats.uplds++;
                 sg__httpuplds_add(holder->srv, holder->req, key, filename, content_type, transfer_encoding);
-                if (holder->srv->upld_cb(holder->srv->upld_cls, &holder->req->curr_upld->handle, holder->srv->uplds_dir,
-                                         key, filename, content_type, transfer_encoding) != 0)
+                if (holder->srv->upld_cb(holder->srv->upld_cls, &holder->req->curr_upld->handle,
+                                         sg__httpvhost_uplds_dir(holder->srv, holder->req), key, filename,
+                                         content_type, transfer_encoding) != 0)
                     return MHD_NO;
             }
+            sg__trace4(upload__chunk, holder->req, filename, off, size);
             if (holder->srv->upld_write_cb(holder->req->curr_upld->handle, off, data, size) == (size_t) -1)
                 return MHD_NO;
             holder->req->curr_upld->size += size;
-            if (holder->srv->uplds_limit > 0) {
+            if (holder->req->slot)
+                holder->req->slot->stats.uplds_bytes += size;
+            if (sg__httpvhost_uplds_limit(holder->srv, holder->req) > 0) {
                 holder->req->total_uplds_size += size;
-                if (holder->req->total_uplds_size > holder->srv->uplds_limit) {
-                    sg__httpuplds_err(holder->srv, _("Upload too large.\n"));
+                if (holder->req->total_uplds_size > sg__httpvhost_uplds_limit(holder->srv, holder->req)) {
+                    sg__httpuplds_err(holder->srv, SG_ERR_UPLDS_TOO_LARGE, 0, _("Upload too large.\n"));
                     return MHD_NO;
                 }
             }
         } else {
             if (off == 0) {
                 sg__strmap_new(&holder->req->curr_field, key, data);
-                HASH_ADD_STR(holder->req->fields, key, holder->req->curr_field);
+                sg__strmap_add(&holder->req->fields, holder->req->curr_field);
+                holder->req->mem_size += sg__strmap_pair_size(holder->req->curr_field);
             } else {
-                if (!(val = sg__realloc(holder->req->curr_field->val, off + size)))
-                    oom();
-                holder->req->curr_field->val = val;
-                memcpy(holder->req->curr_field->val + off, data, size);
+                holder->req->curr_field = sg__strmap_append(&holder->req->fields, holder->req->curr_field, data,
+                                                            size);
+                holder->req->mem_size += size;
+            }
+            if ((holder->srv->req_mem_limit > 0) && (holder->req->mem_size > holder->srv->req_mem_limit)) {
+                sg__httpuplds_err(holder->srv, SG_ERR_REQ_MEM_TOO_LARGE, 0, _("Request too large.\n"));
+                return MHD_NO;
             }
-            if (holder->srv->payld_limit > 0) {
+            if (sg__httpvhost_payld_limit(holder->srv, holder->req) > 0) {
                 holder->req->total_fields_size += size;
-                if (holder->req->total_fields_size > holder->srv->payld_limit) {
-                    holder->srv->err_cb(holder->srv->err_cls, _("Payload too large.\n"));
+                if (holder->req->total_fields_size > sg__httpvhost_payld_limit(holder->srv, holder->req)) {
+                    sg__httpuplds_err(holder->srv, SG_ERR_PAYLD_TOO_LARGE, 0, _("Payload too large.\n"));
                     return MHD_NO;
                 }
             }
@@ -125,21 +131,39 @@ static int sg__httpuplds_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind, co
 bool sg__httpuplds_process(struct sg_httpsrv *srv, struct sg_httpreq *req, struct MHD_Connection *con,
                            const char *upld_data, size_t *upld_data_size, int *ret) {
     struct sg__httpupld_holder holder = {srv, req};
+    bool posted;
     if (*upld_data_size > 0) {
         req->is_uploading = true;
+        if (req->slot)
+            req->slot->stats.bytes_in += *upld_data_size;
         if (!req->pp)
             req->pp = MHD_create_post_processor(con, srv->post_buf_size, sg__httpuplds_iter, &holder);
         if (req->pp) {
-            if (MHD_post_process(req->pp, upld_data, *upld_data_size) != MHD_YES) {
+            sg__httpuplds_req = req;
+            posted = MHD_post_process(req->pp, upld_data, *upld_data_size) == MHD_YES;
+            sg__httpuplds_req = NULL;
+            if (!posted) {
                 *ret = MHD_NO;
                 return true;
             }
         } else {
             utstring_bincpy(req->payload->buf, upld_data, *upld_data_size);
-            if ((srv->payld_limit > 0) && (utstring_len(req->payload->buf) > srv->payld_limit)) {
+            req->mem_size += *upld_data_size;
+            if ((sg__httpvhost_payld_limit(srv, req) > 0) &&
+                (utstring_len(req->payload->buf) > sg__httpvhost_payld_limit(srv, req))) {
+                *ret = MHD_NO;
+                req->mem_size -= utstring_len(req->payload->buf);
+                utstring_clear(req->payload->buf);
+                sg__httpsrv_err(srv, req, SG_ERR_PAYLD_TOO_LARGE, SG_ERR_SUBSYS_HTTPUPLDS, 0,
+                                _("Payload too large.\n"));
+                return true;
+            }
+            if ((srv->req_mem_limit > 0) && (req->mem_size > srv->req_mem_limit)) {
                 *ret = MHD_NO;
+                req->mem_size -= utstring_len(req->payload->buf);
                 utstring_clear(req->payload->buf);
-                srv->err_cb(srv->err_cls, _("Payload too large.\n"));
+                sg__httpsrv_err(srv, req, SG_ERR_REQ_MEM_TOO_LARGE, SG_ERR_SUBSYS_HTTPUPLDS, 0,
+                                _("Request too large.\n"));
                 return true;
             }
         }
@@ -152,10 +176,12 @@ bool sg__httpuplds_process(struct sg_httpsrv *srv, struct sg_httpreq *req, struc
 
 void sg__httpuplds_cleanup(struct sg_httpsrv *srv, struct sg_httpreq *req) {
     struct sg_httpupld *tmp;
+    sg__httpuplds_req = req;
     LL_FOREACH_SAFE(req->uplds, req->curr_upld, tmp) {
         LL_DELETE(req->uplds, req->curr_upld);
         sg__httpuplds_free(srv, req);
     }
+    sg__httpuplds_req = NULL;
 }
 
 int sg__httpupld_cb(void *cls, void **handle, const char *dir, __SG_UNUSED const char *field, const char *name,
@@ -169,12 +195,13 @@ int sg__httpupld_cb(void *cls, void **handle, const char *dir, __SG_UNUSED const
     h->srv = cls;
     if (stat(dir, &sbuf) != 0) {
         errnum = errno;
-        sg__httpuplds_err(cls, _("Cannot find directory \"%s\": %s.\n"), dir, sg_strerror(errnum, err, sizeof(err)));
+        sg__httpuplds_err(cls, SG_ERR_UPLDS_DIR, errnum, _("Cannot find directory \"%s\": %s.\n"), dir,
+                          sg_strerror(errnum, err, sizeof(err)));
         goto fail;
     }
     if (!S_ISDIR(sbuf.st_mode)) {
         errnum = ENOTDIR;
-        sg__httpuplds_err(cls, _("Cannot access directory \"%s\": %s.\n"), dir,
+        sg__httpuplds_err(cls, SG_ERR_UPLDS_DIR, errnum, _("Cannot access directory \"%s\": %s.\n"), dir,
                           sg_strerror(errnum, err, sizeof(err)));
         goto fail;
     }
@@ -189,7 +216,7 @@ int sg__httpupld_cb(void *cls, void **handle, const char *dir, __SG_UNUSED const
     fd = mkstemp(h->path);
     if (fd == -1) {
         errnum = errno;
-        sg__httpuplds_err(cls, _("Cannot create temporary file in \"%s\": %s.\n"), dir,
+        sg__httpuplds_err(cls, SG_ERR_UPLD_FILE, errnum, _("Cannot create temporary file in \"%s\": %s.\n"), dir,
                           sg_strerror(errnum, err, sizeof(err)));
         goto fail;
     }
@@ -198,7 +225,7 @@ int sg__httpupld_cb(void *cls, void **handle, const char *dir, __SG_UNUSED const
         errnum = errno;
         close(fd);
         unlink(h->path);
-        sg__httpuplds_err(cls, _("Cannot open temporary file \"%s\": %s.\n"), h->path,
+        sg__httpuplds_err(cls, SG_ERR_UPLD_FILE, errnum, _("Cannot open temporary file \"%s\": %s.\n"), h->path,
                           sg_strerror(errnum, err, sizeof(err)));
         goto fail;
     }
@@ -216,11 +243,13 @@ fail:
 size_t sg__httpupld_write_cb(void *handle, __SG_UNUSED uint64_t offset, const char *buf, size_t size) {
     struct sg__httpupld *h = handle;
     size_t written = fwrite(buf, 1, size, h->file);
+    int errnum;
     if (written != size) {
+        errnum = errno;
         fclose(h->file);
         h->file = NULL;
         unlink(h->path);
-        sg__httpuplds_err(h->srv, _("Cannot write temporary file \"%s\".\n"), h->path);
+        sg__httpuplds_err(h->srv, SG_ERR_UPLD_FILE, errnum, _("Cannot write temporary file \"%s\".\n"), h->path);
         return (size_t) -1;
     }
     return written;
@@ -229,19 +258,23 @@ size_t sg__httpupld_write_cb(void *handle, __SG_UNUSED uint64_t offset, const ch
 void sg__httpupld_free_cb(void *handle) {
     struct sg__httpupld *h;
     char err[ERR_BUF_SIZE];
+    int errnum;
     if (!(h = handle))
         return;
     if (!h->file)
         goto done;
     if (fclose(h->file) == 0) {
         if (unlink(h->path) != 0) {
-            sg__httpuplds_err(h->srv, _("Cannot remove temporary file \"%s\": %s.\n"), h->path,
-                              sg_strerror(errno, err, sizeof(err)));
+            errnum = errno;
+            sg__httpuplds_err(h->srv, SG_ERR_UPLD_FILE, errnum, _("Cannot remove temporary file \"%s\": %s.\n"),
+                              h->path, sg_strerror(errnum, err, sizeof(err)));
         }
         goto done;
-    } else
-        sg__httpuplds_err(h->srv, _("Cannot close temporary file \"%s\": %s.\n"), h->path,
-                          sg_strerror(errno, err, sizeof(err)));
+    } else {
+        errnum = errno;
+        sg__httpuplds_err(h->srv, SG_ERR_UPLD_FILE, errnum, _("Cannot close temporary file \"%s\": %s.\n"), h->path,
+                          sg_strerror(errnum, err, sizeof(err)));
+    }
 done:
     sg__free(h->path);
     sg__free(h->dest_path);
@@ -33,6 +33,96 @@
 #include "sagui.h"
 #include "sg_httputils.h"
 
+static const char *const sg__hdr_names[SG__HDRS] = {
+    "Accept",
+    "Accept-Charset",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Accept-Ranges",
+    "Age",
+    "Allow",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Disposition",
+    "Content-Encoding",
+    "Content-Language",
+    "Content-Length",
+    "Content-Location",
+    "Content-Range",
+    "Content-Type",
+    "Cookie",
+    "Date",
+    "ETag",
+    "Expect",
+    "Expires",
+    "Host",
+    "If-Match",
+    "If-Modified-Since",
+    "If-None-Match",
+    "If-Range",
+    "If-Unmodified-Since",
+    "Last-Modified",
+    "Location",
+    "Origin",
+    "Pragma",
+    "Range",
+    "Referer",
+    "Retry-After",
+    "Server",
+    "Set-Cookie",
+    "Transfer-Encoding",
+    "Upgrade",
+    "User-Agent",
+    "Vary",
+    "Via",
+    "WWW-Authenticate",
+    "X-Forwarded-For",
+    "X-Forwarded-Proto",
+    "X-Requested-With"
+};
+
+/* perfect hash table of the well-known headers, indexed by `sg__hdr_hash()` (`255` marks an empty slot). */
+static const unsigned char sg__hdr_tbl[128] = {
+    255, 255, 255, 255,  25, 255, 255, 255,   5,  43, 255, 255, 255, 255, 255,  39,
+    255, 255, 255, 255,  31, 255, 255, 255, 255, 255,  18,  17, 255,  42, 255,   0,
+    255, 255,   4, 255,  21, 255, 255, 255, 255,  41, 255, 255,   3,  16,   8, 255,
+     15, 255, 255,  20, 255,  37, 255,   1, 255,  12, 255, 255,  22, 255, 255,  26,
+    255, 255, 255,  19, 255, 255, 255, 255,   7,   9, 255,  28, 255, 255, 255, 255,
+      2, 255,   6,  33, 255,  35, 255, 255,  45,  44,  24,  14,  40,  11, 255,  34,
+     27, 255, 255,  32,  10, 255, 255, 255, 255,  13, 255, 255, 255, 255, 255, 255,
+     29, 255, 255, 255, 255,  23, 255,  36,  38,  30, 255, 255, 255, 255, 255, 255
+};
+
+#define SG__HDR_LOWER(c) ((unsigned char) ((((c) >= 'A') && ((c) <= 'Z')) ? ((c) | 0x20) : (c)))
+
+/* combines the length, the first and the last (lowercase) characters, which are collision free for the well-known
+ * header names. */
+#define sg__hdr_hash(len, first, last) ((((len) * 3) + ((first) * 5) + ((last) * 18)) & 127)
+
+int sg__hdr_id(const char *name) {
+    const char *known;
+    size_t len = strlen(name), i;
+    unsigned char id;
+    if (len == 0)
+        return -1;
+    id = sg__hdr_tbl[sg__hdr_hash(len, SG__HDR_LOWER(name[0]), SG__HDR_LOWER(name[len - 1]))];
+    if (id == 255)
+        return -1;
+    known = sg__hdr_names[id];
+    for (i = 0; i < len; i++)
+        if (SG__HDR_LOWER(name[i]) != SG__HDR_LOWER(known[i]))
+            return -1;
+    return known[len] == '\0' ? id : -1;
+}
+
+void sg__hdrs_add(char *const *hdrs, struct MHD_Response *handle) {
+    int i;
+    for (i = 0; i < SG__HDRS; i++)
+        if (hdrs[i])
+            MHD_add_response_header(handle, sg__hdr_names[i], hdrs[i]);
+}
+
 int sg__httpcon_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind, const char *key, const char *val) {
     sg_strmap_add(cls, key, val);
     return MHD_YES;
@@ -50,3 +140,11 @@ ssize_t sg_httpread_end(bool err) {
 #endif
             err ? MHD_CONTENT_READER_END_WITH_ERROR : MHD_CONTENT_READER_END_OF_STREAM;
 }
+
+const char *sg_hdr_name(enum sg_hdr id) {
+    if (((int) id < 0) || ((int) id >= SG__HDRS)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return sg__hdr_names[id];
+}
@@ -33,6 +33,13 @@
 #include "sg_strmap.h"
 #include "sagui.h"
 
+/* number of well-known headers declared in `enum sg_hdr`. */
+#define SG__HDRS ((int) SG_HDR_X_REQUESTED_WITH + 1)
+
+SG__EXTERN int sg__hdr_id(const char *name);
+
+SG__EXTERN void sg__hdrs_add(char *const *hdrs, struct MHD_Response *handle);
+
 SG__EXTERN int sg__httpcon_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind, const char *key, const char *val);
 
 SG__EXTERN int sg__httpheaders_iter(void *cls, struct sg_strmap *header);
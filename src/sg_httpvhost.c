@@ -0,0 +1,257 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include "sg_macros.h"
+#include "sagui.h"
+#include "sg_utils.h"
+#include "sg_router.h"
+#include "sg_httpsrv.h"
+#include "sg_httpreq.h"
+#include "sg_httpvhost.h"
+
+#define SG__HTTPVHOST_LOWER(c) ((unsigned char) ((((c) >= 'A') && ((c) <= 'Z')) ? ((c) | 0x20) : (c)))
+
+/* FNV-1a hash of a host folded to lowercase. It isn't seeded, since the table keys are set only by the application. */
+static uint32_t sg__httpvhost_hash(const char *host, size_t len) {
+    uint32_t hash = 2166136261u;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        hash ^= SG__HTTPVHOST_LOWER(host[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* length of the name of a raw Host value, i.e. without its port and trailing dot. */
+static size_t sg__httpvhost_host_len(const char *host) {
+    const char *end;
+    size_t len;
+    if ((host[0] == '[') && (end = strchr(host, ']')))
+        return (size_t) (end - host) + 1;
+    for (len = 0; host[len] && (host[len] != ':'); len++)
+        ;
+    if ((len > 0) && (host[len - 1] == '.'))
+        len--;
+    return len;
+}
+
+static bool sg__httpvhost_is_host(const char *host) {
+    size_t len = strlen(host), i;
+    if ((len == 0) || (host[0] == '.') || (host[len - 1] == '.'))
+        return false;
+    if (host[0] == '[')
+        return (len > 2) && (host[len - 1] == ']') && (strspn(host + 1, "0123456789abcdefABCDEF:.") == (len - 2));
+    for (i = 0; i < len; i++)
+        if (!isalnum((unsigned char) host[i]) && (host[i] != '-') && (host[i] != '.') && (host[i] != '_'))
+            return false;
+    return true;
+}
+
+static struct sg_httpvhost *sg__httpvhost_lookup(struct sg_httpsrv *srv, const char *host, size_t len, bool wildcard) {
+    const unsigned int mask = srv->vhosts_size - 1;
+    const uint32_t hash = sg__httpvhost_hash(host, len);
+    struct sg_httpvhost *vhost;
+    unsigned int i;
+    size_t j;
+    for (i = hash & mask; (vhost = srv->vhosts_tbl[i]); i = (i + 1) & mask) {
+        if ((vhost->hash != hash) || (vhost->len != len) || (vhost->wildcard != wildcard))
+            continue;
+        for (j = 0; (j < len) && ((unsigned char) vhost->host[j] == SG__HTTPVHOST_LOWER(host[j])); j++)
+            ;
+        if (j == len)
+            return vhost;
+    }
+    return NULL;
+}
+
+/* rebuilds the table after adding a host. The server is not listening, so no thread is reading it. */
+static void sg__httpvhost_rehash(struct sg_httpsrv *srv, unsigned int count) {
+    struct sg_httpvhost *vhost;
+    unsigned int size = SG__HTTPVHOST_INIT_SIZE, i;
+    while (size < (count * 2))
+        size *= 2;
+    sg__free(srv->vhosts_tbl);
+    sg__alloc(srv->vhosts_tbl, size * sizeof(struct sg_httpvhost *));
+    srv->vhosts_size = size;
+    for (vhost = srv->vhosts; vhost; vhost = vhost->next) {
+        for (i = vhost->hash & (size - 1); srv->vhosts_tbl[i]; i = (i + 1) & (size - 1))
+            ;
+        srv->vhosts_tbl[i] = vhost;
+    }
+}
+
+struct sg_httpvhost *sg__httpvhost_find(struct sg_httpsrv *srv, const char *host) {
+    struct sg_httpvhost *vhost;
+    size_t len, i;
+    if (!srv->vhosts_tbl || !host)
+        return NULL;
+    len = sg__httpvhost_host_len(host);
+    if ((vhost = sg__httpvhost_lookup(srv, host, len, false)))
+        return vhost;
+    /* the most specific wildcard wins, e.g. `*.b.example.com` over `*.example.com` for `a.b.example.com`. */
+    for (i = 0; i < len; i++)
+        if ((host[i] == '.') && (vhost = sg__httpvhost_lookup(srv, host + i + 1, len - i - 1, true)))
+            return vhost;
+    return NULL;
+}
+
+void sg__httpvhost_handle(struct sg_httpvhost *vhost, struct sg_httpreq *req, struct sg_httpres *res) {
+    if (vhost->router && (sg_router_dispatch(vhost->router, req, res) == 0))
+        return;
+    vhost->cb(vhost->cls, req, res);
+}
+
+void sg__httpvhosts_free(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost;
+    while ((vhost = srv->vhosts)) {
+        srv->vhosts = vhost->next;
+        sg__free(vhost->host);
+        sg__free(vhost->uplds_dir);
+        sg__free(vhost);
+    }
+    sg__free(srv->vhosts_tbl);
+    srv->vhosts_tbl = NULL;
+    srv->vhosts_size = 0;
+}
+
+struct sg_httpvhost *sg_httpsrv_add_vhost(struct sg_httpsrv *srv, const char *host, sg_httpreq_cb cb, void *cls) {
+    struct sg_httpvhost *vhost;
+    unsigned int count = 1;
+    bool wildcard;
+    size_t i;
+    if (!srv || !host || !cb) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (srv->handle) {
+        errno = EALREADY;
+        return NULL;
+    }
+    if ((wildcard = (strncmp(host, "*.", 2) == 0)))
+        host += 2;
+    if (!sg__httpvhost_is_host(host) || (wildcard && (host[0] == '['))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (srv->vhosts_tbl && sg__httpvhost_lookup(srv, host, strlen(host), wildcard)) {
+        errno = EEXIST;
+        return NULL;
+    }
+    sg__new(vhost);
+    if (!(vhost->host = sg__strdup(host)) || !(vhost->uplds_dir = sg__strdup(srv->uplds_dir)))
+        oom();
+    vhost->len = strlen(host);
+    for (i = 0; i < vhost->len; i++)
+        vhost->host[i] = (char) SG__HTTPVHOST_LOWER(vhost->host[i]);
+    vhost->hash = sg__httpvhost_hash(vhost->host, vhost->len);
+    vhost->wildcard = wildcard;
+    vhost->cb = cb;
+    vhost->cls = cls;
+    vhost->payld_limit = srv->payld_limit;
+    vhost->uplds_limit = srv->uplds_limit;
+    vhost->next = srv->vhosts;
+    srv->vhosts = vhost;
+    for (vhost = vhost->next; vhost; vhost = vhost->next)
+        count++;
+    sg__httpvhost_rehash(srv, count);
+    return srv->vhosts;
+}
+
+int sg_httpvhost_set_router(struct sg_httpvhost *vhost, struct sg_router *router) {
+    if (!vhost || (router && !router->nodes))
+        return EINVAL;
+    vhost->router = router;
+    return 0;
+}
+
+struct sg_router *sg_httpvhost_router(struct sg_httpvhost *vhost) {
+    if (!vhost) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return vhost->router;
+}
+
+int sg_httpvhost_set_upld_dir(struct sg_httpvhost *vhost, const char *dir) {
+    if (!vhost || !dir)
+        return EINVAL;
+    sg__free(vhost->uplds_dir);
+    if (!(vhost->uplds_dir = sg__strdup(dir)))
+        oom();
+    return 0;
+}
+
+const char *sg_httpvhost_upld_dir(struct sg_httpvhost *vhost) {
+    if (!vhost) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return vhost->uplds_dir;
+}
+
+int sg_httpvhost_set_payld_limit(struct sg_httpvhost *vhost, size_t limit) {
+    if (!vhost)
+        return EINVAL;
+    vhost->payld_limit = limit;
+    return 0;
+}
+
+size_t sg_httpvhost_payld_limit(struct sg_httpvhost *vhost) {
+    if (!vhost) {
+        errno = EINVAL;
+        return 0;
+    }
+    return vhost->payld_limit;
+}
+
+int sg_httpvhost_set_uplds_limit(struct sg_httpvhost *vhost, uint64_t limit) {
+    if (!vhost)
+        return EINVAL;
+    vhost->uplds_limit = limit;
+    return 0;
+}
+
+uint64_t sg_httpvhost_uplds_limit(struct sg_httpvhost *vhost) {
+    if (!vhost) {
+        errno = EINVAL;
+        return 0;
+    }
+    return vhost->uplds_limit;
+}
+
+struct sg_httpvhost *sg_httpreq_vhost(struct sg_httpreq *req) {
+    if (!req) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return req->vhost;
+}
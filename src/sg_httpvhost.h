@@ -0,0 +1,65 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SG_HTTPVHOST_H
+#define SG_HTTPVHOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sg_macros.h"
+#include "sagui.h"
+#include "sg_httpsrv.h"
+
+/* minimum number of buckets of the hosts table. */
+#define SG__HTTPVHOST_INIT_SIZE 8
+
+struct sg_httpvhost {
+    struct sg_httpvhost *next;
+    char *host; /* lowercase, without the `*.` prefix of a wildcard */
+    size_t len;
+    uint32_t hash;
+    bool wildcard;
+    sg_httpreq_cb cb;
+    void *cls;
+    struct sg_router *router;
+    char *uplds_dir;
+    size_t payld_limit;
+    uint64_t uplds_limit;
+};
+
+/* settings of the virtual host of a request, or of the server if the request has none. */
+#define sg__httpvhost_uplds_dir(srv, req) ((req)->vhost ? (req)->vhost->uplds_dir : (srv)->uplds_dir)
+#define sg__httpvhost_payld_limit(srv, req) ((req)->vhost ? (req)->vhost->payld_limit : (srv)->payld_limit)
+#define sg__httpvhost_uplds_limit(srv, req) ((req)->vhost ? (req)->vhost->uplds_limit : (srv)->uplds_limit)
+
+SG__EXTERN struct sg_httpvhost *sg__httpvhost_find(struct sg_httpsrv *srv, const char *host);
+
+SG__EXTERN void sg__httpvhost_handle(struct sg_httpvhost *vhost, struct sg_httpreq *req, struct sg_httpres *res);
+
+SG__EXTERN void sg__httpvhosts_free(struct sg_httpsrv *srv);
+
+#endif /* SG_HTTPVHOST_H */
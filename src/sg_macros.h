@@ -74,8 +74,15 @@ do {
 #endif
 #endif
 
+/* allocator functions, replaceable at runtime by `sg_set_allocator()`. */
+SG__EXTERN void *sg__mem_malloc(size_t size);
+
+SG__EXTERN void *sg__mem_realloc(void *ptr, size_t size);
+
+SG__EXTERN void sg__mem_free(void *ptr);
+
 #ifndef sg__malloc
-#define sg__malloc(size) malloc((size))
+#define sg__malloc(size) sg__mem_malloc((size))
 #endif
 
 #ifndef sg__alloc
@@ -92,11 +99,53 @@ do {                                   \
 #endif
 
 #ifndef sg__realloc
-#define sg__realloc(ptr, size) realloc((ptr), (size))
+#define sg__realloc(ptr, size) sg__mem_realloc((ptr), (size))
 #endif
 
 #ifndef sg__free
-#define sg__free(ptr) free((ptr))
+#define sg__free(ptr) sg__mem_free((ptr))
+#endif
+
+/* routes the allocations of the bundled uthash and utstring through the library allocator. */
+#define uthash_malloc(sz) sg__malloc((sz))
+#define uthash_free(ptr, sz) sg__free((ptr))
+#define utstring_malloc(sz) sg__malloc((sz))
+#define utstring_realloc(ptr, sz) sg__realloc((ptr), (sz))
+#define utstring_dealloc(ptr) sg__free((ptr))
+
+/* macro used for declaring thread-local variables. */
+#ifndef sg__thread
+#ifdef _MSC_VER
+#define sg__thread __declspec(thread)
+#else
+#define sg__thread __thread
+#endif
+#endif
+
+/* macros used for handling locks held for a very short time, e.g. in cold paths. */
+#ifndef sg__spin_lock
+#define sg__spin_lock(ptr)                     \
+do {                                           \
+    while (__sync_lock_test_and_set((ptr), 1)) \
+        ;                                      \
+} while (0)
+#endif
+
+#ifndef sg__spin_unlock
+#define sg__spin_unlock(ptr) __sync_lock_release((ptr))
+#endif
+
+/* macros used for handling counters shared between threads. */
+#ifndef sg__atomic_add
+#define sg__atomic_add(ptr, val) __sync_add_and_fetch((ptr), (val))
+#endif
+
+#ifndef sg__atomic_sub
+#define sg__atomic_sub(ptr, val) __sync_sub_and_fetch((ptr), (val))
+#endif
+
+#ifndef sg__atomic_get
+#define sg__atomic_get(ptr) __sync_add_and_fetch((ptr), 0)
 #endif
 
 #endif /* SG_MACROS_H */
@@ -0,0 +1,387 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include "sg_macros.h"
+#include "sagui.h"
+#include "sg_utils.h"
+#include "sg_httpreq.h"
+#include "sg_router.h"
+
+/* methods having their own handler slot, the last slot handles any method. */
+static const char *const sg__router_methods[SG__ROUTER_METHODS - 1] = {
+    "GET", "HEAD", "POST", "PUT", "DELETE", "CONNECT", "OPTIONS", "TRACE", "PATCH"
+};
+
+#define SG__ROUTER_GET 0
+#define SG__ROUTER_HEAD 1
+#define SG__ROUTER_ANY (SG__ROUTER_METHODS - 1)
+
+/* returns the handler slot of a method, or `-1` if it is not a standard one. */
+static int sg__router_method(const char *method) {
+    int i;
+    for (i = 0; i < SG__ROUTER_ANY; i++)
+        if (strcmp(method, sg__router_methods[i]) == 0)
+            return i;
+    return -1;
+}
+
+static bool sg__router_is_name(const char *name, size_t len) {
+    size_t i;
+    if (len == 0)
+        return false;
+    for (i = 0; i < len; i++)
+        if ((name[i] != '_') && !isalnum((unsigned char) name[i]))
+            return false;
+    return true;
+}
+
+/* checks the pattern syntax, so a route is not partially added to the tree. */
+static bool sg__router_is_pattern(const char *pattern) {
+    const char *end;
+    unsigned int params = 0;
+    if (*pattern != '/')
+        return false;
+    for (; *pattern; pattern++) {
+        if ((*pattern != '/') || ((pattern[1] != ':') && (pattern[1] != '*')))
+            continue;
+        for (end = pattern + 2; *end && (*end != '/'); end++)
+            ;
+        if (!sg__router_is_name(pattern + 2, (size_t) (end - pattern - 2)) || (++params > SG__ROUTER_MAX_PARAMS) ||
+            ((pattern[1] == '*') && *end))
+            return false;
+        pattern = end - 1;
+    }
+    return true;
+}
+
+static struct sg__router_bnode *sg__router_bnode_new(const char *label, size_t len) {
+    struct sg__router_bnode *node;
+    sg__new(node);
+    sg__alloc(node->label, len + 1);
+    memcpy(node->label, label, len);
+    node->len = len;
+    return node;
+}
+
+static void sg__router_bnode_free(struct sg__router_bnode *node) {
+    unsigned int i;
+    if (!node)
+        return;
+    for (i = 0; i < node->count; i++)
+        sg__router_bnode_free(node->children[i]);
+    sg__router_bnode_free(node->param);
+    sg__router_bnode_free(node->wild);
+    sg__free(node->children);
+    sg__free(node->label);
+    sg__free(node);
+}
+
+/* inserts a static part of a pattern, splitting the edges sharing a prefix with it. */
+static struct sg__router_bnode *sg__router_insert(struct sg__router_bnode *node, const char *str, size_t len) {
+    struct sg__router_bnode *child, *mid;
+    size_t common;
+    unsigned int i;
+    while (len > 0) {
+        for (i = 0; (i < node->count) && ((unsigned char) node->children[i]->label[0] < (unsigned char) *str); i++)
+            ;
+        if ((i == node->count) || (node->children[i]->label[0] != *str)) {
+            child = sg__router_bnode_new(str, len);
+            if (!(node->children = sg__realloc(node->children, (node->count + 1) * sizeof(*node->children))))
+                oom();
+            memmove(node->children + i + 1, node->children + i, (node->count - i) * sizeof(*node->children));
+            node->children[i] = child;
+            node->count++;
+            return child;
+        }
+        child = node->children[i];
+        for (common = 1; (common < child->len) && (common < len) && (child->label[common] == str[common]); common++)
+            ;
+        if (common < child->len) {
+            mid = sg__router_bnode_new(child->label, common);
+            sg__alloc(mid->children, sizeof(*mid->children));
+            mid->children[0] = child;
+            mid->count = 1;
+            memmove(child->label, child->label + common, child->len - common + 1);
+            child->len -= common;
+            node->children[i] = mid;
+            child = mid;
+        }
+        node = child;
+        str += common;
+        len -= common;
+    }
+    return node;
+}
+
+/* inserts a parameter or wildcard child, which is shared by all the routes using the same name at that position. */
+static struct sg__router_bnode *sg__router_insert_param(struct sg__router_bnode **node, const char *name, size_t len) {
+    if (!*node)
+        *node = sg__router_bnode_new(name, len);
+    else if (((*node)->len != len) || (memcmp((*node)->label, name, len) != 0))
+        return NULL;
+    return *node;
+}
+
+static unsigned int sg__router_bnode_count(struct sg__router_bnode *node, size_t *labels, unsigned int *slots) {
+    unsigned int count = 1, i;
+    *labels += node->len + 1;
+    for (i = 0; i < SG__ROUTER_METHODS; i++)
+        if (node->hnds[i]) {
+            (*slots)++;
+            break;
+        }
+    for (i = 0; i < node->count; i++)
+        count += sg__router_bnode_count(node->children[i], labels, slots);
+    if (node->param)
+        count += sg__router_bnode_count(node->param, labels, slots);
+    if (node->wild)
+        count += sg__router_bnode_count(node->wild, labels, slots);
+    return count;
+}
+
+static struct sg__router_hnd *sg__router_slot(struct sg_router *router, const struct sg__router_node *node,
+                                              int method) {
+    struct sg__router_hnd **slots = router->slots + (node->slots * SG__ROUTER_METHODS);
+    if ((method != -1) && slots[method])
+        return slots[method];
+    /* HEAD requests are answered by the GET handler, libmicrohttpd discards the body. */
+    if ((method == SG__ROUTER_HEAD) && slots[SG__ROUTER_GET])
+        return slots[SG__ROUTER_GET];
+    return slots[SG__ROUTER_ANY];
+}
+
+/* matches the rest of a path from a node whose label is already matched. Static children are tried first, then the
+ * parameter and at last the wildcard, backtracking when a branch doesn't match the whole path. Paths matching a route
+ * only for other methods are flagged in `other`. */
+static bool sg__router_walk(struct sg_router *router, unsigned int i, const char *path, int method,
+                            struct sg_route *route, struct sg__router_hnd **hnd, bool *other) {
+    const struct sg__router_node *node = router->nodes + i, *child;
+    const char *end;
+    unsigned int j;
+    if (*path) {
+        for (j = node->child; j < (node->child + node->count); j++) {
+            child = router->nodes + j;
+            if ((unsigned char) child->label[0] < (unsigned char) *path)
+                continue;
+            if ((child->label[0] == *path) && (strncmp(path, child->label, child->len) == 0) &&
+                sg__router_walk(router, j, path + child->len, method, route, hnd, other))
+                return true;
+            break;
+        }
+        if (node->param) {
+            for (end = path; *end && (*end != '/'); end++)
+                ;
+            if (end > path) {
+                route->params[route->count].name = router->nodes[node->param].label;
+                route->params[route->count].val = path;
+                route->params[route->count].len = (size_t) (end - path);
+                route->count++;
+                if (sg__router_walk(router, node->param, end, method, route, hnd, other))
+                    return true;
+                route->count--;
+            }
+        }
+    } else if (node->slots != -1) {
+        if ((*hnd = sg__router_slot(router, node, method)))
+            return true;
+        *other = true;
+    }
+    if (node->wild && (router->nodes[node->wild].slots != -1)) {
+        child = router->nodes + node->wild;
+        if ((*hnd = sg__router_slot(router, child, method))) {
+            route->params[route->count].name = child->label;
+            route->params[route->count].val = path;
+            route->params[route->count].len = strlen(path);
+            route->count++;
+            return true;
+        }
+        *other = true;
+    }
+    return false;
+}
+
+static int sg__router_find(struct sg_router *router, const char *method, const char *path, struct sg_route *route,
+                           struct sg__router_hnd **hnd) {
+    bool other = false;
+    route->count = 0;
+    if (sg__router_walk(router, 0, path, sg__router_method(method), route, hnd, &other)) {
+        route->pattern = (*hnd)->pattern;
+        return 0;
+    }
+    /* the path matches a route, but not for this method. */
+    return other ? ENOTSUP : ENOENT;
+}
+
+struct sg_router *sg_router_new(void) {
+    struct sg_router *router;
+    sg__new(router);
+    router->root = sg__router_bnode_new("", 0);
+    return router;
+}
+
+void sg_router_free(struct sg_router *router) {
+    struct sg__router_hnd *hnd, *tmp;
+    if (!router)
+        return;
+    sg__router_bnode_free(router->root);
+    for (hnd = router->hnds; hnd; hnd = tmp) {
+        tmp = hnd->next;
+        sg__free(hnd->pattern);
+        sg__free(hnd);
+    }
+    sg__free(router->nodes);
+    sg__free(router->slots);
+    sg__free(router->labels);
+    sg__free(router);
+}
+
+int sg_router_add(struct sg_router *router, const char *method, const char *pattern, sg_route_cb cb, void *cls) {
+    struct sg__router_bnode *node;
+    struct sg__router_hnd *hnd;
+    const char *str, *end;
+    int slot = SG__ROUTER_ANY;
+    if (!router || !pattern || !cb || !sg__router_is_pattern(pattern) ||
+        (method && ((slot = sg__router_method(method)) == -1)))
+        return EINVAL;
+    if (router->nodes)
+        return EALREADY;
+    node = router->root;
+    for (str = pattern; *str; str = end) {
+        if (((str[0] == ':') || (str[0] == '*')) && (str[-1] == '/')) {
+            for (end = str + 1; *end && (*end != '/'); end++)
+                ;
+            if (!(node = sg__router_insert_param((str[0] == ':') ? &node->param : &node->wild, str + 1,
+                                                 (size_t) (end - str - 1))))
+                return EINVAL;
+            continue;
+        }
+        /* the static part goes up to the next parameter or wildcard, keeping the slash before it. */
+        for (end = str + 1; *end && ((end[-1] != '/') || ((*end != ':') && (*end != '*'))); end++)
+            ;
+        node = sg__router_insert(node, str, (size_t) (end - str));
+    }
+    if (node->hnds[slot])
+        return EEXIST;
+    sg__new(hnd);
+    hnd->cb = cb;
+    hnd->cls = cls;
+    if (!(hnd->pattern = sg__strdup(pattern)))
+        oom();
+    hnd->next = router->hnds;
+    router->hnds = hnd;
+    node->hnds[slot] = hnd;
+    return 0;
+}
+
+int sg_router_compile(struct sg_router *router) {
+    struct sg__router_bnode **queue, *bnode;
+    struct sg__router_node *node;
+    size_t labels = 0;
+    unsigned int count, slots = 0, n = 1, i, j;
+    char *label;
+    if (!router)
+        return EINVAL;
+    if (router->nodes)
+        return EALREADY;
+    count = sg__router_bnode_count(router->root, &labels, &slots);
+    sg__alloc(queue, count * sizeof(*queue));
+    sg__alloc(router->nodes, count * sizeof(struct sg__router_node));
+    sg__alloc(router->slots, (slots > 0 ? slots : 1) * SG__ROUTER_METHODS * sizeof(struct sg__router_hnd *));
+    sg__alloc(router->labels, labels);
+    label = router->labels;
+    slots = 0;
+    queue[0] = router->root;
+    for (i = 0; i < n; i++) {
+        bnode = queue[i];
+        node = router->nodes + i;
+        node->label = memcpy(label, bnode->label, bnode->len + 1);
+        node->len = (unsigned int) bnode->len;
+        label += bnode->len + 1;
+        node->child = n;
+        node->count = bnode->count;
+        for (j = 0; j < bnode->count; j++)
+            queue[n++] = bnode->children[j];
+        if (bnode->param) {
+            node->param = n;
+            queue[n++] = bnode->param;
+        }
+        if (bnode->wild) {
+            node->wild = n;
+            queue[n++] = bnode->wild;
+        }
+        node->slots = -1;
+        for (j = 0; j < SG__ROUTER_METHODS; j++)
+            if (bnode->hnds[j]) {
+                node->slots = (int) slots;
+                memcpy(router->slots + (slots * SG__ROUTER_METHODS), bnode->hnds, sizeof(bnode->hnds));
+                slots++;
+                break;
+            }
+    }
+    sg__free(queue);
+    sg__router_bnode_free(router->root);
+    router->root = NULL;
+    return 0;
+}
+
+int sg_router_dispatch(struct sg_router *router, struct sg_httpreq *req, struct sg_httpres *res) {
+    struct sg_route route;
+    struct sg__router_hnd *hnd;
+    int ret;
+    if (!router || !router->nodes || !req || !res)
+        return EINVAL;
+    if ((ret = sg__router_find(router, req->method, req->path, &route, &hnd)) != 0)
+        return ret;
+    hnd->cb(hnd->cls, &route, req, res);
+    return 0;
+}
+
+const char *sg_route_pattern(struct sg_route *route) {
+    if (!route) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return route->pattern;
+}
+
+const char *sg_route_param(struct sg_route *route, const char *name, size_t *len) {
+    unsigned int i;
+    if (!route || !name || !len) {
+        errno = EINVAL;
+        return NULL;
+    }
+    for (i = 0; i < route->count; i++)
+        if (strcmp(route->params[i].name, name) == 0) {
+            *len = route->params[i].len;
+            return route->params[i].val;
+        }
+    return NULL;
+}
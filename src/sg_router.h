@@ -0,0 +1,90 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SG_ROUTER_H
+#define SG_ROUTER_H
+
+#include <stddef.h>
+#include "sg_macros.h"
+#include "sagui.h"
+
+/* maximum number of parameters of a route pattern, including its wildcard. */
+#define SG__ROUTER_MAX_PARAMS 16
+
+/* number of handler slots of a route: one per standard method, plus one for any method. */
+#define SG__ROUTER_METHODS 10
+
+struct sg__router_hnd {
+    struct sg__router_hnd *next;
+    sg_route_cb cb;
+    void *cls;
+    char *pattern;
+};
+
+/* node of the tree built while adding routes, freed when the router is compiled. */
+struct sg__router_bnode {
+    char *label; /* static prefix, or parameter name */
+    size_t len;
+    struct sg__router_bnode **children; /* static children, sorted by their first byte */
+    unsigned int count;
+    struct sg__router_bnode *param;
+    struct sg__router_bnode *wild;
+    struct sg__router_hnd *hnds[SG__ROUTER_METHODS];
+};
+
+/* node of the compiled tree. Nodes are stored in breadth-first order, so the static children of a node are
+ * contiguous. */
+struct sg__router_node {
+    const char *label;
+    unsigned int len;
+    unsigned int child; /* index of the first static child */
+    unsigned int count; /* number of static children */
+    unsigned int param; /* index of the parameter child, 0 if none */
+    unsigned int wild; /* index of the wildcard child, 0 if none */
+    int slots; /* index of the handler slots, -1 if none */
+};
+
+struct sg_router {
+    struct sg__router_bnode *root;
+    struct sg__router_hnd *hnds;
+    struct sg__router_node *nodes;
+    struct sg__router_hnd **slots; /* `SG__ROUTER_METHODS` slots per node having handlers */
+    char *labels;
+};
+
+/* matched route, kept in the stack of the dispatching thread. */
+struct sg_route {
+    const char *pattern;
+    struct {
+        const char *name;
+        const char *val; /* points to the request path */
+        size_t len;
+    } params[SG__ROUTER_MAX_PARAMS];
+    unsigned int count;
+};
+
+#endif /* SG_ROUTER_H */
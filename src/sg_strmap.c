@@ -25,33 +25,365 @@
  * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef _WIN32
+#define _CRT_RAND_S /* declares `rand_s()`, must precede the first include of `stdlib.h` */
+#endif
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <time.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#ifdef SG_HAVE_GETRANDOM
+#include <sys/random.h>
+#endif
+#endif
 #include "sg_macros.h"
 #include "sagui.h"
 #include "sg_utils.h"
 #include "sg_strmap.h"
 
-void sg__strmap_new(struct sg_strmap **pair, const char *name, const char *val) {
-    sg__new(*pair);
-    (*pair)->key = strdup(name);
-    (*pair)->name = strdup(name);
-    (*pair)->val = strdup(val);
-    if (!(*pair)->key || !(*pair)->name || !(*pair)->val) {
-        sg__strmap_free(*pair);
-        oom();
+/* folds ASCII letters to lowercase, leaving other bytes (e.g. UTF-8 sequences) untouched. */
+#define SG__STRMAP_LOWER(c) ((unsigned char) ((((c) >= 'A') && ((c) <= 'Z')) ? ((c) | 0x20) : (c)))
+
+/* per-process random key of the hash function, so clients can't craft names colliding in the tables. */
+static uint64_t sg__strmap_seed[2];
+static int sg__strmap_seeded;
+static sg__thread bool sg__strmap_seed_loaded; /* the seed was published to the calling thread */
+
+/* reads the seed from the random generator of the system. */
+static bool sg__strmap_random(uint64_t seed[2]) {
+#ifdef _WIN32
+    unsigned int parts[4];
+    unsigned char i;
+    for (i = 0; i < 4; i++)
+        if (rand_s(&parts[i]) != 0)
+            return false;
+    seed[0] = ((uint64_t) parts[0] << 32) | parts[1];
+    seed[1] = ((uint64_t) parts[2] << 32) | parts[3];
+    return true;
+#else
+    ssize_t ret;
+    int fd;
+#ifdef SG_HAVE_GETRANDOM
+    /* works without the random device, e.g. in a chroot. */
+    if (getrandom(seed, 2 * sizeof(uint64_t), 0) == (ssize_t) (2 * sizeof(uint64_t)))
+        return true;
+#endif
+    if ((fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC)) == -1)
+        return false;
+    ret = read(fd, seed, 2 * sizeof(uint64_t));
+    close(fd);
+    return ret == (ssize_t) (2 * sizeof(uint64_t));
+#endif
+}
+
+static void sg__strmap_seed_init(void) {
+    uint64_t seed[2] = {0, 0};
+    if (!__sync_bool_compare_and_swap(&sg__strmap_seeded, 0, 1)) {
+        while (sg__atomic_get(&sg__strmap_seeded) != 2)
+            ;
+        return;
+    }
+    if (!sg__strmap_random(seed)) {
+        /* last resort for systems without a random generator, guessable by a determined client. */
+        seed[0] = (uint64_t) time(NULL) * 0x9e3779b97f4a7c15u;
+        seed[1] = ((uint64_t) getpid() << 32) ^ (uint64_t) (uintptr_t) &seed;
+    }
+    sg__strmap_seed[0] = seed[0];
+    sg__strmap_seed[1] = seed[1];
+    sg__atomic_add(&sg__strmap_seeded, 1); /* publishes the seed */
+}
+
+/* makes the seed visible to the calling thread. The flag is read by an atomic, which orders the reads of the seed
+ * after it, once per thread so the lookups don't contend on it. */
+static void sg__strmap_seed_load(void) {
+    if (sg__atomic_get(&sg__strmap_seeded) != 2)
+        sg__strmap_seed_init();
+    sg__strmap_seed_loaded = true;
+}
+
+#ifdef SG_STRMAP_HASH_FNV1A
+
+/* seeded FNV-1a hash of a name, folding it to lowercase on the fly so lookups don't need a lowercase copy. Faster
+ * than SipHash on short names, but its seed doesn't fully protect against crafted collisions. */
+static uint32_t sg__strmap_hash(const char *name, size_t *len) {
+    const char *str = name;
+    uint32_t hash;
+    if (!sg__strmap_seed_loaded)
+        sg__strmap_seed_load();
+    hash = 2166136261u ^ (uint32_t) sg__strmap_seed[0];
+    for (; *str; str++) {
+        hash ^= SG__STRMAP_LOWER(*str);
+        hash *= 16777619u;
+    }
+    *len = (size_t) (str - name);
+    return hash;
+}
+
+#else
+
+#define SG__ROTL(x, b) (uint64_t) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SG__SIPROUND             \
+do {                             \
+    v0 += v1;                    \
+    v1 = SG__ROTL(v1, 13);       \
+    v1 ^= v0;                    \
+    v0 = SG__ROTL(v0, 32);       \
+    v2 += v3;                    \
+    v3 = SG__ROTL(v3, 16);       \
+    v3 ^= v2;                    \
+    v0 += v3;                    \
+    v3 = SG__ROTL(v3, 21);       \
+    v3 ^= v0;                    \
+    v2 += v1;                    \
+    v1 = SG__ROTL(v1, 17);       \
+    v1 ^= v2;                    \
+    v2 = SG__ROTL(v2, 32);       \
+} while (0)
+
+/* SipHash-1-3 of a name, folding it to lowercase on the fly so lookups don't need a lowercase copy. */
+static uint32_t sg__strmap_hash(const char *name, size_t *len) {
+    uint64_t v0, v1, v2, v3, m = 0;
+    size_t i;
+    if (!sg__strmap_seed_loaded)
+        sg__strmap_seed_load();
+    v0 = sg__strmap_seed[0] ^ 0x736f6d6570736575u;
+    v1 = sg__strmap_seed[1] ^ 0x646f72616e646f6du;
+    v2 = sg__strmap_seed[0] ^ 0x6c7967656e657261u;
+    v3 = sg__strmap_seed[1] ^ 0x7465646279746573u;
+    for (i = 0; name[i]; i++) {
+        m |= (uint64_t) SG__STRMAP_LOWER(name[i]) << ((i & 7) * 8);
+        if ((i & 7) == 7) {
+            v3 ^= m;
+            SG__SIPROUND;
+            v0 ^= m;
+            m = 0;
+        }
+    }
+    m |= (uint64_t) i << 56;
+    v3 ^= m;
+    SG__SIPROUND;
+    v0 ^= m;
+    v2 ^= 0xff;
+    SG__SIPROUND;
+    SG__SIPROUND;
+    SG__SIPROUND;
+    *len = i;
+    return (uint32_t) (v0 ^ v1 ^ v2 ^ v3);
+}
+
+#undef SG__SIPROUND
+#undef SG__ROTL
+
+#endif
+
+/* points the strings of a pair to its allocation, after creating or moving it. */
+static void sg__strmap_fix(struct sg_strmap *pair) {
+    pair->key = (char *) (pair + 1);
+    pair->name = pair->key + pair->len + 1;
+    pair->val = pair->name + pair->len + 1;
+}
+
+static void sg__strmap_place(struct sg__strmap_tbl *tbl, struct sg_strmap *pair) {
+    const unsigned int mask = tbl->size - 1;
+    unsigned int i = pair->hash & mask;
+    while (tbl->bkts[i].pair)
+        i = (i + 1) & mask;
+    tbl->bkts[i].pair = pair;
+    tbl->bkts[i].hash = pair->hash;
+}
+
+static void sg__strmap_rehash(struct sg__strmap_tbl *tbl, unsigned int size) {
+    struct sg__strmap_bkt *bkts = tbl->bkts;
+    unsigned int i, old_size = tbl->size;
+    sg__alloc(tbl->bkts, size * sizeof(struct sg__strmap_bkt));
+    tbl->size = size;
+    for (i = 0; i < old_size; i++)
+        if (bkts[i].pair)
+            sg__strmap_place(tbl, bkts[i].pair);
+    sg__free(bkts);
+}
+
+/* compares a name to a lowercase key, ignoring the case of the name. */
+static bool sg__strmap_eq(const char *key, const char *name, size_t len) {
+    size_t i;
+    for (i = 0; i < len; i++)
+        if ((unsigned char) key[i] != SG__STRMAP_LOWER(name[i]))
+            return false;
+    return true;
+}
+
+/* finds the bucket of the values of a name (or key) already hashed, returning `-1` if it is not found. */
+static int sg__strmap_probe(struct sg__strmap_tbl *tbl, const char *name, size_t len, uint32_t hash) {
+    const unsigned int mask = tbl->size - 1;
+    struct sg_strmap *pair;
+    unsigned int i = hash & mask;
+    while ((pair = tbl->bkts[i].pair)) {
+        if ((tbl->bkts[i].hash == hash) && (pair->len == len) && sg__strmap_eq(pair->key, name, len))
+            return (int) i;
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+/* finds the bucket of the values of a name matching it case-insensitively, returning `-1` if it is not found. */
+static int sg__strmap_lookup(struct sg__strmap_tbl *tbl, const char *name) {
+    size_t len;
+    const uint32_t hash = sg__strmap_hash(name, &len);
+    return sg__strmap_probe(tbl, name, len, hash);
+}
+
+/* removes the first value of a bucket. The bucket is freed when its last value is removed, shifting back the
+ * following buckets of the cluster instead of leaving tombstones. */
+static struct sg_strmap *sg__strmap_unlink(struct sg_strmap **map, unsigned int i) {
+    struct sg__strmap_tbl *tbl = (*map)->tbl;
+    struct sg_strmap *pair = tbl->bkts[i].pair;
+    const unsigned int mask = tbl->size - 1;
+    unsigned int j, k;
+    if (pair->dup) {
+        pair->dup->dup_last = pair->dup_last;
+        tbl->bkts[i].pair = pair->dup;
+    } else {
+        for (j = (i + 1) & mask; tbl->bkts[j].pair; j = (j + 1) & mask) {
+            k = tbl->bkts[j].hash & mask;
+            /* a bucket can't move before its home position. */
+            if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+                continue;
+            tbl->bkts[i] = tbl->bkts[j];
+            i = j;
+        }
+        tbl->bkts[i].pair = NULL;
+        tbl->keys--;
     }
-    sg__toasciilower((*pair)->key);
+    if (pair->prev)
+        pair->prev->next = pair->next;
+    else
+        *map = pair->next;
+    if (pair->next)
+        pair->next->prev = pair->prev;
+    else
+        tbl->tail = pair->prev;
+    if (--tbl->count == 0) {
+        sg__free(tbl->bkts);
+        sg__free(tbl);
+    }
+    pair->prev = pair->next = pair->dup = pair->dup_last = NULL;
+    pair->tbl = NULL;
+    return pair;
+}
+
+void sg__strmap_new(struct sg_strmap **pair, const char *name, const char *val) {
+    const size_t val_len = strlen(val);
+    size_t len, i;
+    const uint32_t hash = sg__strmap_hash(name, &len);
+    sg__alloc(*pair, sizeof(struct sg_strmap) + ((len + 1) * 2) + val_len + 1);
+    (*pair)->len = len;
+    (*pair)->val_len = val_len;
+    (*pair)->hash = hash;
+    sg__strmap_fix(*pair);
+    for (i = 0; i <= len; i++)
+        (*pair)->key[i] = (char) SG__STRMAP_LOWER(name[i]);
+    memcpy((*pair)->name, name, len + 1);
+    memcpy((*pair)->val, val, val_len + 1);
 }
 
 void sg__strmap_free(struct sg_strmap *pair) {
-    if (!pair)
-        return;
-    sg__free(pair->key);
-    sg__free(pair->name);
-    sg__free(pair->val);
     sg__free(pair);
 }
 
+void sg__strmap_add(struct sg_strmap **map, struct sg_strmap *pair) {
+    struct sg__strmap_tbl *tbl;
+    struct sg_strmap *first = NULL;
+    int i;
+    if (*map) {
+        tbl = (*map)->tbl;
+        if ((i = sg__strmap_probe(tbl, pair->key, pair->len, pair->hash)) != -1)
+            first = tbl->bkts[i].pair;
+        else if (((tbl->keys + 1) * 4) > (tbl->size * 3))
+            /* keeps the load factor under 3/4, so probe sequences stay short. */
+            sg__strmap_rehash(tbl, tbl->size * 2);
+        pair->prev = tbl->tail;
+        tbl->tail->next = pair;
+    } else {
+        sg__new(tbl);
+        sg__alloc(tbl->bkts, SG__STRMAP_INIT_SIZE * sizeof(struct sg__strmap_bkt));
+        tbl->size = SG__STRMAP_INIT_SIZE;
+        pair->prev = NULL;
+        *map = pair;
+    }
+    pair->next = NULL;
+    pair->dup = NULL;
+    pair->tbl = tbl;
+    tbl->tail = pair;
+    tbl->count++;
+    if (first) {
+        /* repeated names are chained to the first value instead of taking more buckets. */
+        first->dup_last->dup = pair;
+        first->dup_last = pair;
+        return;
+    }
+    pair->dup_last = pair;
+    tbl->keys++;
+    sg__strmap_place(tbl, pair);
+}
+
+struct sg_strmap *sg__strmap_append(struct sg_strmap **map, struct sg_strmap *pair, const char *data,
+                                    size_t size) {
+    struct sg_strmap *moved, *first, *prev;
+    struct sg__strmap_tbl *tbl;
+    unsigned int i;
+    if (!(moved = sg__realloc(pair, sizeof(struct sg_strmap) + ((pair->len + 1) * 2) + pair->val_len + size + 1)))
+        oom();
+    sg__strmap_fix(moved);
+    memcpy(moved->val + moved->val_len, data, size);
+    moved->val_len += size;
+    moved->val[moved->val_len] = '\0';
+    if ((moved == pair) || !moved->tbl)
+        return moved;
+    /* the pair was moved by the allocator, so its links must be updated. */
+    if (moved->prev)
+        moved->prev->next = moved;
+    else
+        *map = moved;
+    if (moved->next)
+        moved->next->prev = moved;
+    else
+        moved->tbl->tail = moved;
+    /* the old address can be compared, but not dereferenced. */
+    tbl = moved->tbl;
+    for (i = moved->hash & (tbl->size - 1);; i = (i + 1) & (tbl->size - 1)) {
+        if ((first = tbl->bkts[i].pair) == pair) {
+            tbl->bkts[i].pair = moved;
+            if (moved->dup_last == pair)
+                moved->dup_last = moved;
+            return moved;
+        }
+        if ((tbl->bkts[i].hash == moved->hash) && (first->len == moved->len) &&
+            (memcmp(first->key, moved->key, moved->len) == 0))
+            break;
+    }
+    for (prev = first; prev->dup != pair; prev = prev->dup)
+        ;
+    prev->dup = moved;
+    if (first->dup_last == pair)
+        first->dup_last = moved;
+    return moved;
+}
+
+/* memory allocated for a pair, not counting the allocator and hash table overheads. */
+size_t sg__strmap_pair_size(struct sg_strmap *pair) {
+    return sizeof(struct sg_strmap) + ((pair->len + 1) * 2) + pair->val_len + 1;
+}
+
+size_t sg__strmap_mem_size(struct sg_strmap *map) {
+    size_t size = 0;
+    for (; map; map = map->next)
+        size += sg__strmap_pair_size(map);
+    return size;
+}
+
 const char *sg_strmap_name(struct sg_strmap *pair) {
     if (!pair) {
         errno = EINVAL;
@@ -73,37 +405,57 @@ int sg_strmap_add(struct sg_strmap **map, const char *name, const char *val) {
     if (!map || !name || !val)
         return EINVAL;
     sg__strmap_new(&pair, name, val);
-    HASH_ADD_STR(*map, key, pair);
+    sg__strmap_add(map, pair);
     return 0;
 }
 
 int sg_strmap_set(struct sg_strmap **map, const char *name, const char *val) {
-    struct sg_strmap *pair, *tmp;
+    struct sg_strmap *pair;
+    int i;
     if (!map || !name || !val)
         return EINVAL;
     sg__strmap_new(&pair, name, val);
-    HASH_REPLACE_STR(*map, key, pair, tmp);
-    sg__strmap_free(tmp);
+    while (*map && ((i = sg__strmap_lookup((*map)->tbl, name)) != -1))
+        sg__strmap_free(sg__strmap_unlink(map, (unsigned int) i));
+    sg__strmap_add(map, pair);
     return 0;
 }
 
 int sg_strmap_find(struct sg_strmap *map, const char *name, struct sg_strmap **pair) {
-    char *key;
+    int i;
     if (!map || !pair || !name)
         return EINVAL;
-    key = strdup(name);
-    if (!key)
-        oom();
-    sg__toasciilower(key);
-    HASH_FIND_STR(map, key, *pair);
-    if (!*pair) {
-        sg__free(key);
+    if ((i = sg__strmap_lookup(map->tbl, name)) == -1) {
+        *pair = NULL;
         return ENOENT;
     }
-    sg__free(key);
+    *pair = map->tbl->bkts[i].pair;
+    return 0;
+}
+
+int sg_strmap_find_next(struct sg_strmap **pair) {
+    if (!pair)
+        return EINVAL;
+    *pair = *pair ? (*pair)->dup : NULL;
     return 0;
 }
 
+unsigned int sg_strmap_get_all(struct sg_strmap *map, const char *name, const char **vals, unsigned int size) {
+    struct sg_strmap *pair;
+    unsigned int count = 0;
+    int i;
+    if (!map || !name || (!vals && (size > 0))) {
+        errno = EINVAL;
+        return 0;
+    }
+    if ((i = sg__strmap_lookup(map->tbl, name)) == -1)
+        return 0;
+    for (pair = map->tbl->bkts[i].pair; pair; pair = pair->dup, count++)
+        if (count < size)
+            vals[count] = pair->val;
+    return count;
+}
+
 const char *sg_strmap_get(struct sg_strmap *map, const char *name) {
     struct sg_strmap *pair;
     if (!map || !name)
@@ -112,63 +464,249 @@ const char *sg_strmap_get(struct sg_strmap *map, const char *name) {
 }
 
 int sg_strmap_rm(struct sg_strmap **map, const char *name) {
-    struct sg_strmap *pair;
-    char *key;
+    int i;
     if (!map || !name)
         return EINVAL;
-    if (!(key = strdup(name)))
-        oom();
-    sg__toasciilower(key);
-    HASH_FIND_STR(*map, key, pair);
-    if (!pair) {
-        sg__free(key);
+    if (!*map || ((i = sg__strmap_lookup((*map)->tbl, name)) == -1))
         return ENOENT;
-    }
-    sg__free(key);
-    HASH_DELETE_HH(hh, *map, &pair->hh);
-    sg__strmap_free(pair);
+    sg__strmap_free(sg__strmap_unlink(map, (unsigned int) i));
     return 0;
 }
 
 int sg_strmap_iter(struct sg_strmap *map, sg_strmap_iter_cb cb, void *cls) {
-    struct sg_strmap *pair, *tmp;
+    struct sg_strmap *next;
     int ret;
     if (!map || !cb)
         return EINVAL;
-    HASH_ITER(hh, map, pair, tmp) {
-        if ((ret = cb(cls, pair)) != 0)
+    for (; map; map = next) {
+        next = map->next; /* allows the callback to remove the current pair */
+        if ((ret = cb(cls, map)) != 0)
             return ret;
     }
     return 0;
 }
 
 int sg_strmap_sort(struct sg_strmap **map, sg_strmap_sort_cb cb, void *cls) {
+    struct sg_strmap *list, *head, *tail, *a, *b, *pair;
+    size_t width, a_len, b_len;
+    bool merged;
     if (!map || !cb)
         return EINVAL;
-#define SG_STRMAP_CMP(a, b) cb(cls, a, b)
-    HASH_SORT(*map, SG_STRMAP_CMP);
-#undef SG_STRMAP_CMP
+    if (!*map)
+        return 0;
+    /* stable bottom-up merge sort of the insertion order list, the buckets are left untouched. */
+    list = *map;
+    width = 1;
+    do {
+        head = tail = NULL;
+        merged = false;
+        a = list;
+        while (a) {
+            b = a;
+            for (a_len = 0; b && (a_len < width); a_len++)
+                b = b->next;
+            if (b)
+                merged = true;
+            b_len = width;
+            while ((a_len > 0) || ((b_len > 0) && b)) {
+                if ((a_len == 0) || ((b_len > 0) && b && (cb(cls, a, b) > 0))) {
+                    pair = b;
+                    b = b->next;
+                    b_len--;
+                } else {
+                    pair = a;
+                    a = a->next;
+                    a_len--;
+                }
+                if (tail)
+                    tail->next = pair;
+                else
+                    head = pair;
+                pair->prev = tail;
+                tail = pair;
+            }
+            a = b;
+        }
+        tail->next = NULL;
+        list = head;
+        width *= 2;
+    } while (merged);
+    *map = list;
+    list->tbl->tail = tail;
     return 0;
 }
 
 unsigned int sg_strmap_count(struct sg_strmap *map) {
-    return HASH_COUNT(map);
+    return (map && map->tbl) ? map->tbl->count : 0;
 }
 
 int sg_strmap_next(struct sg_strmap **next) {
     if (!next)
         return EINVAL;
-    *next = *next ? (*next)->hh.next : NULL;
+    *next = *next ? (*next)->next : NULL;
     return 0;
 }
 
 void sg_strmap_cleanup(struct sg_strmap **map) {
     struct sg_strmap *pair, *tmp;
+    struct sg__strmap_tbl *tbl;
     if (map && *map) {
-        HASH_ITER(hh, *map, pair, tmp) {
-            HASH_DEL(*map, pair);
+        tbl = (*map)->tbl;
+        for (pair = *map; pair; pair = tmp) {
+            tmp = pair->next;
             sg__strmap_free(pair);
         }
+        if (tbl) {
+            sg__free(tbl->bkts);
+            sg__free(tbl);
+        }
         *map = NULL;
     }
 }
+
+int sg_strmap_freeze(struct sg_strmap *map, struct sg_strmap_snap **snap) {
+    struct sg_strmap *pair, *frozen;
+    struct sg__strmap_tbl *tbl;
+    unsigned int count = 0, keys = 0, size = 2;
+    size_t data = 0;
+    char *str;
+    int i;
+    if (!snap)
+        return EINVAL;
+    if (map) {
+        count = map->tbl->count;
+        keys = map->tbl->keys;
+    }
+    /* the table never grows, so it is sized to keep the load factor under 1/2 and the probe sequences short. */
+    while (size < (keys * 2))
+        size *= 2;
+    for (pair = map; pair; pair = pair->next)
+        data += ((pair->len + 1) * 2) + pair->val_len + 1;
+    sg__alloc(*snap, sizeof(struct sg_strmap_snap) + (count * sizeof(struct sg_strmap)) +
+                     (size * sizeof(struct sg__strmap_bkt)) + data);
+    (*snap)->pairs = (struct sg_strmap *) (*snap + 1);
+    (*snap)->refs = 1;
+    tbl = &(*snap)->tbl;
+    tbl->bkts = (struct sg__strmap_bkt *) ((*snap)->pairs + count);
+    tbl->size = size;
+    str = (char *) (tbl->bkts + size);
+    for (pair = map; pair; pair = pair->next) {
+        frozen = (*snap)->pairs + tbl->count;
+        frozen->len = pair->len;
+        frozen->val_len = pair->val_len;
+        frozen->hash = pair->hash;
+        frozen->tbl = tbl;
+        frozen->key = str;
+        memcpy(frozen->key, pair->key, pair->len + 1);
+        frozen->name = frozen->key + frozen->len + 1;
+        memcpy(frozen->name, pair->name, pair->len + 1);
+        frozen->val = frozen->name + frozen->len + 1;
+        memcpy(frozen->val, pair->val, pair->val_len + 1);
+        str = frozen->val + frozen->val_len + 1;
+        if (tbl->tail) {
+            frozen->prev = tbl->tail;
+            tbl->tail->next = frozen;
+        }
+        tbl->tail = frozen;
+        tbl->count++;
+        if ((i = sg__strmap_probe(tbl, frozen->key, frozen->len, frozen->hash)) != -1) {
+            tbl->bkts[i].pair->dup_last->dup = frozen;
+            tbl->bkts[i].pair->dup_last = frozen;
+            continue;
+        }
+        frozen->dup_last = frozen;
+        tbl->keys++;
+        sg__strmap_place(tbl, frozen);
+    }
+    return 0;
+}
+
+int sg_strmap_snap_find(struct sg_strmap_snap *snap, const char *name, struct sg_strmap **pair) {
+    int i;
+    if (!snap || !name || !pair)
+        return EINVAL;
+    if ((i = sg__strmap_lookup(&snap->tbl, name)) == -1) {
+        *pair = NULL;
+        return ENOENT;
+    }
+    *pair = snap->tbl.bkts[i].pair;
+    return 0;
+}
+
+const char *sg_strmap_snap_get(struct sg_strmap_snap *snap, const char *name) {
+    struct sg_strmap *pair;
+    if (!snap || !name)
+        return NULL;
+    return sg_strmap_snap_find(snap, name, &pair) == 0 ? pair->val : NULL;
+}
+
+int sg_strmap_snap_iter(struct sg_strmap_snap *snap, sg_strmap_iter_cb cb, void *cls) {
+    unsigned int i;
+    int ret;
+    if (!snap || !cb)
+        return EINVAL;
+    for (i = 0; i < snap->tbl.count; i++)
+        if ((ret = cb(cls, snap->pairs + i)) != 0)
+            return ret;
+    return 0;
+}
+
+unsigned int sg_strmap_snap_count(struct sg_strmap_snap *snap) {
+    return snap ? snap->tbl.count : 0;
+}
+
+void sg_strmap_snap_release(struct sg_strmap_snap *snap) {
+    if (snap && (sg__atomic_sub(&snap->refs, 1) == 0))
+        sg__free(snap);
+}
+
+struct sg_strmap_shared *sg_strmap_shared_new(struct sg_strmap_snap *snap) {
+    struct sg_strmap_shared *shared;
+    sg__new(shared);
+    shared->snap = snap;
+    return shared;
+}
+
+void sg_strmap_shared_free(struct sg_strmap_shared *shared) {
+    if (!shared)
+        return;
+    sg_strmap_snap_release(shared->snap);
+    sg__free(shared);
+}
+
+struct sg_strmap_snap *sg_strmap_shared_acquire(struct sg_strmap_shared *shared) {
+    struct sg_strmap_snap *snap;
+    unsigned int epoch;
+    if (!shared) {
+        errno = EINVAL;
+        return NULL;
+    }
+    /* the reader is counted while it references the snapshot, so a writer can't free it in the meantime. */
+    epoch = sg__atomic_get(&shared->epoch) & 1;
+    sg__atomic_add(&shared->readers[epoch], 1);
+    if ((snap = __sync_val_compare_and_swap(&shared->snap, NULL, NULL)))
+        sg__atomic_add(&snap->refs, 1);
+    sg__atomic_sub(&shared->readers[epoch], 1);
+    return snap;
+}
+
+int sg_strmap_shared_swap(struct sg_strmap_shared *shared, struct sg_strmap_snap *snap) {
+    struct sg_strmap_snap *old, *cur;
+    unsigned int i, epoch;
+    if (!shared)
+        return EINVAL;
+    sg__spin_lock(&shared->lock);
+    /* a compare-and-swap is a full barrier, so the new snapshot is entirely visible to the readers loading it. */
+    for (old = NULL; (cur = __sync_val_compare_and_swap(&shared->snap, old, snap)) != old;)
+        old = cur;
+    /* waits for the readers which could have loaded the old snapshot without referencing it yet. The epoch is flipped
+     * twice, so readers arriving after the swap never delay the writer, even under constant load. */
+    for (i = 0; i < 2; i++) {
+        epoch = (sg__atomic_add(&shared->epoch, 1) - 1) & 1;
+        while (sg__atomic_get(&shared->readers[epoch]) != 0)
+            ;
+    }
+    sg__spin_unlock(&shared->lock);
+    sg_strmap_snap_release(old);
+    return 0;
+}
@@ -28,16 +28,65 @@
 #ifndef SG_STRMAP_H
 #define SG_STRMAP_H
 
-#include "uthash.h"
+#include <stddef.h>
+#include <stdint.h>
 #include "sg_macros.h"
 
+/* initial number of buckets of a map, enough for most sets of request headers without growing. */
+#define SG__STRMAP_INIT_SIZE 32
+
+struct sg__strmap_bkt {
+    struct sg_strmap *pair;
+    uint32_t hash;
+};
+
+/* open-addressing table (linear probing) shared by all the pairs of a map. */
+struct sg__strmap_tbl {
+    struct sg__strmap_bkt *bkts;
+    struct sg_strmap *tail;
+    unsigned int size; /* power of two */
+    unsigned int count; /* number of pairs */
+    unsigned int keys; /* number of used buckets, i.e. distinct keys */
+};
+
+/* the key, name and value of a pair are stored in the same allocation, just after the pair. Pairs with the same key
+ * share a bucket, which points to the first one. */
 struct sg_strmap {
     char *key, *name, *val;
-    UT_hash_handle hh;
+    size_t len; /* length of the key and name */
+    size_t val_len;
+    struct sg_strmap *prev, *next; /* insertion order */
+    struct sg_strmap *dup; /* next pair with the same key */
+    struct sg_strmap *dup_last; /* last pair with the same key, only set in the first one */
+    struct sg__strmap_tbl *tbl;
+    uint32_t hash;
+};
+
+/* read-only copy of a map in a single allocation: the snapshot, its pairs, its buckets and then their strings. */
+struct sg_strmap_snap {
+    struct sg__strmap_tbl tbl;
+    struct sg_strmap *pairs;
+    unsigned int refs;
+};
+
+struct sg_strmap_shared {
+    struct sg_strmap_snap *snap;
+    unsigned int readers[2]; /* readers acquiring a snapshot, per epoch */
+    unsigned int epoch;
+    int lock; /* serializes the writers */
 };
 
 SG__EXTERN void sg__strmap_new(struct sg_strmap **pair, const char *name, const char *val);
 
 SG__EXTERN void sg__strmap_free(struct sg_strmap *pair);
 
+SG__EXTERN void sg__strmap_add(struct sg_strmap **map, struct sg_strmap *pair);
+
+SG__EXTERN struct sg_strmap *sg__strmap_append(struct sg_strmap **map, struct sg_strmap *pair, const char *data,
+                                               size_t size);
+
+SG__EXTERN size_t sg__strmap_pair_size(struct sg_strmap *pair);
+
+SG__EXTERN size_t sg__strmap_mem_size(struct sg_strmap *map);
+
 #endif /* SG_STRMAP_H */
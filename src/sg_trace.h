@@ -0,0 +1,63 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SG_TRACE_H
+#define SG_TRACE_H
+
+/*
+ * Static user-level tracepoints (USDT) for tools like `perf`, `bpftrace` and SystemTap, enabled by the `SG_TRACING`
+ * build option. The probes belong to the `sagui` provider, e.g.:
+ *
+ *   bpftrace -e 'usdt:./libsagui.so:sagui:handler__exit { printf("%d\n", arg1); }'
+ *
+ * Probes and their arguments:
+ *
+ *   request__new(req, method, path)       - request created, headers parsed;
+ *   auth__dispatch(req, passed)           - authentication callback dispatched;
+ *   upload__chunk(req, filename, off, size) - chunk of an uploaded file received;
+ *   handler__entry(req, method, path)     - request callback called;
+ *   handler__exit(req, status)            - request callback returned;
+ *   response__dispatch(res, status, size, ret) - response queued;
+ *   request__done(req, toe)               - request completed (`MHD_RequestTerminationCode`).
+ *
+ * When tracing is disabled (default), the macros below expand to nothing and cost nothing.
+ */
+
+#ifdef SG_TRACING
+#include <sys/sdt.h>
+#define sg__trace1(probe, a1) DTRACE_PROBE1(sagui, probe, a1)
+#define sg__trace2(probe, a1, a2) DTRACE_PROBE2(sagui, probe, a1, a2)
+#define sg__trace3(probe, a1, a2, a3) DTRACE_PROBE3(sagui, probe, a1, a2, a3)
+#define sg__trace4(probe, a1, a2, a3, a4) DTRACE_PROBE4(sagui, probe, a1, a2, a3, a4)
+#else
+#define sg__trace1(probe, a1) do {} while (0)
+#define sg__trace2(probe, a1, a2) do {} while (0)
+#define sg__trace3(probe, a1, a2, a3) do {} while (0)
+#define sg__trace4(probe, a1, a2, a3, a4) do {} while (0)
+#endif
+
+#endif /* SG_TRACE_H */
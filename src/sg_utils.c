@@ -36,6 +36,10 @@
 #include <string.h>
 #include <errno.h>
 #include <ctype.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <time.h>
+#endif
 #include "sg_macros.h"
 #include "sagui.h"
 #include "sg_utils.h"
@@ -117,7 +121,14 @@ char *basename(const char *path) {
 #endif
 
 char *sg__strdup(const char *str) {
-    return str ? strdup(str) : NULL;
+    char *dup;
+    size_t size;
+    if (!str)
+        return NULL;
+    size = strlen(str) + 1;
+    if ((dup = sg__malloc(size)))
+        memcpy(dup, str, size);
+    return dup;
 }
 
 void sg__toasciilower(char *str) {
@@ -172,6 +183,53 @@ bool sg__is_cookie_val(const char *val) {
     return true;
 }
 
+/* checks if a header name is a token, as defined in RFC 7230. */
+bool sg__is_header_name(const char *name) {
+    if (!*name)
+        return false;
+    while (*name) {
+        if (!isascii(*name) || (!isalnum(*name) && !strchr("!#$%&'*+-.^_`|~", *name)))
+            return false;
+        name++;
+    }
+    return true;
+}
+
+/* checks if a header value can't break the response, i.e. it has no line breaks or other control characters. */
+bool sg__is_header_val(const char *val) {
+    while (*val) {
+        if ((*val != '\t') && isascii(*val) && iscntrl(*val))
+            return false;
+        val++;
+    }
+    return true;
+}
+
+uint64_t sg__monotonic(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (uint64_t) ((count.QuadPart / freq.QuadPart) * 1000000 +
+                       ((count.QuadPart % freq.QuadPart) * 1000000) / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000) + ((uint64_t) ts.tv_nsec / 1000);
+#endif
+}
+
+void sg__usleep(uint64_t usec) {
+#ifdef _WIN32
+    Sleep((DWORD) ((usec + 999) / 1000));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t) (usec / 1000000);
+    ts.tv_nsec = (long) ((usec % 1000000) * 1000);
+    while ((nanosleep(&ts, &ts) == -1) && (errno == EINTR));
+#endif
+}
+
 /* Version. */
 
 unsigned int sg_version(void) {
@@ -184,6 +242,38 @@ const char *sg_version_str(void) {
 
 /* Memory. */
 
+static sg_malloc_cb sg__malloc_cb = malloc;
+
+static sg_realloc_cb sg__realloc_cb = realloc;
+
+static sg_free_cb sg__free_cb = free;
+
+void *sg__mem_malloc(size_t size) {
+    return sg__malloc_cb(size);
+}
+
+void *sg__mem_realloc(void *ptr, size_t size) {
+    return sg__realloc_cb(ptr, size);
+}
+
+void sg__mem_free(void *ptr) {
+    if (ptr)
+        sg__free_cb(ptr);
+}
+
+int sg_set_allocator(sg_malloc_cb malloc_cb, sg_realloc_cb realloc_cb, sg_free_cb free_cb) {
+    if (!malloc_cb && !realloc_cb && !free_cb) {
+        malloc_cb = malloc;
+        realloc_cb = realloc;
+        free_cb = free;
+    } else if (!malloc_cb || !realloc_cb || !free_cb)
+        return EINVAL;
+    sg__malloc_cb = malloc_cb;
+    sg__realloc_cb = realloc_cb;
+    sg__free_cb = free_cb;
+    return 0;
+}
+
 void *sg_alloc(size_t size) {
     void *ptr;
     sg__alloc(ptr, size);
@@ -232,6 +322,23 @@ char *sg_strerror(int errnum, char *errmsg, size_t errlen) {
 #endif
 }
 
+struct sg_err *sg_err_dup(const struct sg_err *err) {
+    struct sg_err *dup;
+    size_t len;
+    if (!err) {
+        errno = EINVAL;
+        return NULL;
+    }
+    len = err->msg ? strlen(err->msg) + 1 : 0;
+    sg__alloc(dup, sizeof(struct sg_err) + len);
+    memcpy(dup, err, sizeof(struct sg_err));
+    if (err->msg) {
+        memcpy(dup + 1, err->msg, len);
+        dup->msg = (const char *) (dup + 1);
+    }
+    return dup;
+}
+
 bool sg_is_post(const char *method) {
     const char *mts[] = {"POST", "PUT", "DELETE", "OPTIONS", NULL};
     const char **mt;
@@ -279,7 +386,7 @@ while (0)
     buf = "/tmp";
 #endif
 done:
-    buf = strdup(buf);
+    buf = sg__strdup(buf);
     if (!buf)
         return NULL;
     len = strlen(buf);
@@ -289,3 +396,35 @@ done:
     return buf;
 #endif
 }
+
+/* Network. */
+
+int sg_inherited_fd(void) {
+#ifdef _WIN32
+    errno = ENOSYS;
+    return -1;
+#else
+    const char *env;
+    char *end;
+    long val;
+    if ((env = getenv("LISTEN_PID"))) {
+        errno = 0;
+        val = strtol(env, &end, 10);
+        if ((errno != 0) || (*end != '\0') || (val != (long) getpid())) {
+            errno = ENOENT;
+            return -1;
+        }
+    }
+    if (!(env = getenv("LISTEN_FDS"))) {
+        errno = ENOENT;
+        return -1;
+    }
+    errno = 0;
+    val = strtol(env, &end, 10);
+    if ((errno != 0) || (*end != '\0') || (val < 1)) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 3; /* SD_LISTEN_FDS_START */
+#endif
+}
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #endif
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include "sg_macros.h"
 
@@ -60,4 +61,14 @@ SG__EXTERN bool sg__is_cookie_name(const char *name);
 
 SG__EXTERN bool sg__is_cookie_val(const char *val);
 
+SG__EXTERN bool sg__is_header_name(const char *name);
+
+SG__EXTERN bool sg__is_header_val(const char *val);
+
+/* Returns a monotonic time (in microseconds). */
+SG__EXTERN uint64_t sg__monotonic(void);
+
+/* Suspends the calling thread for (at least) `usec` microseconds. */
+SG__EXTERN void sg__usleep(uint64_t usec);
+
 #endif /* SG_UTILS_H */
@@ -43,6 +43,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define oom() exit(-1)
 #endif
 
+#ifndef utstring_malloc
+#define utstring_malloc(sz) malloc(sz)
+#endif
+#ifndef utstring_realloc
+#define utstring_realloc(ptr,sz) realloc(ptr,sz)
+#endif
+#ifndef utstring_dealloc
+#define utstring_dealloc(ptr) free(ptr)
+#endif
+
 typedef struct {
     char *d;  /* pointer to allocated buffer */
     size_t n; /* allocated capacity */
@@ -52,7 +62,7 @@ typedef struct {
 #define utstring_reserve(s,amt)                            \
 do {                                                       \
   if (((s)->n - (s)->i) < (size_t)(amt)) {                 \
-    char *utstring_tmp = (char*)realloc(                   \
+    char *utstring_tmp = (char*)utstring_realloc(          \
       (s)->d, (s)->n + (amt));                             \
     if (utstring_tmp == NULL) oom();                       \
     (s)->d = utstring_tmp;                                 \
@@ -69,19 +79,19 @@ do {                                                       \
 
 #define utstring_done(s)                                   \
 do {                                                       \
-  if ((s)->d != NULL) free((s)->d);                        \
+  if ((s)->d != NULL) utstring_dealloc((s)->d);            \
   (s)->n = 0;                                              \
 } while(0)
 
 #define utstring_free(s)                                   \
 do {                                                       \
   utstring_done(s);                                        \
-  free(s);                                                 \
+  utstring_dealloc(s);                                     \
 } while(0)
 
 #define utstring_new(s)                                    \
 do {                                                       \
-   (s) = (UT_string*)malloc(sizeof(UT_string));            \
+   (s) = (UT_string*)utstring_malloc(sizeof(UT_string));   \
    if (!(s)) oom();                                        \
    utstring_init(s);                                       \
 } while(0)
@@ -328,7 +338,7 @@ UTSTRING_UNUSED static long utstring_find(
     V_HaystackLen = s->i - V_StartPosition;
     if ( (V_HaystackLen >= (long) P_NeedleLen) && (P_NeedleLen > 0) )
     {
-        V_KMP_Table = (long *)malloc(sizeof(long) * (P_NeedleLen + 1));
+        V_KMP_Table = (long *)utstring_malloc(sizeof(long) * (P_NeedleLen + 1));
         if (V_KMP_Table != NULL)
         {
             _utstring_BuildTable(P_Needle, P_NeedleLen, V_KMP_Table);
@@ -343,7 +353,7 @@ UTSTRING_UNUSED static long utstring_find(
                 V_FindPosition += V_StartPosition;
             }
 
-            free(V_KMP_Table);
+            utstring_dealloc(V_KMP_Table);
         }
     }
 
@@ -374,7 +384,7 @@ UTSTRING_UNUSED static long utstring_findR(
     V_HaystackLen = V_StartPosition + 1;
     if ( (V_HaystackLen >= (long) P_NeedleLen) && (P_NeedleLen > 0) )
     {
-        V_KMP_Table = (long *)malloc(sizeof(long) * (P_NeedleLen + 1));
+        V_KMP_Table = (long *)utstring_malloc(sizeof(long) * (P_NeedleLen + 1));
         if (V_KMP_Table != NULL)
         {
             _utstring_BuildTableR(P_Needle, P_NeedleLen, V_KMP_Table);
@@ -385,7 +395,7 @@ UTSTRING_UNUSED static long utstring_findR(
                                              P_NeedleLen,
                                              V_KMP_Table);
 
-            free(V_KMP_Table);
+            utstring_dealloc(V_KMP_Table);
         }
     }
 
@@ -0,0 +1,107 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Measures the throughput of sg_strmap under a hash flooding workload: names colliding in the low bits of the
+ * unseeded FNV-1a hash (i.e. all of them in the same bucket of a table hashed without a seed) are compared to random
+ * names. With a seeded hash both workloads should run at about the same speed.
+ *
+ * Usage: bench_strmap [count]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sagui.h>
+
+#define FLOOD_MASK 8191
+
+static uint32_t fnv1a(const char *str) {
+    uint32_t hash = 2166136261u;
+    for (; *str; str++) {
+        hash ^= (unsigned char) *str;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static char **make_names(unsigned int count, int flood) {
+    char **names = malloc(count * sizeof(char *)), name[32];
+    unsigned int i = 0, seq = 0;
+    if (!names)
+        return NULL;
+    while (i < count) {
+        snprintf(name, sizeof(name), "x-%08x", flood ? seq++ : (unsigned int) rand());
+        if (flood && ((fnv1a(name) & FLOOD_MASK) != 0))
+            continue;
+        if (!(names[i++] = strdup(name)))
+            return NULL;
+    }
+    return names;
+}
+
+static void run(const char *label, char **names, unsigned int count) {
+    struct sg_strmap *map = NULL;
+    clock_t start;
+    double add, find;
+    unsigned int i;
+    start = clock();
+    for (i = 0; i < count; i++)
+        sg_strmap_add(&map, names[i], "1");
+    add = (double) (clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    for (i = 0; i < count; i++)
+        if (!sg_strmap_get(map, names[i]))
+            abort();
+    find = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%-8s %8u names  add: %10.0f ops/s  find: %10.0f ops/s\n", label, count,
+           add > 0 ? count / add : 0, find > 0 ? count / find : 0);
+    sg_strmap_cleanup(&map);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int count = (argc > 1) ? (unsigned int) strtoul(argv[1], NULL, 10) : 4000, i;
+    char **random_names, **flood_names;
+    if ((count == 0) || (count > FLOOD_MASK)) {
+        fprintf(stderr, "count must be between 1 and %d\n", FLOOD_MASK);
+        return EXIT_FAILURE;
+    }
+    srand((unsigned int) time(NULL));
+    if (!(random_names = make_names(count, 0)) || !(flood_names = make_names(count, 1)))
+        return EXIT_FAILURE;
+    run("random", random_names, count);
+    run("flood", flood_names, count);
+    for (i = 0; i < count; i++) {
+        free(random_names[i]);
+        free(flood_names[i]);
+    }
+    free(random_names);
+    free(flood_names);
+    return EXIT_SUCCESS;
+}
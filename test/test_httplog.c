@@ -0,0 +1,181 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sagui.h>
+#include "sg_httplog.c"
+
+static bool ends_with(const char *rec, size_t len, const char *suffix) {
+    size_t n = strlen(suffix);
+    return (len >= n) && (memcmp(rec + len - n, suffix, n) == 0);
+}
+
+static void test__httplog_esc(void) {
+    char rec[16];
+    size_t len = 0;
+    sg__httplog_esc(rec, sizeof(rec), &len, "a\"\\\x01", false);
+    ASSERT(len == 9);
+    ASSERT(memcmp(rec, "a\\\"\\\\\\x01", len) == 0);
+    len = 0;
+    sg__httplog_esc(rec, sizeof(rec), &len, "a\"\\\x01", true);
+    ASSERT(len == 11);
+    ASSERT(memcmp(rec, "a\\\"\\\\\\u0001", len) == 0);
+    len = 0;
+    sg__httplog_esc(rec, sizeof(rec), &len, "\xc3\xa1", true);
+    ASSERT(len == 2);
+    sg__httplog_esc(rec, sizeof(rec), &len, "\xc3\xa1", false);
+    ASSERT(len == 10);
+    ASSERT(memcmp(rec + 2, "\\xc3\\xa1", 8) == 0);
+    len = 0;
+    sg__httplog_esc(rec, sizeof(rec), &len, "0123456789\x01", true);
+    ASSERT(len == 10);
+}
+
+static void test__httplog_format(void) {
+    struct sg__httplog_ring ring;
+    struct sg_httpreq *req = sg__httpreq_new(NULL, "HTTP/1.1", "GET", "/foo\"bar");
+    char rec[SG__HTTPLOG_REC_SIZE];
+    size_t len;
+    memset(&ring, 0, sizeof(struct sg__httplog_ring));
+    req->res->status = 200;
+    req->res->size = 123;
+
+    len = sg__httplog_format(SG_HTTPSRV_LOG_COMMON, &ring, req, 42, rec, sizeof(rec));
+    ASSERT(ring.time > 0);
+    ASSERT(memcmp(rec, "- - - [", 7) == 0);
+    ASSERT(ends_with(rec, len, "] \"GET /foo\\\"bar HTTP/1.1\" 200 123\n"));
+    req->res->size = 0;
+    len = sg__httplog_format(SG_HTTPSRV_LOG_COMMON, &ring, req, 42, rec, sizeof(rec));
+    ASSERT(ends_with(rec, len, "\" 200 -\n"));
+
+    len = sg__httplog_format(SG_HTTPSRV_LOG_COMBINED, &ring, req, 42, rec, sizeof(rec));
+    ASSERT(ends_with(rec, len, "\" 200 - \"-\" \"-\"\n"));
+
+    req->res->size = 123;
+    len = sg__httplog_format(SG_HTTPSRV_LOG_JSON, &ring, req, 42, rec, sizeof(rec));
+    ASSERT(memcmp(rec, "{\"time\":\"", 9) == 0);
+    ASSERT(ends_with(rec, len, "\",\"remote\":null,\"user\":null,\"method\":\"GET\",\"path\":\"/foo\\\"bar\","
+                               "\"version\":\"HTTP/1.1\",\"status\":200,\"bytes\":123,\"referer\":null,"
+                               "\"user_agent\":null,\"duration_us\":42}\n"));
+
+    len = sg__httplog_format(SG_HTTPSRV_LOG_COMMON, &ring, req, 42, rec, 8);
+    ASSERT(len == 8);
+    ASSERT(memcmp(rec, "- - - [", 7) == 0);
+    ASSERT(rec[7] == '\n');
+    sg__httpreq_free(req);
+}
+
+static void test__httplog_push(void) {
+    struct sg__httplog_ring ring;
+    char rec[1000];
+    size_t i;
+    memset(&ring, 0, sizeof(struct sg__httplog_ring));
+    memset(rec, 'a', sizeof(rec));
+    for (i = 0; i < (SG__HTTPLOG_RING_SIZE / sizeof(rec)); i++)
+        ASSERT(sg__httplog_push(&ring, rec, sizeof(rec)));
+    ASSERT(ring.buf);
+    ASSERT(ring.head == (i * sizeof(rec)));
+    ASSERT(!sg__httplog_push(&ring, rec, sizeof(rec)));
+    ASSERT(ring.dropped == 1);
+    ASSERT(ring.head == (i * sizeof(rec)));
+    ring.tail = ring.head;
+    rec[0] = 'b';
+    rec[sizeof(rec) - 1] = 'c';
+    ASSERT(sg__httplog_push(&ring, rec, sizeof(rec)));
+    ASSERT(ring.buf[ring.tail & (SG__HTTPLOG_RING_SIZE - 1)] == 'b');
+    ASSERT(ring.buf[(ring.head - 1) & (SG__HTTPLOG_RING_SIZE - 1)] == 'c');
+    sg_free(ring.buf);
+}
+
+static void dummy_httpreq_cb(__SG_UNUSED void *cls, __SG_UNUSED struct sg_httpreq *req,
+                             __SG_UNUSED struct sg_httpres *res) {
+}
+
+static void test__httplog_new_free(void) {
+    struct sg_httpsrv *srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
+    struct sg__httplog *log;
+    struct sg__httpsrv_slot *slot, *idle;
+    char path[256], str[16], *tmp;
+    FILE *file;
+    size_t i;
+    tmp = sg_tmpdir();
+    snprintf(path, sizeof(path), "%s/sg_test_httplog_%ld.log", tmp, (long) getpid());
+    sg_free(tmp);
+    unlink(path);
+
+    errno = 0;
+    ASSERT(!sg__httplog_new(srv, "", SG_HTTPSRV_LOG_COMMON));
+    ASSERT(errno == ENOENT);
+
+    ASSERT((log = sg__httplog_new(srv, path, SG_HTTPSRV_LOG_COMMON)));
+    ASSERT(log->srv == srv);
+    ASSERT(log->fd != -1);
+    sg__new(slot);
+    sg__new(idle);
+    slot->next = idle;
+    srv->slots = slot;
+    srv->free_slots = idle;
+    /* more records than fit in a batch, so the flusher writes them in several steps. */
+    for (i = 0; i < ((SG__HTTPLOG_BATCH_SIZE / 4) + 1); i++)
+        while (!sg__httplog_push(&slot->log, "abc\n", 4))
+            sg__usleep(1000);
+    /* a record left by a slot before it was released, drained after the ones of the slot in use. */
+    ASSERT(sg__httplog_push(&idle->log, "def\n", 4));
+    log->reopen = 1;
+    sg__httplog_free(log);
+    ASSERT(slot->log.tail == slot->log.head);
+    ASSERT(slot->log.buf);
+    ASSERT(idle->log.tail == idle->log.head);
+    ASSERT(!idle->log.buf);
+    ASSERT((file = fopen(path, "r")));
+    for (i = 0; i < ((SG__HTTPLOG_BATCH_SIZE / 4) + 1); i++) {
+        ASSERT(fgets(str, sizeof(str), file));
+        ASSERT(strcmp(str, "abc\n") == 0);
+    }
+    ASSERT(fgets(str, sizeof(str), file));
+    ASSERT(strcmp(str, "def\n") == 0);
+    ASSERT(!fgets(str, sizeof(str), file));
+    fclose(file);
+    unlink(path);
+    sg_httpsrv_free(srv);
+    sg__httplog_free(NULL);
+}
+
+int main(void) {
+    test__httplog_esc();
+    test__httplog_format();
+    test__httplog_push();
+    test__httplog_new_free();
+    return EXIT_SUCCESS;
+}
@@ -103,6 +103,81 @@ static void test_httpreq_params(struct sg_httpreq *req) {
     ASSERT(strcmp(sg_strmap_get(*params, "abc"), "123") == 0);
 }
 
+static void test_httpreq_header(struct sg_httpreq *req) {
+    errno = 0;
+    ASSERT(!sg_httpreq_header(NULL, "foo"));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpreq_header(req, NULL));
+    ASSERT(errno == EINVAL);
+
+    sg_strmap_cleanup(&req->headers);
+    errno = 0;
+    ASSERT(!sg_httpreq_header(req, "foo"));
+    ASSERT(errno == 0);
+    sg_strmap_add(&req->headers, "Foo", "bar");
+    ASSERT(strcmp(sg_httpreq_header(req, "FOO"), "bar") == 0);
+    ASSERT(!sg_httpreq_header(req, "abc"));
+    sg_strmap_cleanup(&req->headers);
+}
+
+static void test_httpreq_cookie(struct sg_httpreq *req) {
+    errno = 0;
+    ASSERT(!sg_httpreq_cookie(NULL, "foo"));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpreq_cookie(req, NULL));
+    ASSERT(errno == EINVAL);
+
+    sg_strmap_cleanup(&req->cookies);
+    errno = 0;
+    ASSERT(!sg_httpreq_cookie(req, "foo"));
+    ASSERT(errno == 0);
+    sg_strmap_add(&req->cookies, "foo", "bar");
+    ASSERT(strcmp(sg_httpreq_cookie(req, "foo"), "bar") == 0);
+    ASSERT(!sg_httpreq_cookie(req, "abc"));
+    sg_strmap_cleanup(&req->cookies);
+}
+
+static void test_httpreq_param(struct sg_httpreq *req) {
+    errno = 0;
+    ASSERT(!sg_httpreq_param(NULL, "foo"));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpreq_param(req, NULL));
+    ASSERT(errno == EINVAL);
+
+    sg_strmap_cleanup(&req->params);
+    errno = 0;
+    ASSERT(!sg_httpreq_param(req, "foo"));
+    ASSERT(errno == 0);
+    sg_strmap_add(&req->params, "foo", "bar");
+    ASSERT(strcmp(sg_httpreq_param(req, "foo"), "bar") == 0);
+    ASSERT(!sg_httpreq_param(req, "abc"));
+    sg_strmap_cleanup(&req->params);
+}
+
+static void test_httpreq_header_id(struct sg_httpreq *req) {
+    errno = 0;
+    ASSERT(!sg_httpreq_header_id(NULL, SG_HDR_HOST));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpreq_header_id(req, (enum sg_hdr) -1));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpreq_header_id(req, (enum sg_hdr) SG__HDRS));
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(!sg_httpreq_header_id(req, SG_HDR_HOST));
+    ASSERT(errno == 0);
+    ASSERT(req->hdrs_indexed);
+    req->hdrs[SG_HDR_HOST] = "localhost";
+    ASSERT(strcmp(sg_httpreq_header_id(req, SG_HDR_HOST), "localhost") == 0);
+    ASSERT(!sg_httpreq_header_id(req, SG_HDR_ACCEPT));
+    req->hdrs[SG_HDR_HOST] = NULL;
+}
+
 static void test_httpreq_fields(struct sg_httpreq *req) {
     struct sg_strmap **fields;
     errno = 0;
@@ -200,6 +275,21 @@ static void test_httpreq_is_uploading(struct sg_httpreq *req) {
     ASSERT(errno == 0);
 }
 
+static void test_httpreq_mem_size(struct sg_httpreq *req) {
+    errno = 0;
+    ASSERT(sg_httpreq_mem_size(NULL) == 0);
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    req->mem_size = 0;
+    ASSERT(sg_httpreq_mem_size(req) == 0);
+    ASSERT(errno == 0);
+    req->mem_size = 123;
+    ASSERT(sg_httpreq_mem_size(req) == 123);
+    ASSERT(errno == 0);
+    req->mem_size = 0;
+}
+
 static void test_httpreq_uploads(struct sg_httpreq *req) {
     struct sg_httpupld *tmp;
     errno = 0;
@@ -269,12 +359,17 @@ int main(void) {
     test_httpreq_headers(req);
     test_httpreq_cookies(req);
     test_httpreq_params(req);
+    test_httpreq_header(req);
+    test_httpreq_cookie(req);
+    test_httpreq_param(req);
+    test_httpreq_header_id(req);
     test_httpreq_fields(req);
     test_httpreq_version(req);
     test_httpreq_method(req);
     test_httpreq_path(req);
     test_httpreq_payload(req);
     test_httpreq_is_uploading(req);
+    test_httpreq_mem_size(req);
     test_httpreq_uploads(req);
 #ifdef SG_HTTPS_SUPPORT
     test_httpreq_tls_session();
@@ -134,6 +134,86 @@ static void test_httpres_set_cookie(struct sg_httpres *res) {
     ASSERT(strcmp(sg_strmap_get(*sg_httpres_headers(res), MHD_HTTP_HEADER_SET_COOKIE), "foo=bar") == 0);
 }
 
+static void test_httpres_set_header_id(struct sg_httpres *res) {
+    ASSERT(sg_httpres_set_header_id(NULL, SG_HDR_CACHE_CONTROL, "no-cache") == EINVAL);
+    ASSERT(sg_httpres_set_header_id(res, (enum sg_hdr) -1, "no-cache") == EINVAL);
+    ASSERT(sg_httpres_set_header_id(res, (enum sg_hdr) SG__HDRS, "no-cache") == EINVAL);
+
+    ASSERT(sg_httpres_set_header_id(res, SG_HDR_CACHE_CONTROL, "no-cache") == 0);
+    ASSERT(strcmp(res->hdrs[SG_HDR_CACHE_CONTROL], "no-cache") == 0);
+    ASSERT(sg_httpres_set_header_id(res, SG_HDR_CACHE_CONTROL, "no-store") == 0);
+    ASSERT(strcmp(res->hdrs[SG_HDR_CACHE_CONTROL], "no-store") == 0);
+    ASSERT(sg_httpres_set_header_id(res, SG_HDR_CACHE_CONTROL, NULL) == 0);
+    ASSERT(!res->hdrs[SG_HDR_CACHE_CONTROL]);
+    ASSERT(sg_httpres_set_header_id(res, SG_HDR_VARY, "Accept-Encoding") == 0);
+    ASSERT(!sg_strmap_get(*sg_httpres_headers(res), "Vary"));
+}
+
+static void test_httphdrs_new(void) {
+    struct sg_httphdrs *hdrs;
+    struct sg_strmap *headers = NULL;
+    ASSERT(sg_httphdrs_new(NULL, NULL) == EINVAL);
+
+    ASSERT(sg_httphdrs_new(NULL, &hdrs) == 0);
+    ASSERT(hdrs->count == 0);
+    sg_httphdrs_free(hdrs);
+
+    sg_strmap_add(&headers, "Bad Name", "abc");
+    hdrs = NULL;
+    ASSERT(sg_httphdrs_new(headers, &hdrs) == EINVAL);
+    ASSERT(!hdrs);
+    sg_strmap_cleanup(&headers);
+    sg_strmap_add(&headers, "X-Foo", "abc\r\nSet-Cookie: a=b");
+    ASSERT(sg_httphdrs_new(headers, &hdrs) == EINVAL);
+    sg_strmap_cleanup(&headers);
+
+    sg_strmap_add(&headers, "Access-Control-Allow-Origin", "*");
+    sg_strmap_add(&headers, "X-Frame-Options", "DENY");
+    sg_strmap_add(&headers, "Vary", "Origin");
+    sg_strmap_add(&headers, "vary", "Accept-Encoding");
+    ASSERT(sg_httphdrs_new(headers, &hdrs) == 0);
+    sg_strmap_cleanup(&headers);
+    ASSERT(hdrs->count == 4);
+    ASSERT(hdrs->refs == 1);
+    ASSERT(strcmp(hdrs->pairs[0], "Access-Control-Allow-Origin") == 0 && strcmp(hdrs->pairs[1], "*") == 0);
+    ASSERT(strcmp(hdrs->pairs[2], "X-Frame-Options") == 0 && strcmp(hdrs->pairs[3], "DENY") == 0);
+    ASSERT(strcmp(hdrs->pairs[4], "Vary") == 0 && strcmp(hdrs->pairs[5], "Origin") == 0);
+    ASSERT(strcmp(hdrs->pairs[6], "vary") == 0 && strcmp(hdrs->pairs[7], "Accept-Encoding") == 0);
+    sg_httphdrs_free(hdrs);
+    sg_httphdrs_free(NULL);
+}
+
+static void test_httpres_set_headers_block(struct sg_httpres *res) {
+    struct sg_httphdrs *hdrs, *other;
+    struct sg_strmap *headers = NULL;
+    struct sg_httpres *tmp;
+    sg_strmap_add(&headers, "X-Frame-Options", "DENY");
+    ASSERT(sg_httphdrs_new(headers, &hdrs) == 0);
+    ASSERT(sg_httphdrs_new(NULL, &other) == 0);
+    sg_strmap_cleanup(&headers);
+    ASSERT(sg_httpres_set_headers_block(NULL, hdrs) == EINVAL);
+
+    ASSERT(sg_httpres_set_headers_block(res, hdrs) == 0);
+    ASSERT(res->blk == hdrs);
+    ASSERT(hdrs->refs == 2);
+    tmp = sg__httpres_new(NULL);
+    ASSERT(sg_httpres_set_headers_block(tmp, hdrs) == 0);
+    ASSERT(hdrs->refs == 3);
+    ASSERT(sg_httpres_set_headers_block(tmp, other) == 0);
+    ASSERT(tmp->blk == other);
+    ASSERT(hdrs->refs == 2);
+    ASSERT(other->refs == 2);
+    sg__httpres_free(tmp);
+    ASSERT(other->refs == 1);
+    sg_httphdrs_free(other);
+    /* the block is kept by the response after being freed. */
+    sg_httphdrs_free(hdrs);
+    ASSERT(hdrs->refs == 1);
+    ASSERT(strcmp(res->blk->pairs[0], "X-Frame-Options") == 0);
+    ASSERT(sg_httpres_set_headers_block(res, NULL) == 0);
+    ASSERT(!res->blk);
+}
+
 static void test_httpres_sendbinary(struct sg_httpres *res) {
     char *str = "foo";
     const size_t len = strlen(str);
@@ -167,8 +247,10 @@ static void test_httpres_sendbinary(struct sg_httpres *res) {
     res->handle = NULL;
 
     res->status = 0;
+    res->size = 0;
     ASSERT(sg_httpres_sendbinary(res, str, len, "text/plain", 201) == 0);
     ASSERT(res->status == 201);
+    ASSERT(res->size == len);
     ASSERT(sg_httpres_sendbinary(res, str, len, "text/plain", 200) == EALREADY);
     ASSERT(strcmp(sg_strmap_get(*sg_httpres_headers(res), MHD_HTTP_HEADER_CONTENT_TYPE), "text/plain") == 0);
     ASSERT(res->status == 201);
@@ -272,6 +354,9 @@ int main(void) {
     test__httpres_dispatch(res);
     test_httpres_headers(res);
     test_httpres_set_cookie(res);
+    test_httpres_set_header_id(res);
+    test_httphdrs_new();
+    test_httpres_set_headers_block(res);
     test_httpres_sendbinary(res);
     test_httpres_sendfile(res);
     test_httpres_sendstream(res);
@@ -128,6 +128,84 @@ static void dummy_httpreq_cb(void *cls, struct sg_httpreq *req, struct sg_httpre
     (void) res;
 }
 
+static void ok_httpreq_cb(void *cls, struct sg_httpreq *req, struct sg_httpres *res) {
+    (void) cls;
+    (void) req;
+    ASSERT(sg_httpres_send(res, "ok", "text/plain", 200) == 0);
+}
+
+#ifndef _WIN32
+
+static void slow_httpreq_cb(void *cls, struct sg_httpreq *req, struct sg_httpres *res) {
+    (void) cls;
+    (void) req;
+    sg__usleep(200000); /* ~200 ms */
+    ASSERT(sg_httpres_send(res, "ok", "text/plain", 200) == 0);
+}
+
+static int port_connect(uint16_t port, const char *data) {
+    struct sockaddr_in addr;
+    int fd;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT((fd = socket(AF_INET, SOCK_STREAM, 0)) > -1);
+    ASSERT(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    ASSERT(send(fd, data, strlen(data), 0) == (ssize_t) strlen(data));
+    return fd;
+}
+
+static int drain_connect(struct sg_httpsrv *srv, const char *data) {
+    return port_connect(sg_httpsrv_port(srv), data);
+}
+
+static int drain_hold;
+
+static void hold_httpreq_cb(void *cls, struct sg_httpreq *req, struct sg_httpres *res) {
+    (void) cls;
+    (void) req;
+    while (sg__atomic_get(&drain_hold))
+        sg__usleep(1000);
+    ASSERT(sg_httpres_send(res, "ok", "text/plain", 200) == 0);
+}
+
+struct drain_args {
+    struct sg_httpsrv *srv;
+    unsigned int drained;
+    unsigned int aborted;
+};
+
+static void *drain_thread(void *cls) {
+    struct drain_args *args = cls;
+    ASSERT(sg_httpsrv_drain(args->srv, 5, &args->drained, &args->aborted) == 0);
+    return NULL;
+}
+
+/* receives until the end of a response whose body is "ok", or until the connection is closed. */
+static size_t drain_recv(int fd, char *buf, size_t size) {
+    size_t len = 0;
+    ssize_t ret;
+    memset(buf, 0, size);
+    while ((len < (size - 1)) && !strstr(buf, "\r\n\r\nok") &&
+           ((ret = recv(fd, buf + len, size - 1 - len, 0)) > 0))
+        len += (size_t) ret;
+    return len;
+}
+
+/* waits until the server has received the headers of a given number of requests. */
+static void drain_wait_reqs(struct sg_httpsrv *srv, uint64_t reqs) {
+    struct sg_httpsrv_stats stats;
+    uint64_t deadline = sg__monotonic() + 1000000;
+    do {
+        sg__usleep(1000);
+        ASSERT(sg_httpsrv_stats(srv, &stats) == 0);
+    } while ((stats.reqs < reqs) && (sg__monotonic() < deadline));
+    ASSERT(stats.reqs == reqs);
+}
+
+#endif
+
 static void dummy_httpreq_err_cb(void *cls, const char *err) {
     (void) cls;
     (void) err;
@@ -137,6 +215,13 @@ static void dummy_httpreq_err_cpy_cb(void *cls, const char *err) {
     strcpy(cls, err);
 }
 
+static void dummy_httpsrv_err_cb(void *cls, const struct sg_err *err) {
+    struct sg_err *dst = cls;
+    *dst = *err;
+    dst->msg = NULL;
+    ASSERT(strcmp(err->msg, "abc123") == 0);
+}
+
 static bool dummy_httpreq_httpauth_cb(void *cls, struct sg_httpauth *auth, struct sg_httpreq *req,
                                       struct sg_httpres *res) {
     (void) cls;
@@ -183,6 +268,17 @@ static int dummy_httpupld_save_as_cb(void *handle, const char *path, bool overwr
     return 0;
 }
 
+#ifndef _WIN32
+
+static void dummy_httpsrv_accept_cb(void *cls, int fd) {
+    int val = 0;
+    socklen_t len = sizeof(val);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, &len) == 0)
+        sg__atomic_add((unsigned int *) cls, (val != 0) ? 2 : 1);
+}
+
+#endif
+
 static void test__httpsrv_oel(const char *fmt, ...) {
     struct sg_httpsrv *srv;
     char err[256];
@@ -197,6 +293,30 @@ static void test__httpsrv_oel(const char *fmt, ...) {
     sg_httpsrv_free(srv);
 }
 
+static void test__httpsrv_err(void) {
+    struct sg_httpsrv *srv;
+    struct sg_err rec;
+    char err[256];
+    int dummy = 123;
+    ASSERT(srv = sg_httpsrv_new2(NULL, NULL, dummy_httpreq_cb, NULL, dummy_httpreq_err_cpy_cb, err));
+    memset(err, 0, sizeof(err));
+    sg__httpsrv_err(srv, NULL, SG_ERR_HTTPD, SG_ERR_SUBSYS_HTTPSRV, 0, "%s%d", "abc", 123);
+    ASSERT(strcmp(err, "abc123") == 0);
+
+    memset(err, 0, sizeof(err));
+    memset(&rec, 0, sizeof(struct sg_err));
+    srv->err2_cb = dummy_httpsrv_err_cb;
+    srv->err2_cls = &rec;
+    sg__httpsrv_err(srv, (struct sg_httpreq *) &dummy, SG_ERR_UPLD_FILE, SG_ERR_SUBSYS_HTTPUPLDS, EACCES, "%s%d",
+                    "abc", 123);
+    ASSERT(strlen(err) == 0);
+    ASSERT(rec.code == SG_ERR_UPLD_FILE);
+    ASSERT(rec.subsys == SG_ERR_SUBSYS_HTTPUPLDS);
+    ASSERT(rec.errnum == EACCES);
+    ASSERT(rec.req == (struct sg_httpreq *) &dummy);
+    sg_httpsrv_free(srv);
+}
+
 static void test__httpsrv_ahc(struct sg_httpsrv *srv) {
     struct sg_httpreq *req = NULL;
     size_t size = 0;
@@ -213,7 +333,7 @@ static void test__httpsrv_rcc(void) {
 }
 
 static void test__httpsrv_addopt(void) {
-    struct MHD_OptionItem ops[8];
+    struct MHD_OptionItem ops[24];
     unsigned char pos = 0;
     int dummy = 123;
     memset(ops, 0, sizeof(ops));
@@ -234,6 +354,163 @@ static void test__httpsrv_addopt(void) {
     ASSERT(!ops[2].ptr_value);
 }
 
+static void test__httpsrv_lat_idx(void) {
+    uint64_t usec;
+    unsigned int i;
+    for (usec = 0; usec < 100000; usec++) {
+        i = sg__httpsrv_lat_idx(usec);
+        ASSERT(i < SG__LAT_BUCKETS);
+        ASSERT(usec <= sg__httpsrv_lat_max(i));
+        if (i > 0)
+            ASSERT(usec > sg__httpsrv_lat_max(i - 1));
+    }
+    ASSERT(sg__httpsrv_lat_idx(7) == 7);
+    ASSERT(sg__httpsrv_lat_max(sg__httpsrv_lat_idx(100)) == 103);
+    ASSERT(sg__httpsrv_lat_max(sg__httpsrv_lat_idx(1000)) == 1023);
+    ASSERT(sg__httpsrv_lat_idx(UINT32_MAX) == SG__LAT_BUCKETS - 1);
+    ASSERT(sg__httpsrv_lat_idx(UINT64_MAX) == SG__LAT_BUCKETS - 1);
+    ASSERT(sg__httpsrv_lat_max(SG__LAT_BUCKETS - 1) == UINT32_MAX);
+}
+
+static void test__httpsrv_slots(void) {
+    struct sg_httpsrv *srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
+    struct sg__httpsrv_slot *slot;
+
+    ASSERT(!srv->slots);
+    slot = sg__httpsrv_slot_acquire(srv);
+    ASSERT(slot);
+    ASSERT(srv->slots == slot);
+    ASSERT(!srv->free_slots);
+    sg__httpsrv_slot_release(srv, slot);
+    ASSERT(srv->free_slots == slot);
+    ASSERT(sg__httpsrv_slot_acquire(srv) == slot);
+    ASSERT(!srv->free_slots);
+
+    ASSERT(!sg__httpsrv_inflight(srv));
+    slot->stats.reqs = 2;
+    slot->done = 1;
+    ASSERT(sg__httpsrv_inflight(srv));
+    slot->done = 2;
+    ASSERT(!sg__httpsrv_inflight(srv));
+
+    ASSERT(sg__httpsrv_slot_acquire(srv) != slot);
+    ASSERT(srv->slots->next == slot);
+    sg__httpsrv_slots_recycle(srv);
+    ASSERT(srv->free_slots);
+    ASSERT(srv->free_slots->next_free);
+    ASSERT(!srv->free_slots->next_free->next_free);
+    sg__httpsrv_slot_acquire(srv);
+    ASSERT(srv->free_slots);
+    ASSERT(!srv->free_slots->next_free);
+    sg_httpsrv_free(srv);
+}
+
+static void test__httpsrv_con(void) {
+    struct sg_httpsrv *srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
+    struct sg__httpsrv_slot *slot = sg__httpsrv_slot_acquire(srv);
+    struct sg__httpsrv_con a, b, c;
+#ifndef _WIN32
+    int fds[2];
+    char ch;
+#endif
+
+    memset(&a, 0, sizeof(struct sg__httpsrv_con));
+    memset(&b, 0, sizeof(struct sg__httpsrv_con));
+    memset(&c, 0, sizeof(struct sg__httpsrv_con));
+    a.slot = b.slot = c.slot = slot;
+    DL_APPEND(slot->idle, &a);
+    DL_APPEND(slot->idle, &b);
+    sg__httpsrv_con_busy(&a);
+    ASSERT(a.busy == 1);
+    ASSERT(slot->idle == &b);
+    ASSERT(!b.next);
+    sg__httpsrv_con_idle(&a);
+    ASSERT(a.busy == 0);
+    ASSERT(slot->idle == &b);
+    ASSERT(b.next == &a);
+
+    c.threaded = true;
+    sg__httpsrv_con_busy(&c);
+    ASSERT(c.busy == 1);
+    ASSERT(slot->idle == &b);
+    sg__httpsrv_con_idle(&c);
+    ASSERT(c.busy == 0);
+
+#ifndef _WIN32
+    /* only the idle threaded connections are shut down when the server drains. */
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    c.fd = fds[0];
+    c.busy = 1;
+    DL_APPEND(srv->tcons, &c);
+    ASSERT(send(fds[1], "x", 1, 0) == 1);
+    sg__httpsrv_tcons_close_idle(srv);
+    ASSERT(recv(fds[0], &ch, 1, 0) == 1);
+    c.busy = 0;
+    sg__httpsrv_tcons_close_idle(srv);
+    ASSERT(recv(fds[0], &ch, 1, 0) == 0);
+    DL_DELETE(srv->tcons, &c);
+    ASSERT(!srv->tcons);
+    close(fds[0]);
+    close(fds[1]);
+#endif
+    sg_httpsrv_free(srv);
+}
+
+static void test__httpsrv_metrics_render(void) {
+    struct sg_httpsrv *srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
+    struct sg__httpsrv_slot *slot = sg__httpsrv_slot_acquire(srv);
+    struct sg__httpsrv_metrics *metrics, *other;
+    size_t len;
+
+    ASSERT(!slot->metrics);
+    metrics = sg__httpsrv_metrics_acquire(slot);
+    ASSERT(metrics->buf);
+    ASSERT(metrics->size == 16384);
+    ASSERT(!metrics->next);
+    sg__free(metrics->buf);
+    sg__alloc(metrics->buf, 4);
+    metrics->size = 4;
+    len = 0;
+    sg__httpsrv_metrics_printf(metrics, &len, "%s%d", "abc", 123);
+    ASSERT(len == 6);
+    ASSERT(metrics->size > 6);
+    ASSERT(strcmp(metrics->buf, "abc123") == 0);
+    sg__httpsrv_metrics_printf(metrics, &len, "%s", "def");
+    ASSERT(len == 9);
+    ASSERT(strcmp(metrics->buf, "abc123def") == 0);
+
+    slot->stats.reqs = 3;
+    slot->stats.status[1] = 2;
+    sg__httpsrv_lat_add(slot, SG_HTTPSRV_PHASE_HANDLER, 5);
+    sg__httpsrv_lat_add(slot, SG_HTTPSRV_PHASE_HANDLER, 1000);
+    len = sg__httpsrv_metrics_render(srv, metrics);
+    ASSERT(len == strlen(metrics->buf));
+    ASSERT(strstr(metrics->buf, "# TYPE sagui_requests_total counter\nsagui_requests_total 3\n"));
+    ASSERT(strstr(metrics->buf, "sagui_responses_total{code=\"2xx\"} 2\n"));
+    ASSERT(strstr(metrics->buf, "sagui_connections_active 0\n"));
+    ASSERT(strstr(metrics->buf, "# TYPE sagui_request_duration_seconds histogram\n"));
+    ASSERT(strstr(metrics->buf, "sagui_request_duration_seconds_bucket{phase=\"handler\",le=\"8e-06\"} 1\n"));
+    ASSERT(strstr(metrics->buf,
+                  "sagui_request_duration_seconds_bucket{phase=\"handler\",le=\"0.001024\"} 2\n"));
+    ASSERT(strstr(metrics->buf, "sagui_request_duration_seconds_bucket{phase=\"handler\",le=\"+Inf\"} 2\n"));
+    ASSERT(strstr(metrics->buf, "sagui_request_duration_seconds_sum{phase=\"handler\"} 0.001005\n"));
+    ASSERT(strstr(metrics->buf, "sagui_request_duration_seconds_count{phase=\"total\"} 0\n"));
+
+    /* a buffer still being sent is not reused, and a released one is reused as is by the next scrape. */
+    other = sg__httpsrv_metrics_acquire(slot);
+    ASSERT(other != metrics);
+    sg__httpsrv_metrics_release(slot, metrics);
+    ASSERT(slot->metrics == metrics);
+    ASSERT(sg__httpsrv_metrics_acquire(slot) == metrics);
+    ASSERT(!slot->metrics);
+    ASSERT(sg__httpsrv_metrics_render(srv, metrics) == len);
+    sg__httpsrv_metrics_release(slot, metrics);
+    sg__httpsrv_metrics_release(slot, other);
+    ASSERT(slot->metrics == other);
+    ASSERT(other->next == metrics);
+    sg_httpsrv_free(srv);
+}
+
 static void test_httpsrv_new2(void) {
     struct sg_httpsrv *srv;
     int dummy = 0;
@@ -260,6 +537,9 @@ static void test_httpsrv_new2(void) {
     ASSERT(srv->req_cls == &dummy);
     ASSERT(srv->err_cb == dummy_httpreq_err_cb);
     ASSERT(srv->err_cls == &dummy);
+    ASSERT(srv->listen_fd == -1);
+    ASSERT(srv->sockopts[SG_HTTPSRV_SOCKOPT_BACKLOG] == -1);
+    ASSERT(srv->sockopts[SG_HTTPSRV_SOCKOPT_BUSY_POLL] == -1);
     tmp = sg_tmpdir();
     ASSERT(strcmp(srv->uplds_dir, tmp) == 0);
     sg_free(tmp);
@@ -347,14 +627,19 @@ static void test_httpsrv_listen(struct sg_httpsrv *srv) {
     ASSERT(sg_httpsrv_listen(srv, TEST_HTTPSRV_PORT, false));
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_DUAL_STACK);
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_ERROR_LOG);
-    ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_AUTO_INTERNAL_THREAD);
+    ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_AUTO);
+    ASSERT(!(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_INTERNAL_POLLING_THREAD));
     ASSERT(!(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_THREAD_PER_CONNECTION));
+    ASSERT(srv->lsns->workers && (srv->lsns->workers[0] == srv->handle));
+    ASSERT(srv->pool.running);
     ASSERT(sg_httpsrv_shutdown(srv) == 0);
     ASSERT(sg_httpsrv_listen(srv, TEST_HTTPSRV_PORT, true));
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_DUAL_STACK);
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_ERROR_LOG);
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_AUTO_INTERNAL_THREAD);
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_THREAD_PER_CONNECTION);
+    ASSERT(!srv->lsns->workers);
+    ASSERT(!srv->pool.running);
 #ifdef __linux__
     dummy_srv = sg_httpsrv_new2(NULL, NULL, dummy_httpreq_cb, NULL, dummy_httpreq_err_cb, NULL);
     errno = 0;
@@ -364,6 +649,125 @@ static void test_httpsrv_listen(struct sg_httpsrv *srv) {
 #endif
 }
 
+#ifndef _WIN32
+
+static void test_httpsrv_listen_unix(void) {
+    struct sg_httpsrv *srv, *dummy_srv;
+    struct sockaddr_un addr;
+    struct stat sbuf;
+    char path[108], *tmp;
+    int fd;
+
+    tmp = sg_tmpdir();
+    snprintf(path, sizeof(path), "%s/sg_test_httpsrv_%ld.sock", tmp, (long) getpid());
+    sg_free(tmp);
+    srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
+
+    errno = 0;
+    ASSERT(!sg_httpsrv_listen_unix(NULL, path, 0600, false));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_listen_unix(srv, NULL, 0600, false));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_listen_unix(srv, "", 0600, false));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_listen_unix(srv, path, 010000, false));
+    ASSERT(errno == EINVAL);
+
+    ASSERT(sg_httpsrv_listen_unix(srv, path, 0600, false));
+    ASSERT(strcmp(srv->lsns->unix_path, path) == 0);
+    ASSERT(stat(path, &sbuf) == 0);
+    ASSERT(S_ISSOCK(sbuf.st_mode));
+    ASSERT((sbuf.st_mode & 0777) == 0600);
+    ASSERT(sg_httpsrv_port(srv) == 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    ASSERT(sg__httpsrv_unix_alive(&addr));
+    dummy_srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_listen_unix(dummy_srv, path, 0600, false));
+    ASSERT(errno == EADDRINUSE);
+    sg_httpsrv_free(dummy_srv);
+    ASSERT(sg_httpsrv_shutdown(srv) == 0);
+    ASSERT(!srv->lsns);
+    ASSERT(stat(path, &sbuf) == -1);
+
+    /* a socket file left by a dead server is replaced. */
+    ASSERT((fd = socket(AF_UNIX, SOCK_STREAM, 0)) > -1);
+    ASSERT(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    close(fd);
+    ASSERT(stat(path, &sbuf) == 0);
+    ASSERT(!sg__httpsrv_unix_alive(&addr));
+    ASSERT(sg_httpsrv_listen_unix(srv, path, 0, true));
+    ASSERT(sg_httpsrv_is_threaded(srv));
+    ASSERT(sg_httpsrv_drain(srv, 1, NULL, NULL) == 0);
+    ASSERT(stat(path, &sbuf) == -1);
+    sg_httpsrv_free(srv);
+}
+
+#endif
+
+static void test_httpsrv_listeners(void) {
+    struct sg_httpsrv *srv;
+    struct sg__httpsrv_lsn *lsn;
+#ifndef _WIN32
+    char buf[256];
+    int fd;
+#endif
+    int count;
+
+    srv = sg_httpsrv_new(ok_httpreq_cb, NULL);
+    ASSERT(!srv->lsns);
+    ASSERT(sg_httpsrv_listen(srv, TEST_HTTPSRV_PORT, false));
+    ASSERT(sg_httpsrv_listen(srv, 0, false));
+    LL_COUNT(srv->lsns, lsn, count);
+    ASSERT(count == 2);
+    ASSERT(srv->handle == srv->lsns->next->handle);
+    ASSERT(sg_httpsrv_port(srv) == TEST_HTTPSRV_PORT);
+    ASSERT(MHD_get_daemon_info(srv->lsns->handle, MHD_DAEMON_INFO_BIND_PORT)->port != TEST_HTTPSRV_PORT);
+    ASSERT(sg_httpsrv_shutdown(srv) == 0);
+    ASSERT(!srv->lsns);
+    ASSERT(!srv->handle);
+    ASSERT(sg_httpsrv_port(srv) == 0);
+
+    ASSERT(sg_httpsrv_set_thr_pool_size(srv, 2) == 0);
+    ASSERT(sg_httpsrv_listen(srv, 0, false));
+    ASSERT(sg_httpsrv_listen(srv, 0, false));
+    ASSERT(sg_httpsrv_listen(srv, 0, true));
+    ASSERT(srv->pool.running);
+    ASSERT(srv->pool.size == 2);
+    ASSERT(!srv->lsns->workers);
+    ASSERT(srv->lsns->next->workers && srv->lsns->next->next->workers);
+    ASSERT(MHD_get_daemon_info(srv->lsns->next->workers[1], MHD_DAEMON_INFO_BIND_PORT)->port ==
+           MHD_get_daemon_info(srv->lsns->next->workers[0], MHD_DAEMON_INFO_BIND_PORT)->port);
+#ifndef _WIN32
+    LL_FOREACH(srv->lsns, lsn) {
+        if (!lsn->workers)
+            continue;
+        fd = port_connect(MHD_get_daemon_info(lsn->handle, MHD_DAEMON_INFO_BIND_PORT)->port,
+                          "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+        memset(buf, 0, sizeof(buf));
+        ASSERT(recv(fd, buf, sizeof(buf) - 1, MSG_WAITALL) > 0);
+        ASSERT(strstr(buf, "HTTP/1.1 200"));
+        close(fd);
+    }
+#endif
+    ASSERT(sg_httpsrv_shutdown(srv) == 0);
+    ASSERT(!srv->pool.running);
+    ASSERT(!srv->pool.thrs);
+
+    ASSERT(sg_httpsrv_listen(srv, 0, true));
+    ASSERT(sg_httpsrv_listen(srv, 0, true));
+    ASSERT(!srv->pool.running);
+    ASSERT(sg_httpsrv_drain(srv, 1, NULL, NULL) == 0);
+    ASSERT(!srv->lsns);
+    ASSERT(!srv->handle);
+    sg_httpsrv_free(srv);
+}
+
 #ifdef SG_HTTPS_SUPPORT
 
 static void test_httpsrv_tls_listen(struct sg_httpsrv *srv) {
@@ -423,8 +827,11 @@ static void test_httpsrv_tls_listen(struct sg_httpsrv *srv) {
     ASSERT(sg_httpsrv_tls_listen(srv, private_key, certificate, TEST_HTTPSRV_PORT, false));
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_DUAL_STACK);
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_ERROR_LOG);
-    ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_AUTO_INTERNAL_THREAD);
+    ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_AUTO);
+    ASSERT(!(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_INTERNAL_POLLING_THREAD));
     ASSERT(!(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_THREAD_PER_CONNECTION));
+    ASSERT(srv->lsns->workers && (srv->lsns->workers[0] == srv->handle));
+    ASSERT(srv->pool.running);
     ASSERT(MHD_get_daemon_info(srv->handle, MHD_DAEMON_INFO_FLAGS)->flags & MHD_USE_TLS);
     ASSERT(sg_httpsrv_shutdown(srv) == 0);
     ASSERT(sg_httpsrv_tls_listen(srv, private_key, certificate, TEST_HTTPSRV_PORT, true));
@@ -465,6 +872,124 @@ static void test_httpsrv_shutdown(struct sg_httpsrv *srv) {
     ASSERT(sg_httpsrv_listen(srv, TEST_HTTPSRV_PORT, true));
 }
 
+#ifndef _WIN32
+
+/* an idle keep-alive connection is closed while a request is still in-flight. */
+static void test_httpsrv_drain_idle(bool threaded) {
+    struct sg_httpsrv *hold_srv;
+    struct drain_args args;
+    struct timeval tv;
+    pthread_t thread;
+    char buf[1024];
+    int idle_fd, busy_fd;
+
+    hold_srv = sg_httpsrv_new(hold_httpreq_cb, NULL);
+    ASSERT(sg_httpsrv_listen(hold_srv, 0, threaded));
+    idle_fd = drain_connect(hold_srv, "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    drain_recv(idle_fd, buf, sizeof(buf));
+    ASSERT(strncmp(buf, "HTTP/1.1 200", 12) == 0);
+    ASSERT(!strstr(buf, "Connection: close\r\n"));
+    sg__atomic_add(&drain_hold, 1);
+    busy_fd = drain_connect(hold_srv, "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    drain_wait_reqs(hold_srv, 2);
+    args.srv = hold_srv;
+    ASSERT(pthread_create(&thread, NULL, drain_thread, &args) == 0);
+    tv.tv_sec = 3;
+    tv.tv_usec = 0;
+    ASSERT(setsockopt(idle_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0);
+    ASSERT(recv(idle_fd, buf, sizeof(buf), 0) == 0);
+    ASSERT(sg__atomic_get(&hold_srv->draining));
+    sg__atomic_sub(&drain_hold, 1);
+    ASSERT(pthread_join(thread, NULL) == 0);
+    ASSERT(args.drained == 1);
+    ASSERT(args.aborted == 0);
+    drain_recv(busy_fd, buf, sizeof(buf));
+    ASSERT(strncmp(buf, "HTTP/1.1 200", 12) == 0);
+    ASSERT(strstr(buf, "Connection: close\r\n"));
+    close(idle_fd);
+    close(busy_fd);
+    sg_httpsrv_free(hold_srv);
+}
+
+#endif
+
+static void test_httpsrv_drain(struct sg_httpsrv *srv) {
+#ifndef _WIN32
+    struct sg_httpsrv *slow_srv;
+    char buf[1024];
+    size_t len = 0;
+    ssize_t ret;
+    int fd;
+#endif
+    unsigned int drained, aborted;
+
+    ASSERT(sg_httpsrv_drain(NULL, 1, &drained, &aborted) == EINVAL);
+
+    drained = aborted = 123;
+    ASSERT(sg_httpsrv_drain(srv, 1, &drained, &aborted) == 0);
+    ASSERT(!srv->handle);
+    ASSERT(!srv->draining);
+    ASSERT(drained == 0);
+    ASSERT(aborted == 0);
+    ASSERT(sg_httpsrv_drain(srv, 1, NULL, NULL) == 0);
+    ASSERT(sg_httpsrv_listen(srv, TEST_HTTPSRV_PORT, false));
+    ASSERT(sg_httpsrv_drain(srv, 0, &drained, &aborted) == 0);
+    ASSERT(!srv->handle);
+    ASSERT(sg_httpsrv_listen(srv, TEST_HTTPSRV_PORT, true));
+#ifndef _WIN32
+    slow_srv = sg_httpsrv_new(slow_httpreq_cb, NULL);
+    ASSERT(sg_httpsrv_listen(slow_srv, 0, false));
+    fd = drain_connect(slow_srv, "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    drain_wait_reqs(slow_srv, 1);
+    ASSERT(sg_httpsrv_drain(slow_srv, 5, &drained, &aborted) == 0);
+    ASSERT(drained == 1);
+    ASSERT(aborted == 0);
+    memset(buf, 0, sizeof(buf));
+    while ((len < (sizeof(buf) - 1)) && ((ret = recv(fd, buf + len, sizeof(buf) - 1 - len, 0)) > 0))
+        len += (size_t) ret;
+    ASSERT(strncmp(buf, "HTTP/1.1 200", 12) == 0);
+    ASSERT(strstr(buf, "Connection: close\r\n"));
+    close(fd);
+
+    ASSERT(sg_httpsrv_listen(slow_srv, 0, false));
+    /* the payload is never completed, so the request is still in-flight when the timeout is reached. */
+    fd = drain_connect(slow_srv, "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 10\r\n\r\nabc");
+    drain_wait_reqs(slow_srv, 2);
+    ASSERT(sg_httpsrv_drain(slow_srv, 1, &drained, &aborted) == 0);
+    ASSERT(drained == 0);
+    ASSERT(aborted == 1);
+    close(fd);
+    sg_httpsrv_free(slow_srv);
+
+    test_httpsrv_drain_idle(false);
+    test_httpsrv_drain_idle(true);
+#endif
+}
+
+static void test_httpsrv_export_fd(struct sg_httpsrv *srv) {
+    struct sg_httpsrv *dummy_srv;
+    int fd;
+
+    errno = 0;
+    ASSERT(sg_httpsrv_export_fd(NULL) == -1);
+    ASSERT(errno == EINVAL);
+    dummy_srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
+    errno = 0;
+    ASSERT(sg_httpsrv_export_fd(dummy_srv) == -1);
+    ASSERT(errno == EINVAL);
+
+    ASSERT((fd = sg_httpsrv_export_fd(srv)) > -1);
+    ASSERT(fd != sg_httpsrv_listen_fd(srv));
+    ASSERT(sg_httpsrv_set_listen_fd(dummy_srv, fd) == 0);
+    ASSERT(sg_httpsrv_listen(dummy_srv, 0, false));
+    ASSERT(dummy_srv->listen_fd == -1);
+    ASSERT(sg_httpsrv_listen_fd(dummy_srv) == fd);
+    ASSERT(sg_httpsrv_drain(srv, 1, NULL, NULL) == 0);
+    ASSERT(sg_httpsrv_listen_fd(dummy_srv) == fd);
+    sg_httpsrv_free(dummy_srv);
+    ASSERT(sg_httpsrv_listen(srv, TEST_HTTPSRV_PORT, true));
+}
+
 static void test_httpsrv_port(struct sg_httpsrv *srv) {
     void *saved_handle;
 
@@ -627,6 +1152,69 @@ static void test_httpsrv_thr_pool_size(struct sg_httpsrv *srv) {
     ASSERT(errno == 0);
 }
 
+static void test_httpsrv_set_thr_stack_size(struct sg_httpsrv *srv) {
+    ASSERT(sg_httpsrv_set_thr_stack_size(NULL, 65536) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_thr_stack_size(srv, 65536) == 0);
+    ASSERT(sg_httpsrv_set_thr_stack_size(srv, 0) == 0);
+}
+
+static void test_httpsrv_thr_stack_size(struct sg_httpsrv *srv) {
+    errno = 0;
+    ASSERT(sg_httpsrv_thr_stack_size(NULL) == 0);
+    ASSERT(errno == EINVAL);
+
+    ASSERT(sg_httpsrv_set_thr_stack_size(srv, 65536) == 0);
+    errno = 0;
+    ASSERT(sg_httpsrv_thr_stack_size(srv) == 65536);
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_thr_stack_size(srv, 0) == 0);
+    errno = 0;
+    ASSERT(sg_httpsrv_thr_stack_size(srv) == 0);
+    ASSERT(errno == 0);
+}
+
+static void test_httpsrv_set_thr_affinity(struct sg_httpsrv *srv) {
+    unsigned int cpus[] = {0, 1};
+    ASSERT(sg_httpsrv_set_thr_affinity(NULL, SG_HTTPSRV_AFFINITY_COMPACT, NULL, 0) == EINVAL);
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, (enum sg_httpsrv_affinity) -1, NULL, 0) == EINVAL);
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, (enum sg_httpsrv_affinity) 4, NULL, 0) == EINVAL);
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_LIST, NULL, 2) == EINVAL);
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_LIST, cpus, 0) == EINVAL);
+
+#ifdef __linux__
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_LIST, cpus, 2) == 0);
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_SCATTER, NULL, 0) == 0);
+#else
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_COMPACT, NULL, 0) == ENOTSUP);
+#endif
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_NONE, NULL, 0) == 0);
+}
+
+static void test_httpsrv_thr_affinity(struct sg_httpsrv *srv) {
+    unsigned int cpus[] = {0};
+    errno = 0;
+    ASSERT(sg_httpsrv_thr_affinity(NULL) == SG_HTTPSRV_AFFINITY_NONE);
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(sg_httpsrv_thr_affinity(srv) == SG_HTTPSRV_AFFINITY_NONE);
+    ASSERT(errno == 0);
+#ifdef __linux__
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_LIST, cpus, 1) == 0);
+    errno = 0;
+    ASSERT(sg_httpsrv_thr_affinity(srv) == SG_HTTPSRV_AFFINITY_LIST);
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_COMPACT, cpus, 1) == 0);
+    errno = 0;
+    ASSERT(sg_httpsrv_thr_affinity(srv) == SG_HTTPSRV_AFFINITY_COMPACT);
+    ASSERT(errno == 0);
+#else
+    (void) cpus;
+#endif
+    ASSERT(sg_httpsrv_set_thr_affinity(srv, SG_HTTPSRV_AFFINITY_NONE, NULL, 0) == 0);
+}
+
 static void test_httpsrv_set_con_timeout(struct sg_httpsrv *srv) {
     ASSERT(sg_httpsrv_set_con_timeout(NULL, 123) == EINVAL);
 
@@ -663,22 +1251,353 @@ static void test_httpsrv_con_limit(struct sg_httpsrv *srv) {
     ASSERT(errno == 0);
 }
 
+static void test_httpsrv_set_con_mem_limit(struct sg_httpsrv *srv) {
+    ASSERT(sg_httpsrv_set_con_mem_limit(NULL, 65536) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_con_mem_limit(srv, 0) == 0);
+    ASSERT(sg_httpsrv_set_con_mem_limit(srv, 65536) == 0);
+    ASSERT(srv->con_mem_limit == 65536);
+}
+
+static void test_httpsrv_con_mem_limit(struct sg_httpsrv *srv) {
+    errno = 0;
+    ASSERT(sg_httpsrv_con_mem_limit(NULL) == 0);
+    ASSERT(errno == EINVAL);
+
+    ASSERT(sg_httpsrv_set_con_mem_limit(srv, 16384) == 0);
+    errno = 0;
+    ASSERT(sg_httpsrv_con_mem_limit(srv) == 16384);
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_con_mem_limit(srv, 0) == 0);
+}
+
+static void test_httpsrv_set_con_mem_increment(struct sg_httpsrv *srv) {
+    ASSERT(sg_httpsrv_set_con_mem_increment(NULL, 1024) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_con_mem_increment(srv, 0) == 0);
+    ASSERT(sg_httpsrv_set_con_mem_increment(srv, 1024) == 0);
+    ASSERT(srv->con_mem_increment == 1024);
+
+    ASSERT(sg_httpsrv_set_con_mem_limit(srv, 1024) == 0);
+    errno = 0;
+    ASSERT(!sg_httpsrv_listen(srv, 0, false));
+    ASSERT(errno == EINVAL);
+    ASSERT(sg_httpsrv_set_con_mem_limit(srv, 0) == 0);
+    ASSERT(sg_httpsrv_set_con_mem_increment(srv, 0) == 0);
+}
+
+static void test_httpsrv_con_mem_increment(struct sg_httpsrv *srv) {
+    errno = 0;
+    ASSERT(sg_httpsrv_con_mem_increment(NULL) == 0);
+    ASSERT(errno == EINVAL);
+
+    ASSERT(sg_httpsrv_set_con_mem_increment(srv, 512) == 0);
+    errno = 0;
+    ASSERT(sg_httpsrv_con_mem_increment(srv) == 512);
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_con_mem_increment(srv, 0) == 0);
+}
+
+static void test_httpsrv_set_req_mem_limit(struct sg_httpsrv *srv) {
+    ASSERT(sg_httpsrv_set_req_mem_limit(NULL, 1048576) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_req_mem_limit(srv, 0) == 0);
+    ASSERT(sg_httpsrv_set_req_mem_limit(srv, 1048576) == 0);
+    ASSERT(srv->req_mem_limit == 1048576);
+}
+
+static void test_httpsrv_req_mem_limit(struct sg_httpsrv *srv) {
+    errno = 0;
+    ASSERT(sg_httpsrv_req_mem_limit(NULL) == 0);
+    ASSERT(errno == EINVAL);
+
+    ASSERT(sg_httpsrv_set_req_mem_limit(srv, 2048) == 0);
+    errno = 0;
+    ASSERT(sg_httpsrv_req_mem_limit(srv) == 2048);
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_req_mem_limit(srv, 0) == 0);
+}
+
+static void test_httpsrv_set_listen_fd(struct sg_httpsrv *srv) {
+    ASSERT(sg_httpsrv_set_listen_fd(NULL, 123) == EINVAL);
+    ASSERT(sg_httpsrv_set_listen_fd(srv, -2) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_listen_fd(srv, 123) == 0);
+    ASSERT(sg_httpsrv_set_listen_fd(srv, -1) == 0);
+}
+
+static void test_httpsrv_listen_fd(struct sg_httpsrv *srv) {
+    errno = 0;
+    ASSERT(sg_httpsrv_listen_fd(NULL) == -1);
+    ASSERT(errno == EINVAL);
+
+    ASSERT(sg_httpsrv_shutdown(srv) == 0);
+    ASSERT(sg_httpsrv_set_listen_fd(srv, 123) == 0);
+    errno = 0;
+    ASSERT(sg_httpsrv_listen_fd(srv) == 123);
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_listen_fd(srv, -1) == 0);
+    ASSERT(sg_httpsrv_listen_fd(srv) == -1);
+    ASSERT(sg_httpsrv_listen(srv, TEST_HTTPSRV_PORT, false));
+    ASSERT(sg_httpsrv_listen_fd(srv) > -1);
+    ASSERT(sg_httpsrv_shutdown(srv) == 0);
+}
+
+static void test_httpsrv_set_sockopt(struct sg_httpsrv *srv) {
+    ASSERT(sg_httpsrv_set_sockopt(NULL, SG_HTTPSRV_SOCKOPT_NODELAY, 1) == EINVAL);
+    ASSERT(sg_httpsrv_set_sockopt(srv, (enum sg_httpsrv_sockopt) -1, 1) == EINVAL);
+    ASSERT(sg_httpsrv_set_sockopt(srv, (enum sg_httpsrv_sockopt) SG__HTTPSRV_SOCKOPTS, 1) == EINVAL);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_NODELAY, -2) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_BACKLOG, 0) == 0);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_BACKLOG, 128) == 0);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_REUSEPORT, 1) == 0);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_SNDBUF, 65536) == 0);
+    ASSERT(sg_httpsrv_listen(srv, 0, false));
+    ASSERT(sg_httpsrv_shutdown(srv) == 0);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_BACKLOG, -1) == 0);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_REUSEPORT, -1) == 0);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_SNDBUF, -1) == 0);
+}
+
+static void test_httpsrv_sockopt(struct sg_httpsrv *srv) {
+    errno = 0;
+    ASSERT(sg_httpsrv_sockopt(NULL, SG_HTTPSRV_SOCKOPT_NODELAY) == -1);
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(sg_httpsrv_sockopt(srv, (enum sg_httpsrv_sockopt) SG__HTTPSRV_SOCKOPTS) == -1);
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(sg_httpsrv_sockopt(srv, SG_HTTPSRV_SOCKOPT_NODELAY) == -1);
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_NODELAY, 1) == 0);
+    ASSERT(sg_httpsrv_sockopt(srv, SG_HTTPSRV_SOCKOPT_NODELAY) == 1);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_NODELAY, -1) == 0);
+    ASSERT(sg_httpsrv_sockopt(srv, SG_HTTPSRV_SOCKOPT_NODELAY) == -1);
+}
+
+static void test_httpsrv_set_err_cb(struct sg_httpsrv *srv) {
+    int dummy = 123;
+    ASSERT(sg_httpsrv_set_err_cb(NULL, dummy_httpsrv_err_cb, &dummy) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_err_cb(srv, dummy_httpsrv_err_cb, &dummy) == 0);
+    ASSERT(srv->err2_cb == dummy_httpsrv_err_cb);
+    ASSERT(srv->err2_cls == &dummy);
+    ASSERT(sg_httpsrv_set_err_cb(srv, NULL, NULL) == 0);
+    ASSERT(!srv->err2_cb);
+    ASSERT(!srv->err2_cls);
+}
+
+static void test_httpsrv_stats(struct sg_httpsrv *srv) {
+    struct sg_httpsrv_stats stats;
+    struct sg__httpsrv_slot *slot;
+
+    ASSERT(sg_httpsrv_stats(NULL, &stats) == EINVAL);
+    ASSERT(sg_httpsrv_stats(srv, NULL) == EINVAL);
+
+    slot = sg__httpsrv_slot_acquire(srv);
+    memset(&slot->stats, 0, sizeof(struct sg_httpsrv_stats));
+    memset(&stats, 1, sizeof(struct sg_httpsrv_stats));
+    ASSERT(sg_httpsrv_stats(srv, &stats) == 0);
+    ASSERT(stats.reqs == 0);
+    ASSERT(stats.cons_active == 0);
+    slot->stats.reqs = 3;
+    slot->stats.bytes_in = 10;
+    slot->stats.bytes_out = 20;
+    slot->stats.status[1] = 2;
+    slot->stats.status[4] = 1;
+    slot->stats.cons_opened = 5;
+    slot->stats.cons_closed = 4;
+    slot->stats.uplds = 1;
+    slot->stats.uplds_bytes = 30;
+    slot = sg__httpsrv_slot_acquire(srv);
+    memset(&slot->stats, 0, sizeof(struct sg_httpsrv_stats));
+    slot->stats.reqs = 1;
+    slot->stats.status[1] = 1;
+    slot->stats.cons_opened = 1;
+    ASSERT(sg_httpsrv_stats(srv, &stats) == 0);
+    ASSERT(stats.reqs == 4);
+    ASSERT(stats.bytes_in == 10);
+    ASSERT(stats.bytes_out == 20);
+    ASSERT(stats.status[0] == 0);
+    ASSERT(stats.status[1] == 3);
+    ASSERT(stats.status[4] == 1);
+    ASSERT(stats.cons_opened == 6);
+    ASSERT(stats.cons_closed == 4);
+    ASSERT(stats.cons_active == 2);
+    ASSERT(stats.uplds == 1);
+    ASSERT(stats.uplds_bytes == 30);
+    sg__httpsrv_slot_release(srv, slot);
+}
+
+static void test_httpsrv_lat_quantile(struct sg_httpsrv *srv) {
+    struct sg__httpsrv_slot *slot;
+    unsigned int i;
+
+    errno = 0;
+    ASSERT(sg_httpsrv_lat_quantile(NULL, SG_HTTPSRV_PHASE_TOTAL, 0.5) == 0);
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(sg_httpsrv_lat_quantile(srv, (enum sg_httpsrv_phase) SG__HTTPSRV_PHASES, 0.5) == 0);
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, -0.1) == 0);
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 1.1) == 0);
+    ASSERT(errno == EINVAL);
+
+    slot = sg__httpsrv_slot_acquire(srv);
+    memset(slot->lats, 0, sizeof(slot->lats));
+    errno = 0;
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 0.5) == 0);
+    ASSERT(errno == 0);
+    for (i = 1; i <= 1000; i++)
+        sg__httpsrv_lat_add(slot, SG_HTTPSRV_PHASE_TOTAL, i < 990 ? 5 : 5000);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 0) == 5);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 0.5) == 5);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 0.989) == 5);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 0.99) == 5119);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 1) == 5119);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_HANDLER, 0.99) == 0);
+    slot = sg__httpsrv_slot_acquire(srv);
+    memset(slot->lats, 0, sizeof(slot->lats));
+    for (i = 0; i < 1000; i++)
+        sg__httpsrv_lat_add(slot, SG_HTTPSRV_PHASE_TOTAL, 100000);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 0.4) == 5);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 0.5) == 5119);
+    ASSERT(sg_httpsrv_lat_quantile(srv, SG_HTTPSRV_PHASE_TOTAL, 0.999) == 106495);
+    memset(slot->lats, 0, sizeof(slot->lats));
+    sg__httpsrv_slot_release(srv, slot);
+}
+
+static void test_httpsrv_set_metrics_path(struct sg_httpsrv *srv) {
+    ASSERT(sg_httpsrv_set_metrics_path(NULL, "/metrics") == EINVAL);
+    ASSERT(sg_httpsrv_set_metrics_path(srv, "metrics") == EINVAL);
+    ASSERT(sg_httpsrv_set_metrics_path(srv, "") == EINVAL);
+
+    ASSERT(sg_httpsrv_set_metrics_path(srv, "/metrics") == 0);
+    ASSERT(strcmp(srv->metrics_path, "/metrics") == 0);
+    ASSERT(sg_httpsrv_set_metrics_path(srv, NULL) == 0);
+    ASSERT(!srv->metrics_path);
+}
+
+static void test_httpsrv_metrics_path(struct sg_httpsrv *srv) {
+    errno = 0;
+    ASSERT(!sg_httpsrv_metrics_path(NULL));
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(!sg_httpsrv_metrics_path(srv));
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_metrics_path(srv, "/foo/metrics") == 0);
+    ASSERT(strcmp(sg_httpsrv_metrics_path(srv), "/foo/metrics") == 0);
+    ASSERT(sg_httpsrv_set_metrics_path(srv, NULL) == 0);
+    ASSERT(!sg_httpsrv_metrics_path(srv));
+}
+
+static void test_httpsrv_set_access_log(struct sg_httpsrv *srv) {
+    ASSERT(sg_httpsrv_set_access_log(NULL, "access.log", SG_HTTPSRV_LOG_COMMON) == EINVAL);
+    ASSERT(sg_httpsrv_set_access_log(srv, "", SG_HTTPSRV_LOG_COMMON) == EINVAL);
+    ASSERT(sg_httpsrv_set_access_log(srv, "access.log", (enum sg_httpsrv_log_fmt) -1) == EINVAL);
+    ASSERT(sg_httpsrv_set_access_log(srv, "access.log", (enum sg_httpsrv_log_fmt) 3) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_access_log(srv, "access.log", SG_HTTPSRV_LOG_JSON) == 0);
+    ASSERT(strcmp(srv->log_path, "access.log") == 0);
+    ASSERT(srv->log_fmt == SG_HTTPSRV_LOG_JSON);
+    ASSERT(!srv->log);
+    ASSERT(sg_httpsrv_set_access_log(srv, NULL, SG_HTTPSRV_LOG_COMMON) == 0);
+    ASSERT(!srv->log_path);
+}
+
+static void test_httpsrv_access_log(struct sg_httpsrv *srv) {
+    errno = 0;
+    ASSERT(!sg_httpsrv_access_log(NULL));
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(!sg_httpsrv_access_log(srv));
+    ASSERT(errno == 0);
+    ASSERT(sg_httpsrv_set_access_log(srv, "foo.log", SG_HTTPSRV_LOG_COMBINED) == 0);
+    ASSERT(strcmp(sg_httpsrv_access_log(srv), "foo.log") == 0);
+    ASSERT(sg_httpsrv_set_access_log(srv, NULL, SG_HTTPSRV_LOG_COMMON) == 0);
+    ASSERT(!sg_httpsrv_access_log(srv));
+}
+
+static void test_httpsrv_reopen_access_log(struct sg_httpsrv *srv) {
+    struct sg__httplog log;
+    ASSERT(sg_httpsrv_reopen_access_log(NULL) == EINVAL);
+
+    ASSERT(sg_httpsrv_reopen_access_log(srv) == 0);
+    memset(&log, 0, sizeof(struct sg__httplog));
+    srv->log = &log;
+    ASSERT(sg_httpsrv_reopen_access_log(srv) == 0);
+    ASSERT(log.reopen == 1);
+    srv->log = NULL;
+}
+
+static void test_httpsrv_set_accept_cb(struct sg_httpsrv *srv) {
+#ifndef _WIN32
+    struct sockaddr_in addr;
+    unsigned int accepted = 0;
+    uint64_t deadline;
+    int fd;
+#endif
+    ASSERT(sg_httpsrv_set_accept_cb(NULL, NULL, NULL) == EINVAL);
+
+    ASSERT(sg_httpsrv_set_accept_cb(srv, NULL, NULL) == 0);
+    ASSERT(!srv->accept_cb);
+#ifndef _WIN32
+    ASSERT(sg_httpsrv_set_accept_cb(srv, dummy_httpsrv_accept_cb, &accepted) == 0);
+    ASSERT(srv->accept_cb == dummy_httpsrv_accept_cb);
+    ASSERT(srv->accept_cls == &accepted);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_NODELAY, 1) == 0);
+    ASSERT(sg_httpsrv_listen(srv, 0, false));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(sg_httpsrv_port(srv));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT((fd = socket(AF_INET, SOCK_STREAM, 0)) > -1);
+    ASSERT(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    deadline = sg__monotonic() + 1000000;
+    while ((sg__atomic_get(&accepted) == 0) && (sg__monotonic() < deadline))
+        sg__usleep(1000);
+    ASSERT(sg__atomic_get(&accepted) == 2);
+    close(fd);
+    ASSERT(sg_httpsrv_shutdown(srv) == 0);
+    ASSERT(sg_httpsrv_set_sockopt(srv, SG_HTTPSRV_SOCKOPT_NODELAY, -1) == 0);
+    ASSERT(sg_httpsrv_set_accept_cb(srv, NULL, NULL) == 0);
+#endif
+}
+
 int main(void) {
     struct sg_httpsrv *srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
     /* test__httperr_cb() */
     test__httpsrv_oel("%s%d", "abc", 123);
+    test__httpsrv_err();
     test__httpsrv_ahc(srv);
     test__httpsrv_rcc();
     test__httpsrv_addopt();
+    test__httpsrv_lat_idx();
+    test__httpsrv_slots();
+    test__httpsrv_con();
+    test__httpsrv_metrics_render();
     test_httpsrv_new2();
     test_httpsrv_new();
     test_httpsrv_free();
     test_httpsrv_listen(srv);
+#ifndef _WIN32
+    test_httpsrv_listen_unix();
+#endif
+    test_httpsrv_listeners();
 #ifdef SG_HTTPS_SUPPORT
     test_httpsrv_tls_listen(srv);
     test_httpsrv_tls_listen2(srv);
 #endif
     test_httpsrv_shutdown(srv);
+    test_httpsrv_drain(srv);
+    test_httpsrv_export_fd(srv);
     test_httpsrv_port(srv);
     test_httpsrv_is_threaded(srv);
     test__httpsrv_set_upld_cbs(srv);
@@ -692,10 +1611,33 @@ int main(void) {
     test_httpsrv_uplds_limit(srv);
     test_httpsrv_set_thr_pool_size(srv);
     test_httpsrv_thr_pool_size(srv);
+    test_httpsrv_set_thr_stack_size(srv);
+    test_httpsrv_thr_stack_size(srv);
+    test_httpsrv_set_thr_affinity(srv);
+    test_httpsrv_thr_affinity(srv);
     test_httpsrv_set_con_timeout(srv);
     test_httpsrv_con_timeout(srv);
     test_httpsrv_set_con_limit(srv);
     test_httpsrv_con_limit(srv);
+    test_httpsrv_set_con_mem_limit(srv);
+    test_httpsrv_con_mem_limit(srv);
+    test_httpsrv_set_con_mem_increment(srv);
+    test_httpsrv_con_mem_increment(srv);
+    test_httpsrv_set_req_mem_limit(srv);
+    test_httpsrv_req_mem_limit(srv);
+    test_httpsrv_set_listen_fd(srv);
+    test_httpsrv_listen_fd(srv);
+    test_httpsrv_set_sockopt(srv);
+    test_httpsrv_sockopt(srv);
+    test_httpsrv_set_err_cb(srv);
+    test_httpsrv_stats(srv);
+    test_httpsrv_lat_quantile(srv);
+    test_httpsrv_set_metrics_path(srv);
+    test_httpsrv_metrics_path(srv);
+    test_httpsrv_set_access_log(srv);
+    test_httpsrv_access_log(srv);
+    test_httpsrv_reopen_access_log(srv);
+    test_httpsrv_set_accept_cb(srv);
     sg_httpsrv_free(srv);
     return EXIT_SUCCESS;
 }
@@ -73,6 +73,12 @@ static void dummy_err_cb(void *cls, const char *err) {
     strcpy(cls, err);
 }
 
+static void dummy_httpsrv_err_cb(void *cls, const struct sg_err *err) {
+    struct sg_err *dst = cls;
+    *dst = *err;
+    dst->msg = NULL;
+}
+
 static int empty_httpupld_cb(void *cls, void **handle, const char *dir, const char *field, const char *name,
                              const char *mime, const char *encoding) {
     (void) cls;
@@ -116,11 +122,23 @@ static void test__httpuplds_free(void) {
 static void test__httpuplds_err(void) {
     char err[256], str[256];
     struct sg_httpsrv *srv = sg_httpsrv_new2(NULL, NULL, dummy_httpreq_cb, NULL, dummy_err_cb, err);
+    struct sg_httpreq *req = sg__httpreq_new(NULL, "", "", "");
+    struct sg_err rec;
     memset(err, 0, sizeof(err));
-    sg__httpuplds_err(srv, "%s%d", "abc", 123);
+    sg__httpuplds_err(srv, SG_ERR_UPLDS_TOO_LARGE, 0, "%s%d", "abc", 123);
     memset(str, 0, sizeof(str));
     snprintf(str, sizeof(str), "abc123");
     ASSERT(strcmp(err, str) == 0);
+
+    ASSERT(sg_httpsrv_set_err_cb(srv, dummy_httpsrv_err_cb, &rec) == 0);
+    sg__httpuplds_req = req;
+    sg__httpuplds_err(srv, SG_ERR_UPLD_FILE, EACCES, "%s%d", "abc", 123);
+    sg__httpuplds_req = NULL;
+    ASSERT(rec.code == SG_ERR_UPLD_FILE);
+    ASSERT(rec.subsys == SG_ERR_SUBSYS_HTTPUPLDS);
+    ASSERT(rec.errnum == EACCES);
+    ASSERT(rec.req == req);
+    sg__httpreq_free(req);
     sg_httpsrv_free(srv);
 }
 
@@ -210,6 +228,18 @@ static void test__httpuplds_process(void) {
     ASSERT(sg__httpuplds_process(srv, req, con, "foo", &size, &ret));
     ASSERT(ret == MHD_YES);
     ASSERT(strcmp(sg_str_content(req->payload), "foo") == 0);
+    ASSERT(req->mem_size == len);
+
+    ASSERT(sg_httpsrv_set_req_mem_limit(srv, len + 1) == 0);
+    size = len;
+    ret = MHD_YES;
+    memset(err, 0, sizeof(err));
+    ASSERT(sg_httpsrv_set_payld_limit(srv, 0) == 0);
+    ASSERT(sg__httpuplds_process(srv, req, con, "foo", &size, &ret));
+    ASSERT(ret == MHD_NO);
+    memset(str, 0, sizeof(str));
+    snprintf(str, sizeof(str), _("Request too large.\n"));
+    ASSERT(strcmp(err, str) == 0);
 
     sg__httpreq_free(req);
     sg_httpsrv_free(srv);
@@ -28,11 +28,32 @@
 #include "sg_assert.h"
 
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
 #include <microhttpd.h>
 #include <sagui.h>
 #include "sg_strmap.h"
 #include "sg_httputils.h"
 
+static void test__hdr_id(void) {
+    char name[32];
+    size_t i;
+    int id;
+    for (id = 0; id < SG__HDRS; id++) {
+        ASSERT(sg__hdr_id(sg_hdr_name((enum sg_hdr) id)) == id);
+        strcpy(name, sg_hdr_name((enum sg_hdr) id));
+        for (i = 0; name[i]; i++)
+            name[i] = (char) toupper(name[i]);
+        ASSERT(sg__hdr_id(name) == id);
+    }
+    ASSERT(sg__hdr_id("content-type") == SG_HDR_CONTENT_TYPE);
+    ASSERT(sg__hdr_id("") == -1);
+    ASSERT(sg__hdr_id("X") == -1);
+    ASSERT(sg__hdr_id("Hosts") == -1);
+    ASSERT(sg__hdr_id("Hast") == -1);
+    ASSERT(sg__hdr_id("X-Custom") == -1);
+}
+
 static void test__httpcon_iter(void) {
     struct sg_strmap *map = NULL;
     ASSERT(sg__httpcon_iter(NULL, MHD_HEADER_KIND, "foo", "bar") == MHD_YES);
@@ -57,9 +78,27 @@ static void test_httpread_end(void) {
     ASSERT(sg_httpread_end(true) == (ssize_t) MHD_CONTENT_READER_END_WITH_ERROR);
 }
 
+static void test_hdr_name(void) {
+    errno = 0;
+    ASSERT(!sg_hdr_name((enum sg_hdr) -1));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_hdr_name((enum sg_hdr) SG__HDRS));
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(strcmp(sg_hdr_name(SG_HDR_ACCEPT), "Accept") == 0);
+    ASSERT(strcmp(sg_hdr_name(SG_HDR_CONTENT_TYPE), "Content-Type") == 0);
+    ASSERT(strcmp(sg_hdr_name(SG_HDR_WWW_AUTHENTICATE), "WWW-Authenticate") == 0);
+    ASSERT(strcmp(sg_hdr_name(SG_HDR_X_REQUESTED_WITH), "X-Requested-With") == 0);
+    ASSERT(errno == 0);
+}
+
 int main(void) {
+    test__hdr_id();
     test__httpcon_iter();
     test__httpheaders_iter();
     test_httpread_end();
+    test_hdr_name();
     return EXIT_SUCCESS;
 }
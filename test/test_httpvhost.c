@@ -0,0 +1,347 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "sg_httpvhost.c"
+#include "sg_httpres.h"
+
+static void dummy_httpreq_cb(__SG_UNUSED void *cls, __SG_UNUSED struct sg_httpreq *req,
+                             __SG_UNUSED struct sg_httpres *res) {
+}
+
+static void vhost_cb(void *cls, __SG_UNUSED struct sg_httpreq *req, __SG_UNUSED struct sg_httpres *res) {
+    strcpy(cls, "vhost");
+}
+
+static void route_cb(void *cls, struct sg_route *route, __SG_UNUSED struct sg_httpreq *req,
+                     __SG_UNUSED struct sg_httpres *res) {
+    strcpy(cls, sg_route_pattern(route));
+}
+
+static void test__httpvhost_host_len(void) {
+    ASSERT(sg__httpvhost_host_len("") == 0);
+    ASSERT(sg__httpvhost_host_len("example.com") == 11);
+    ASSERT(sg__httpvhost_host_len("example.com:8080") == 11);
+    ASSERT(sg__httpvhost_host_len("example.com.") == 11);
+    ASSERT(sg__httpvhost_host_len("example.com.:8080") == 11);
+    ASSERT(sg__httpvhost_host_len("[::1]") == 5);
+    ASSERT(sg__httpvhost_host_len("[::1]:8080") == 5);
+}
+
+static void test__httpvhost_is_host(void) {
+    ASSERT(sg__httpvhost_is_host("localhost"));
+    ASSERT(sg__httpvhost_is_host("example.com"));
+    ASSERT(sg__httpvhost_is_host("my-site_1.Example.com"));
+    ASSERT(sg__httpvhost_is_host("127.0.0.1"));
+    ASSERT(sg__httpvhost_is_host("[::1]"));
+    ASSERT(!sg__httpvhost_is_host(""));
+    ASSERT(!sg__httpvhost_is_host(".example.com"));
+    ASSERT(!sg__httpvhost_is_host("example.com."));
+    ASSERT(!sg__httpvhost_is_host("example.com:8080"));
+    ASSERT(!sg__httpvhost_is_host("*.example.com"));
+    ASSERT(!sg__httpvhost_is_host("exa mple.com"));
+    ASSERT(!sg__httpvhost_is_host("[]"));
+    ASSERT(!sg__httpvhost_is_host("[::1"));
+    ASSERT(!sg__httpvhost_is_host("[::g]"));
+}
+
+static void test_httpsrv_add_vhost(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost;
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(NULL, "example.com", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, NULL, dummy_httpreq_cb, NULL));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, "example.com", NULL, NULL));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, "", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, "example.com:80", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, ".example.com", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, "*.", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, "*.[::1]", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EINVAL);
+    srv->handle = (struct MHD_Daemon *) srv;
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EALREADY);
+    srv->handle = NULL;
+    ASSERT(!srv->vhosts);
+
+    sg_httpsrv_set_payld_limit(srv, 10);
+    sg_httpsrv_set_uplds_limit(srv, 20);
+    vhost = sg_httpsrv_add_vhost(srv, "Example.com", dummy_httpreq_cb, NULL);
+    ASSERT(vhost);
+    ASSERT(strcmp(vhost->host, "example.com") == 0);
+    ASSERT(!vhost->wildcard);
+    ASSERT(vhost->payld_limit == 10);
+    ASSERT(vhost->uplds_limit == 20);
+    ASSERT(strcmp(vhost->uplds_dir, srv->uplds_dir) == 0);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, "EXAMPLE.COM", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EEXIST);
+    vhost = sg_httpsrv_add_vhost(srv, "*.example.com", dummy_httpreq_cb, NULL);
+    ASSERT(vhost);
+    ASSERT(strcmp(vhost->host, "example.com") == 0);
+    ASSERT(vhost->wildcard);
+    errno = 0;
+    ASSERT(!sg_httpsrv_add_vhost(srv, "*.example.com", dummy_httpreq_cb, NULL));
+    ASSERT(errno == EEXIST);
+    ASSERT(sg_httpsrv_add_vhost(srv, "[::1]", dummy_httpreq_cb, NULL));
+    sg__httpvhosts_free(srv);
+    ASSERT(!srv->vhosts);
+    ASSERT(!srv->vhosts_tbl);
+}
+
+static void test__httpvhost_find(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost1, *vhost2, *vhost3, *vhost4;
+    char host[100];
+    int i;
+    ASSERT(!sg__httpvhost_find(srv, "example.com"));
+    vhost1 = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    vhost2 = sg_httpsrv_add_vhost(srv, "*.example.com", dummy_httpreq_cb, NULL);
+    vhost3 = sg_httpsrv_add_vhost(srv, "*.b.example.com", dummy_httpreq_cb, NULL);
+    vhost4 = sg_httpsrv_add_vhost(srv, "[::1]", dummy_httpreq_cb, NULL);
+    ASSERT(!sg__httpvhost_find(srv, NULL));
+    ASSERT(!sg__httpvhost_find(srv, ""));
+    ASSERT(!sg__httpvhost_find(srv, "example.org"));
+    ASSERT(!sg__httpvhost_find(srv, "xexample.com"));
+    ASSERT(!sg__httpvhost_find(srv, "[::2]"));
+    ASSERT(sg__httpvhost_find(srv, "example.com") == vhost1);
+    ASSERT(sg__httpvhost_find(srv, "EXAMPLE.Com") == vhost1);
+    ASSERT(sg__httpvhost_find(srv, "example.com:8080") == vhost1);
+    ASSERT(sg__httpvhost_find(srv, "example.com.") == vhost1);
+    ASSERT(sg__httpvhost_find(srv, "a.example.com") == vhost2);
+    ASSERT(sg__httpvhost_find(srv, "a.b.c.example.com:80") == vhost2);
+    ASSERT(sg__httpvhost_find(srv, "b.example.com") == vhost2);
+    ASSERT(sg__httpvhost_find(srv, "a.b.example.com") == vhost3);
+    ASSERT(sg__httpvhost_find(srv, "A.B.EXAMPLE.COM.") == vhost3);
+    ASSERT(sg__httpvhost_find(srv, "[::1]") == vhost4);
+    ASSERT(sg__httpvhost_find(srv, "[::1]:8080") == vhost4);
+
+    /* grows the table. */
+    for (i = 0; i < 100; i++) {
+        sprintf(host, "host%d.example.org", i);
+        ASSERT(sg_httpsrv_add_vhost(srv, host, dummy_httpreq_cb, NULL));
+    }
+    ASSERT(srv->vhosts_size >= 208);
+    for (i = 0; i < 100; i++) {
+        sprintf(host, "HOST%d.example.org:8080", i);
+        vhost1 = sg__httpvhost_find(srv, host);
+        ASSERT(vhost1);
+        ASSERT(strncmp(vhost1->host, "host", 4) == 0);
+        ASSERT(atoi(vhost1->host + 4) == i);
+    }
+    ASSERT(sg__httpvhost_find(srv, "a.b.example.com") == vhost3);
+    sg__httpvhosts_free(srv);
+}
+
+static void test__httpvhost_handle(struct sg_httpsrv *srv) {
+    struct sg_router *router = sg_router_new();
+    struct sg_httpreq *req = sg__httpreq_new(NULL, "HTTP/1.1", "GET", "/users/123");
+    struct sg_httpres *res = sg__httpres_new(NULL);
+    struct sg_httpvhost *vhost;
+    char str[100];
+    vhost = sg_httpsrv_add_vhost(srv, "example.com", vhost_cb, str);
+    memset(str, 0, sizeof(str));
+    sg__httpvhost_handle(vhost, req, res);
+    ASSERT(strcmp(str, "vhost") == 0);
+
+    sg_router_add(router, "GET", "/users/:id", route_cb, str);
+    sg_router_compile(router);
+    ASSERT(sg_httpvhost_set_router(vhost, router) == 0);
+    memset(str, 0, sizeof(str));
+    sg__httpvhost_handle(vhost, req, res);
+    ASSERT(strcmp(str, "/users/:id") == 0);
+    req->path = "/abc";
+    memset(str, 0, sizeof(str));
+    sg__httpvhost_handle(vhost, req, res);
+    ASSERT(strcmp(str, "vhost") == 0);
+    sg__httpvhosts_free(srv);
+    sg__httpres_free(res);
+    sg__httpreq_free(req);
+    sg_router_free(router);
+}
+
+static void test_httpvhost_set_router(struct sg_httpsrv *srv) {
+    struct sg_router *router = sg_router_new();
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    char str[100];
+    ASSERT(sg_httpvhost_set_router(NULL, router) == EINVAL);
+    sg_router_add(router, "GET", "/", route_cb, str);
+    ASSERT(sg_httpvhost_set_router(vhost, router) == EINVAL);
+    sg_router_compile(router);
+
+    ASSERT(sg_httpvhost_set_router(vhost, router) == 0);
+    ASSERT(vhost->router == router);
+    ASSERT(sg_httpvhost_set_router(vhost, NULL) == 0);
+    ASSERT(!vhost->router);
+    sg__httpvhosts_free(srv);
+    sg_router_free(router);
+}
+
+static void test_httpvhost_router(struct sg_httpsrv *srv) {
+    struct sg_router *router = sg_router_new();
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    char str[100];
+    errno = 0;
+    ASSERT(!sg_httpvhost_router(NULL));
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(!sg_httpvhost_router(vhost));
+    ASSERT(errno == 0);
+    sg_router_add(router, "GET", "/", route_cb, str);
+    sg_router_compile(router);
+    sg_httpvhost_set_router(vhost, router);
+    ASSERT(sg_httpvhost_router(vhost) == router);
+    sg__httpvhosts_free(srv);
+    sg_router_free(router);
+}
+
+static void test_httpvhost_set_upld_dir(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    ASSERT(sg_httpvhost_set_upld_dir(NULL, "foo") == EINVAL);
+    ASSERT(sg_httpvhost_set_upld_dir(vhost, NULL) == EINVAL);
+
+    ASSERT(sg_httpvhost_set_upld_dir(vhost, "foo") == 0);
+    ASSERT(strcmp(vhost->uplds_dir, "foo") == 0);
+    ASSERT(strcmp(vhost->uplds_dir, srv->uplds_dir) != 0);
+    sg__httpvhosts_free(srv);
+}
+
+static void test_httpvhost_upld_dir(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    errno = 0;
+    ASSERT(!sg_httpvhost_upld_dir(NULL));
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(strcmp(sg_httpvhost_upld_dir(vhost), srv->uplds_dir) == 0);
+    ASSERT(errno == 0);
+    sg_httpvhost_set_upld_dir(vhost, "bar");
+    ASSERT(strcmp(sg_httpvhost_upld_dir(vhost), "bar") == 0);
+    sg__httpvhosts_free(srv);
+}
+
+static void test_httpvhost_set_payld_limit(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    ASSERT(sg_httpvhost_set_payld_limit(NULL, 123) == EINVAL);
+
+    ASSERT(sg_httpvhost_set_payld_limit(vhost, 123) == 0);
+    ASSERT(vhost->payld_limit == 123);
+    sg__httpvhosts_free(srv);
+}
+
+static void test_httpvhost_payld_limit(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    errno = 0;
+    ASSERT(sg_httpvhost_payld_limit(NULL) == 0);
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(sg_httpvhost_payld_limit(vhost) == srv->payld_limit);
+    ASSERT(errno == 0);
+    sg_httpvhost_set_payld_limit(vhost, 123);
+    ASSERT(sg_httpvhost_payld_limit(vhost) == 123);
+    sg__httpvhosts_free(srv);
+}
+
+static void test_httpvhost_set_uplds_limit(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    ASSERT(sg_httpvhost_set_uplds_limit(NULL, 123) == EINVAL);
+
+    ASSERT(sg_httpvhost_set_uplds_limit(vhost, 123) == 0);
+    ASSERT(vhost->uplds_limit == 123);
+    sg__httpvhosts_free(srv);
+}
+
+static void test_httpvhost_uplds_limit(struct sg_httpsrv *srv) {
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    errno = 0;
+    ASSERT(sg_httpvhost_uplds_limit(NULL) == 0);
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(sg_httpvhost_uplds_limit(vhost) == srv->uplds_limit);
+    ASSERT(errno == 0);
+    sg_httpvhost_set_uplds_limit(vhost, 123);
+    ASSERT(sg_httpvhost_uplds_limit(vhost) == 123);
+    sg__httpvhosts_free(srv);
+}
+
+static void test_httpreq_vhost(struct sg_httpsrv *srv) {
+    struct sg_httpreq *req = sg__httpreq_new(NULL, "HTTP/1.1", "GET", "/");
+    struct sg_httpvhost *vhost = sg_httpsrv_add_vhost(srv, "example.com", dummy_httpreq_cb, NULL);
+    errno = 0;
+    ASSERT(!sg_httpreq_vhost(NULL));
+    ASSERT(errno == EINVAL);
+
+    errno = 0;
+    ASSERT(!sg_httpreq_vhost(req));
+    ASSERT(errno == 0);
+    req->vhost = vhost;
+    ASSERT(sg_httpreq_vhost(req) == vhost);
+    sg__httpvhosts_free(srv);
+    sg__httpreq_free(req);
+}
+
+int main(void) {
+    struct sg_httpsrv *srv = sg_httpsrv_new(dummy_httpreq_cb, NULL);
+    test__httpvhost_host_len();
+    test__httpvhost_is_host();
+    test_httpsrv_add_vhost(srv);
+    test__httpvhost_find(srv);
+    test__httpvhost_handle(srv);
+    test_httpvhost_set_router(srv);
+    test_httpvhost_router(srv);
+    test_httpvhost_set_upld_dir(srv);
+    test_httpvhost_upld_dir(srv);
+    test_httpvhost_set_payld_limit(srv);
+    test_httpvhost_payld_limit(srv);
+    test_httpvhost_set_uplds_limit(srv);
+    test_httpvhost_uplds_limit(srv);
+    test_httpreq_vhost(srv);
+    sg_httpsrv_free(srv);
+    return EXIT_SUCCESS;
+}
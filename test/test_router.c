@@ -0,0 +1,329 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ *   –– an ideal C library to develop cross-platform HTTP servers.
+ *
+ * Copyright (c) 2016-2018 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * This file is part of Sagui library.
+ *
+ * Sagui library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Sagui library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "sg_router.c"
+#include "sg_httpres.h"
+
+static void route_cb(void *cls, struct sg_route *route, __SG_UNUSED struct sg_httpreq *req,
+                     __SG_UNUSED struct sg_httpres *res) {
+    strcpy(cls, sg_route_pattern(route));
+}
+
+static void route_empty_cb(__SG_UNUSED void *cls, __SG_UNUSED struct sg_route *route,
+                           __SG_UNUSED struct sg_httpreq *req, __SG_UNUSED struct sg_httpres *res) {
+}
+
+/* matches a path and returns the matched pattern, or `NULL` if there is no route. */
+static const char *router_find(struct sg_router *router, const char *method, const char *path,
+                               struct sg_route *route, int *ret) {
+    struct sg__router_hnd *hnd;
+    if ((*ret = sg__router_find(router, method, path, route, &hnd)) != 0)
+        return NULL;
+    ASSERT(strcmp(hnd->pattern, route->pattern) == 0);
+    return route->pattern;
+}
+
+static bool route_param_is(struct sg_route *route, const char *name, const char *val) {
+    size_t len;
+    const char *str = sg_route_param(route, name, &len);
+    return str && (len == strlen(val)) && (memcmp(str, val, len) == 0);
+}
+
+static void test__router_is_pattern(void) {
+    char pattern[256];
+    int i;
+    ASSERT(sg__router_is_pattern("/"));
+    ASSERT(sg__router_is_pattern("/abc/def"));
+    ASSERT(sg__router_is_pattern("/abc/:id"));
+    ASSERT(sg__router_is_pattern("/abc/:id/def/:name_2"));
+    ASSERT(sg__router_is_pattern("/abc/*path"));
+    ASSERT(sg__router_is_pattern("/abc:def/x*y"));
+    ASSERT(!sg__router_is_pattern(""));
+    ASSERT(!sg__router_is_pattern("abc"));
+    ASSERT(!sg__router_is_pattern("/:"));
+    ASSERT(!sg__router_is_pattern("/abc/:id-x"));
+    ASSERT(!sg__router_is_pattern("/abc/*"));
+    ASSERT(!sg__router_is_pattern("/abc/*path/def"));
+    strcpy(pattern, "");
+    for (i = 0; i < SG__ROUTER_MAX_PARAMS; i++)
+        sprintf(pattern + strlen(pattern), "/:p%d", i);
+    ASSERT(sg__router_is_pattern(pattern));
+    strcat(pattern, "/*rest");
+    ASSERT(!sg__router_is_pattern(pattern));
+}
+
+static void test__router_method(void) {
+    ASSERT(sg__router_method("GET") == SG__ROUTER_GET);
+    ASSERT(sg__router_method("HEAD") == SG__ROUTER_HEAD);
+    ASSERT(sg__router_method("PATCH") == SG__ROUTER_ANY - 1);
+    ASSERT(sg__router_method("get") == -1);
+    ASSERT(sg__router_method("PROPFIND") == -1);
+}
+
+static void test_router_new(void) {
+    struct sg_router *router = sg_router_new();
+    ASSERT(router);
+    ASSERT(router->root);
+    ASSERT(!router->nodes);
+    sg_router_free(router);
+}
+
+static void test_router_free(void) {
+    sg_router_free(NULL);
+}
+
+static void test_router_add(void) {
+    struct sg_router *router = sg_router_new();
+    ASSERT(sg_router_add(NULL, "GET", "/", route_empty_cb, NULL) == EINVAL);
+    ASSERT(sg_router_add(router, "GET", NULL, route_empty_cb, NULL) == EINVAL);
+    ASSERT(sg_router_add(router, "GET", "/", NULL, NULL) == EINVAL);
+    ASSERT(sg_router_add(router, "FOO", "/", route_empty_cb, NULL) == EINVAL);
+    ASSERT(sg_router_add(router, "GET", "abc", route_empty_cb, NULL) == EINVAL);
+    ASSERT(sg_router_add(router, "GET", "/abc/*", route_empty_cb, NULL) == EINVAL);
+
+    ASSERT(sg_router_add(router, "GET", "/", route_empty_cb, NULL) == 0);
+    ASSERT(sg_router_add(router, "GET", "/", route_empty_cb, NULL) == EEXIST);
+    ASSERT(sg_router_add(router, "POST", "/", route_empty_cb, NULL) == 0);
+    ASSERT(sg_router_add(router, NULL, "/", route_empty_cb, NULL) == 0);
+    ASSERT(sg_router_add(router, NULL, "/", route_empty_cb, NULL) == EEXIST);
+    ASSERT(sg_router_add(router, "GET", "/users/:id", route_empty_cb, NULL) == 0);
+    ASSERT(sg_router_add(router, "PUT", "/users/:id", route_empty_cb, NULL) == 0);
+    ASSERT(sg_router_add(router, "GET", "/users/:name/posts", route_empty_cb, NULL) == EINVAL);
+    ASSERT(sg_router_add(router, "GET", "/users/:id/posts", route_empty_cb, NULL) == 0);
+    ASSERT(sg_router_add(router, "GET", "/files/*path", route_empty_cb, NULL) == 0);
+    ASSERT(sg_router_add(router, "GET", "/files/*name", route_empty_cb, NULL) == EINVAL);
+    ASSERT(sg_router_compile(router) == 0);
+    ASSERT(sg_router_add(router, "GET", "/abc", route_empty_cb, NULL) == EALREADY);
+    sg_router_free(router);
+}
+
+static void test_router_compile(void) {
+    struct sg_router *router = sg_router_new();
+    struct sg_route route;
+    int ret;
+    ASSERT(sg_router_compile(NULL) == EINVAL);
+
+    ASSERT(sg_router_compile(router) == 0);
+    ASSERT(!router->root);
+    ASSERT(router->nodes);
+    ASSERT(sg_router_compile(router) == EALREADY);
+    ASSERT(!router_find(router, "GET", "/", &route, &ret));
+    ASSERT(ret == ENOENT);
+    sg_router_free(router);
+
+    router = sg_router_new();
+    sg_router_add(router, "GET", "/abc", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/abd", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/a", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/b/:id", route_empty_cb, NULL);
+    ASSERT(sg_router_compile(router) == 0);
+    /* "" -> "/" -> ("a" -> "b" -> ("c", "d")), "b/" -> ":id" */
+    ASSERT(router->nodes[0].len == 0 && router->nodes[0].count == 1);
+    ASSERT(strcmp(router->nodes[1].label, "/") == 0 && router->nodes[1].count == 2);
+    ASSERT(router->nodes[1].child == 2);
+    ASSERT(strcmp(router->nodes[2].label, "a") == 0 && router->nodes[2].slots != -1);
+    ASSERT(strcmp(router->nodes[3].label, "b/") == 0 && router->nodes[3].param != 0);
+    ASSERT(strcmp(router->nodes[router->nodes[3].param].label, "id") == 0);
+    ASSERT(router->nodes[1].slots == -1);
+    sg_router_free(router);
+}
+
+static void test__router_find(void) {
+    struct sg_router *router = sg_router_new();
+    struct sg_route route;
+    int ret;
+    sg_router_add(router, "GET", "/", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/users", route_empty_cb, NULL);
+    sg_router_add(router, "POST", "/users", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/users/new", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/users/:id", route_empty_cb, NULL);
+    sg_router_add(router, "DELETE", "/users/:id", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/users/:id/posts/:post", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/files/*path", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/files/readme", route_empty_cb, NULL);
+    sg_router_add(router, NULL, "/any", route_empty_cb, NULL);
+    sg_router_add(router, "HEAD", "/head", route_empty_cb, NULL);
+    sg_router_add(router, "GET", "/head", route_empty_cb, NULL);
+    sg_router_compile(router);
+
+    ASSERT(strcmp(router_find(router, "GET", "/", &route, &ret), "/") == 0);
+    ASSERT(route.count == 0);
+    ASSERT(strcmp(router_find(router, "GET", "/users", &route, &ret), "/users") == 0);
+    ASSERT(strcmp(router_find(router, "POST", "/users", &route, &ret), "/users") == 0);
+    ASSERT(!router_find(router, "PUT", "/users", &route, &ret));
+    ASSERT(ret == ENOTSUP);
+    ASSERT(!router_find(router, "GET", "/users/", &route, &ret));
+    ASSERT(ret == ENOENT);
+    ASSERT(!router_find(router, "GET", "/user", &route, &ret));
+    ASSERT(ret == ENOENT);
+    ASSERT(!router_find(router, "GET", "/abc", &route, &ret));
+    ASSERT(ret == ENOENT);
+
+    ASSERT(strcmp(router_find(router, "GET", "/users/new", &route, &ret), "/users/new") == 0);
+    ASSERT(route.count == 0);
+    ASSERT(strcmp(router_find(router, "GET", "/users/newer", &route, &ret), "/users/:id") == 0);
+    ASSERT(route.count == 1);
+    ASSERT(route_param_is(&route, "id", "newer"));
+    ASSERT(strcmp(router_find(router, "GET", "/users/123", &route, &ret), "/users/:id") == 0);
+    ASSERT(route_param_is(&route, "id", "123"));
+    ASSERT(strcmp(router_find(router, "DELETE", "/users/123", &route, &ret), "/users/:id") == 0);
+    ASSERT(!router_find(router, "POST", "/users/123", &route, &ret));
+    ASSERT(ret == ENOTSUP);
+    ASSERT(strcmp(router_find(router, "GET", "/users/new/posts/abc", &route, &ret), "/users/:id/posts/:post") == 0);
+    ASSERT(route.count == 2);
+    ASSERT(route_param_is(&route, "id", "new"));
+    ASSERT(route_param_is(&route, "post", "abc"));
+    ASSERT(!router_find(router, "GET", "/users/123/posts", &route, &ret));
+    ASSERT(ret == ENOENT);
+    ASSERT(!router_find(router, "GET", "/users/123/posts/", &route, &ret));
+    ASSERT(ret == ENOENT);
+
+    ASSERT(strcmp(router_find(router, "GET", "/files/readme", &route, &ret), "/files/readme") == 0);
+    ASSERT(strcmp(router_find(router, "GET", "/files/readme.txt", &route, &ret), "/files/*path") == 0);
+    ASSERT(route_param_is(&route, "path", "readme.txt"));
+    ASSERT(strcmp(router_find(router, "GET", "/files/a/b/c", &route, &ret), "/files/*path") == 0);
+    ASSERT(route_param_is(&route, "path", "a/b/c"));
+    ASSERT(strcmp(router_find(router, "GET", "/files/", &route, &ret), "/files/*path") == 0);
+    ASSERT(route_param_is(&route, "path", ""));
+    ASSERT(!router_find(router, "POST", "/files/abc", &route, &ret));
+    ASSERT(ret == ENOTSUP);
+
+    ASSERT(strcmp(router_find(router, "GET", "/any", &route, &ret), "/any") == 0);
+    ASSERT(strcmp(router_find(router, "PROPFIND", "/any", &route, &ret), "/any") == 0);
+    ASSERT(!router_find(router, "PROPFIND", "/users", &route, &ret));
+    ASSERT(ret == ENOTSUP);
+    ASSERT(strcmp(router_find(router, "HEAD", "/users", &route, &ret), "/users") == 0);
+    ASSERT(strcmp(router_find(router, "HEAD", "/head", &route, &ret), "/head") == 0);
+    sg_router_free(router);
+}
+
+static void test__router_find_many(void) {
+    struct sg_router *router = sg_router_new();
+    struct sg_route route;
+    char pattern[64], path[64];
+    int i, ret;
+    for (i = 0; i < 300; i++) {
+        sprintf(pattern, "/api/v%d/res%d/:id/items/:item", i % 3, i);
+        ASSERT(sg_router_add(router, "GET", pattern, route_empty_cb, NULL) == 0);
+        sprintf(pattern, "/api/v%d/res%d", i % 3, i);
+        ASSERT(sg_router_add(router, "POST", pattern, route_empty_cb, NULL) == 0);
+    }
+    ASSERT(sg_router_compile(router) == 0);
+    for (i = 0; i < 300; i++) {
+        sprintf(path, "/api/v%d/res%d/%d/items/x%d", i % 3, i, i, i);
+        sprintf(pattern, "/api/v%d/res%d/:id/items/:item", i % 3, i);
+        ASSERT(strcmp(router_find(router, "GET", path, &route, &ret), pattern) == 0);
+        sprintf(pattern, "%d", i);
+        ASSERT(route_param_is(&route, "id", pattern));
+        sprintf(path, "/api/v%d/res%d", i % 3, i);
+        ASSERT(strcmp(router_find(router, "POST", path, &route, &ret), path) == 0);
+        sprintf(path, "/api/v%d/res%d", (i + 1) % 3, i);
+        ASSERT(!router_find(router, "POST", path, &route, &ret));
+    }
+    sg_router_free(router);
+}
+
+static void test_router_dispatch(void) {
+    struct sg_router *router = sg_router_new();
+    struct sg_httpreq *req = sg__httpreq_new(NULL, "HTTP/1.1", "GET", "/users/123");
+    struct sg_httpres *res = sg__httpres_new(NULL);
+    char str[100];
+    sg_router_add(router, "GET", "/users/:id", route_cb, str);
+    ASSERT(sg_router_dispatch(router, req, res) == EINVAL);
+    sg_router_compile(router);
+    ASSERT(sg_router_dispatch(NULL, req, res) == EINVAL);
+    ASSERT(sg_router_dispatch(router, NULL, res) == EINVAL);
+    ASSERT(sg_router_dispatch(router, req, NULL) == EINVAL);
+
+    memset(str, 0, sizeof(str));
+    ASSERT(sg_router_dispatch(router, req, res) == 0);
+    ASSERT(strcmp(str, "/users/:id") == 0);
+    req->method = "POST";
+    ASSERT(sg_router_dispatch(router, req, res) == ENOTSUP);
+    req->path = "/abc";
+    ASSERT(sg_router_dispatch(router, req, res) == ENOENT);
+    sg__httpres_free(res);
+    sg__httpreq_free(req);
+    sg_router_free(router);
+}
+
+static void test_route_pattern(void) {
+    struct sg_route route;
+    errno = 0;
+    ASSERT(!sg_route_pattern(NULL));
+    ASSERT(errno == EINVAL);
+    route.pattern = "/abc";
+    errno = 0;
+    ASSERT(strcmp(sg_route_pattern(&route), "/abc") == 0);
+    ASSERT(errno == 0);
+}
+
+static void test_route_param(void) {
+    struct sg_route route;
+    size_t len;
+    errno = 0;
+    ASSERT(!sg_route_param(NULL, "id", &len));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_route_param(&route, NULL, &len));
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(!sg_route_param(&route, "id", NULL));
+    ASSERT(errno == EINVAL);
+
+    route.count = 1;
+    route.params[0].name = "id";
+    route.params[0].val = "123/abc";
+    route.params[0].len = 3;
+    errno = 0;
+    ASSERT(!sg_route_param(&route, "abc", &len));
+    ASSERT(errno == 0);
+    ASSERT(strncmp(sg_route_param(&route, "id", &len), "123", 3) == 0);
+    ASSERT(len == 3);
+}
+
+int main(void) {
+    test__router_is_pattern();
+    test__router_method();
+    test_router_new();
+    test_router_free();
+    test_router_add();
+    test_router_compile();
+    test__router_find();
+    test__router_find_many();
+    test_router_dispatch();
+    test_route_pattern();
+    test_route_param();
+    return EXIT_SUCCESS;
+}
@@ -29,6 +29,7 @@
 
 #include "sg_assert.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <errno.h>
 #include "sg_strmap.c"
@@ -47,6 +48,125 @@ static void test__strmap_free(void) {
     sg__strmap_free(NULL);
 }
 
+static void test__strmap_add(void) {
+    struct sg_strmap *map = NULL, *pair;
+    char name[16], val[16];
+    unsigned int i;
+    for (i = 0; i < 1000; i++) {
+        sprintf(name, "Name%u", i);
+        sprintf(val, "%u", i);
+        sg__strmap_new(&pair, name, val);
+        sg__strmap_add(&map, pair);
+        ASSERT(pair->tbl == map->tbl);
+    }
+    ASSERT(sg_strmap_count(map) == 1000);
+    ASSERT(map->tbl->size >= 1024);
+    for (i = 0; i < 1000; i += 2) {
+        sprintf(name, "NAME%u", i);
+        ASSERT(sg_strmap_rm(&map, name) == 0);
+    }
+    ASSERT(sg_strmap_count(map) == 500);
+    for (i = 0; i < 1000; i++) {
+        sprintf(name, "name%u", i);
+        if (i % 2) {
+            ASSERT(sg_strmap_find(map, name, &pair) == 0);
+            ASSERT(strtol(pair->val, NULL, 10) == (long) i);
+        } else
+            ASSERT(sg_strmap_find(map, name, &pair) == ENOENT);
+    }
+    for (i = 1, pair = map; pair; pair = pair->next, i += 2) {
+        sprintf(name, "Name%u", i);
+        ASSERT(strcmp(pair->name, name) == 0);
+    }
+    sg_strmap_cleanup(&map);
+}
+
+static void test__strmap_append(void) {
+    struct sg_strmap *map = NULL, *pair;
+    char val[1001];
+    unsigned int i;
+    sg_strmap_add(&map, "abc", "123");
+    sg__strmap_new(&pair, "Def", "4");
+    sg__strmap_add(&map, pair);
+    sg_strmap_add(&map, "ghi", "789");
+    for (i = 0; i < 1000; i++)
+        pair = sg__strmap_append(&map, pair, "5", 1);
+    ASSERT(pair->val_len == 1001);
+    memset(val, '5', sizeof(val));
+    val[0] = '4';
+    ASSERT(memcmp(pair->val, val, sizeof(val)) == 0 && pair->val[1001] == '\0');
+    ASSERT(strcmp(pair->name, "Def") == 0 && strcmp(pair->key, "def") == 0);
+    ASSERT(sg_strmap_find(map, "DEF", &pair) == 0 && pair->val_len == 1001);
+    ASSERT(pair->prev == map && pair->next == map->tbl->tail && pair->next->prev == pair);
+    pair = map;
+    map = sg__strmap_append(&map, pair, "4", 1);
+    ASSERT(strcmp(sg_strmap_get(map, "abc"), "1234") == 0 && map->next->prev == map);
+    sg_strmap_cleanup(&map);
+
+    sg_strmap_add(&map, "abc", "1");
+    sg__strmap_new(&pair, "ABC", "2");
+    sg__strmap_add(&map, pair);
+    sg_strmap_add(&map, "abc", "3");
+    for (i = 0; i < 1000; i++)
+        pair = sg__strmap_append(&map, pair, "5", 1);
+    ASSERT(map->dup == pair && pair->dup == map->dup_last && pair->prev == map);
+    ASSERT(sg_strmap_get_all(map, "abc", NULL, 0) == 3);
+    for (i = 0; i < 1000; i++)
+        map = sg__strmap_append(&map, map, "5", 1);
+    ASSERT(map->dup == pair && pair->prev == map && map->val_len == 1001);
+    ASSERT(sg_strmap_find(map, "abc", &pair) == 0 && pair == map);
+    sg_strmap_cleanup(&map);
+
+    sg__strmap_new(&pair, "abc", "");
+    pair = sg__strmap_append(&map, pair, "123", 3);
+    ASSERT(!map && strcmp(pair->val, "123") == 0);
+    sg__strmap_free(pair);
+}
+
+static void test__strmap_hash(void) {
+    size_t len;
+    uint64_t seed1[2] = {0, 0}, seed2[2] = {0, 0};
+    uint32_t hash = sg__strmap_hash("Content-Type", &len);
+    ASSERT(sg__strmap_seeded == 2);
+    ASSERT(sg__strmap_seed_loaded);
+    ASSERT(sg__strmap_random(seed1));
+    ASSERT(sg__strmap_random(seed2));
+    ASSERT((seed1[0] != seed2[0]) || (seed1[1] != seed2[1]));
+    ASSERT(len == 12);
+    ASSERT(sg__strmap_hash("content-type", &len) == hash);
+    ASSERT(sg__strmap_hash("CONTENT-TYPE", &len) == hash);
+    ASSERT(sg__strmap_hash("Content-Typf", &len) != hash);
+    sg__strmap_hash("", &len);
+    ASSERT(len == 0);
+}
+
+static void test__strmap_lookup(void) {
+    struct sg_strmap *map = NULL, *pair;
+    sg_strmap_add(&map, "Content-Type", "text/plain");
+    sg_strmap_add(&map, "X-\xc3\x87", "abc");
+    ASSERT(sg_strmap_find(map, "CONTENT-TYPE", &pair) == 0);
+    ASSERT(strcmp(pair->key, "content-type") == 0 && strcmp(pair->name, "Content-Type") == 0);
+    ASSERT(sg_strmap_find(map, "content-typ", &pair) == ENOENT);
+    ASSERT(sg_strmap_find(map, "content-types", &pair) == ENOENT);
+    ASSERT(sg_strmap_find(map, "x-\xc3\x87", &pair) == 0);
+    ASSERT(strcmp(pair->key, "x-\xc3\x87") == 0);
+    ASSERT(sg_strmap_find(map, "x-\xc3\xa7", &pair) == ENOENT);
+    ASSERT(sg_strmap_rm(&map, "CoNtEnT-tYpE") == 0);
+    ASSERT(sg_strmap_count(map) == 1);
+    sg_strmap_cleanup(&map);
+}
+
+static void test__strmap_mem_size(void) {
+    struct sg_strmap *map = NULL, *pair;
+    ASSERT(sg__strmap_mem_size(NULL) == 0);
+    ASSERT(sg_strmap_add(&map, "ABC", "12345") == 0);
+    ASSERT(sg_strmap_find(map, "abc", &pair) == 0);
+    ASSERT(sg__strmap_pair_size(pair) == (sizeof(struct sg_strmap) + 4 + 4 + 6));
+    ASSERT(sg_strmap_add(&map, "D", "") == 0);
+    ASSERT(sg__strmap_mem_size(map) == ((sizeof(struct sg_strmap) * 2) + 4 + 4 + 6 + 2 + 2 + 1));
+    sg_strmap_cleanup(&map);
+}
+
 static void test_strmap_name(struct sg_strmap *pair) {
     errno = 0;
     ASSERT(sg_strmap_name(NULL) == NULL);
@@ -133,6 +253,70 @@ static void test_strmap_find(struct sg_strmap **map, const char *name, const cha
     ASSERT(strcmp(sg_strmap_name(pair), "yyy") == 0 && strcmp(sg_strmap_val(pair), "xxx") == 0);
 }
 
+static void test_strmap_find_next(struct sg_strmap **map) {
+    struct sg_strmap *pair;
+    ASSERT(sg_strmap_find_next(NULL) == EINVAL);
+    pair = NULL;
+    ASSERT(sg_strmap_find_next(&pair) == 0);
+    ASSERT(!pair);
+
+    sg_strmap_cleanup(map);
+    sg_strmap_add(map, "id", "1");
+    sg_strmap_add(map, "abc", "123");
+    sg_strmap_add(map, "ID", "2");
+    sg_strmap_add(map, "Id", "3");
+    ASSERT(sg_strmap_find(*map, "iD", &pair) == 0);
+    ASSERT(strcmp(sg_strmap_val(pair), "1") == 0);
+    ASSERT(sg_strmap_find_next(&pair) == 0);
+    ASSERT(strcmp(sg_strmap_val(pair), "2") == 0 && strcmp(sg_strmap_name(pair), "ID") == 0);
+    ASSERT(sg_strmap_find_next(&pair) == 0);
+    ASSERT(strcmp(sg_strmap_val(pair), "3") == 0);
+    ASSERT(sg_strmap_find_next(&pair) == 0);
+    ASSERT(!pair);
+    ASSERT(sg_strmap_find(*map, "abc", &pair) == 0);
+    ASSERT(sg_strmap_find_next(&pair) == 0);
+    ASSERT(!pair);
+}
+
+static void test_strmap_get_all(struct sg_strmap **map) {
+    const char *vals[2];
+    errno = 0;
+    ASSERT(sg_strmap_get_all(NULL, "id", vals, 2) == 0);
+    ASSERT(errno == EINVAL);
+    errno = 0;
+    ASSERT(sg_strmap_get_all(*map, NULL, vals, 2) == 0);
+    ASSERT(errno == EINVAL);
+
+    sg_strmap_cleanup(map);
+    sg_strmap_add(map, "abc", "123");
+    errno = 0;
+    ASSERT(sg_strmap_get_all(*map, "id", NULL, 0) == 0);
+    ASSERT(errno == 0);
+    errno = 0;
+    ASSERT(sg_strmap_get_all(*map, "id", NULL, 1) == 0);
+    ASSERT(errno == EINVAL);
+    sg_strmap_add(map, "id", "1");
+    sg_strmap_add(map, "ID", "2");
+    sg_strmap_add(map, "id", "3");
+    ASSERT(sg_strmap_get_all(*map, "id", NULL, 0) == 3);
+    ASSERT(sg_strmap_get_all(*map, "Id", vals, 2) == 3);
+    ASSERT(strcmp(vals[0], "1") == 0 && strcmp(vals[1], "2") == 0);
+    ASSERT(sg_strmap_get_all(*map, "abc", vals, 2) == 1);
+    ASSERT(strcmp(vals[0], "123") == 0);
+
+    ASSERT(sg_strmap_rm(map, "id") == 0);
+    ASSERT(sg_strmap_get_all(*map, "id", vals, 2) == 2);
+    ASSERT(strcmp(vals[0], "2") == 0 && strcmp(vals[1], "3") == 0);
+    ASSERT(sg_strmap_count(*map) == 3);
+    ASSERT(sg_strmap_set(map, "ID", "4") == 0);
+    ASSERT(sg_strmap_get_all(*map, "id", vals, 2) == 1);
+    ASSERT(strcmp(vals[0], "4") == 0);
+    ASSERT(sg_strmap_count(*map) == 2);
+    ASSERT(sg_strmap_rm(map, "id") == 0);
+    ASSERT(sg_strmap_get_all(*map, "id", vals, 2) == 0);
+    ASSERT(sg_strmap_count(*map) == 1);
+}
+
 static void test_strmap_get(struct sg_strmap **map, const char *name, const char *val) {
     ASSERT(!sg_strmap_get(NULL, name));
     ASSERT(!sg_strmap_get(*map, NULL));
@@ -340,6 +524,126 @@ static void test_strmap_next(struct sg_strmap **map) {
     ASSERT(strcmp(str, "abc123def456xxxyyy") == 0);
 }
 
+static void test_strmap_freeze(struct sg_strmap **map) {
+    struct sg_strmap_snap *snap;
+    struct sg_strmap *pair;
+    char str[100], name[10];
+    unsigned int i;
+    ASSERT(sg_strmap_freeze(*map, NULL) == EINVAL);
+
+    ASSERT(sg_strmap_freeze(NULL, &snap) == 0);
+    ASSERT(sg_strmap_snap_count(snap) == 0);
+    ASSERT(sg_strmap_snap_find(snap, "abc", &pair) == ENOENT);
+    ASSERT(!pair);
+    ASSERT(!sg_strmap_snap_get(snap, "abc"));
+    ASSERT(sg_strmap_snap_iter(snap, strmap_iter_123, NULL) == 0);
+    sg_strmap_snap_release(snap);
+
+    sg_strmap_cleanup(map);
+    sg_strmap_add(map, "abc", "123");
+    sg_strmap_add(map, "Id", "1");
+    sg_strmap_add(map, "def", "456");
+    sg_strmap_add(map, "ID", "2");
+    ASSERT(sg_strmap_freeze(*map, &snap) == 0);
+    /* the snapshot doesn't depend on the map anymore. */
+    sg_strmap_set(map, "abc", "xxx");
+    sg_strmap_cleanup(map);
+    ASSERT(sg_strmap_snap_count(snap) == 4);
+
+    ASSERT(sg_strmap_snap_find(NULL, "abc", &pair) == EINVAL);
+    ASSERT(sg_strmap_snap_find(snap, NULL, &pair) == EINVAL);
+    ASSERT(sg_strmap_snap_find(snap, "abc", NULL) == EINVAL);
+    ASSERT(sg_strmap_snap_find(snap, "xxx", &pair) == ENOENT);
+    ASSERT(sg_strmap_snap_find(snap, "ABC", &pair) == 0);
+    ASSERT(strcmp(sg_strmap_name(pair), "abc") == 0 && strcmp(sg_strmap_val(pair), "123") == 0);
+    ASSERT(sg_strmap_snap_find(snap, "id", &pair) == 0);
+    ASSERT(strcmp(sg_strmap_name(pair), "Id") == 0 && strcmp(sg_strmap_val(pair), "1") == 0);
+    ASSERT(sg_strmap_find_next(&pair) == 0);
+    ASSERT(strcmp(sg_strmap_name(pair), "ID") == 0 && strcmp(sg_strmap_val(pair), "2") == 0);
+    ASSERT(sg_strmap_find_next(&pair) == 0);
+    ASSERT(!pair);
+
+    ASSERT(!sg_strmap_snap_get(NULL, "abc"));
+    ASSERT(!sg_strmap_snap_get(snap, NULL));
+    ASSERT(!sg_strmap_snap_get(snap, "xxx"));
+    ASSERT(strcmp(sg_strmap_snap_get(snap, "DEF"), "456") == 0);
+
+    ASSERT(sg_strmap_snap_iter(NULL, strmap_iter_concat, str) == EINVAL);
+    ASSERT(sg_strmap_snap_iter(snap, NULL, str) == EINVAL);
+    ASSERT(sg_strmap_snap_iter(snap, strmap_iter_123, NULL) == 123);
+    memset(str, 0, sizeof(str));
+    ASSERT(sg_strmap_snap_iter(snap, strmap_iter_concat, str) == 0);
+    ASSERT(strcmp(str, "abc123Id1def456ID2") == 0);
+    ASSERT(sg_strmap_snap_count(NULL) == 0);
+    sg_strmap_snap_release(snap);
+    sg_strmap_snap_release(NULL);
+
+    for (i = 0; i < 100; i++) {
+        sprintf(name, "key%u", i);
+        sprintf(str, "%u", i);
+        sg_strmap_add(map, name, str);
+    }
+    ASSERT(sg_strmap_sort(map, strmap_sort_name_desc, NULL) == 0);
+    ASSERT(sg_strmap_freeze(*map, &snap) == 0);
+    sg_strmap_cleanup(map);
+    ASSERT(sg_strmap_snap_count(snap) == 100);
+    for (i = 0; i < 100; i++) {
+        sprintf(name, "KEY%u", i);
+        sprintf(str, "%u", i);
+        ASSERT(strcmp(sg_strmap_snap_get(snap, name), str) == 0);
+    }
+    /* the order of the map is kept. */
+    pair = snap->pairs;
+    ASSERT(strcmp(sg_strmap_name(pair), "key99") == 0);
+    ASSERT(sg_strmap_next(&pair) == 0);
+    ASSERT(strcmp(sg_strmap_name(pair), "key98") == 0);
+    sg_strmap_snap_release(snap);
+}
+
+static void test_strmap_shared(void) {
+    struct sg_strmap_shared *shared;
+    struct sg_strmap_snap *snap, *old, *cur;
+    struct sg_strmap *map = NULL;
+    errno = 0;
+    ASSERT(!sg_strmap_shared_acquire(NULL));
+    ASSERT(errno == EINVAL);
+    ASSERT(sg_strmap_shared_swap(NULL, NULL) == EINVAL);
+    sg_strmap_shared_free(NULL);
+
+    shared = sg_strmap_shared_new(NULL);
+    ASSERT(shared);
+    errno = 0;
+    ASSERT(!sg_strmap_shared_acquire(shared));
+    ASSERT(errno == 0);
+
+    sg_strmap_add(&map, "abc", "123");
+    sg_strmap_freeze(map, &snap);
+    ASSERT(sg_strmap_shared_swap(shared, snap) == 0);
+    old = sg_strmap_shared_acquire(shared);
+    ASSERT(old == snap);
+    ASSERT(old->refs == 2);
+
+    sg_strmap_set(&map, "abc", "456");
+    sg_strmap_freeze(map, &snap);
+    sg_strmap_cleanup(&map);
+    ASSERT(sg_strmap_shared_swap(shared, snap) == 0);
+    /* the old snapshot is still valid for the reader which acquired it. */
+    ASSERT(old->refs == 1);
+    ASSERT(strcmp(sg_strmap_snap_get(old, "abc"), "123") == 0);
+    cur = sg_strmap_shared_acquire(shared);
+    ASSERT(strcmp(sg_strmap_snap_get(cur, "abc"), "456") == 0);
+    sg_strmap_snap_release(old);
+
+    ASSERT(sg_strmap_shared_swap(shared, NULL) == 0);
+    ASSERT(!sg_strmap_shared_acquire(shared));
+    ASSERT(strcmp(sg_strmap_snap_get(cur, "abc"), "456") == 0);
+    sg_strmap_snap_release(cur);
+
+    sg_strmap_freeze(NULL, &snap);
+    ASSERT(sg_strmap_shared_swap(shared, snap) == 0);
+    sg_strmap_shared_free(shared);
+}
+
 static void test_strmap_cleanup(struct sg_strmap **map) {
     sg_strmap_cleanup(NULL);
     sg_strmap_cleanup(map);
@@ -365,17 +669,26 @@ int main(void) {
 
     test__strmap_new();
     test__strmap_free();
+    test__strmap_add();
+    test__strmap_hash();
+    test__strmap_append();
+    test__strmap_lookup();
+    test__strmap_mem_size();
     test_strmap_name(pair);
     test_strmap_val(pair);
     test_strmap_add(&map, name, val);
     test_strmap_set(&map, name, val);
     test_strmap_find(&map, name, val);
+    test_strmap_find_next(&map);
+    test_strmap_get_all(&map);
     test_strmap_get(&map, name, val);
     test_strmap_rm(&map, name, val);
     test_strmap_iter(&map);
     test_strmap_sort(&map);
     test_strmap_count(&map, name, val);
     test_strmap_next(&map);
+    test_strmap_freeze(&map);
+    test_strmap_shared();
     test_strmap_cleanup(&map);
 
     sg_strmap_cleanup(&map);
@@ -224,6 +224,44 @@ static void test__is_cookie_val(void) {
     sg_free(str);
 }
 
+static void test__is_header_name(void) {
+    ASSERT(sg__is_header_name("a"));
+    ASSERT(sg__is_header_name("Content-Type"));
+    ASSERT(sg__is_header_name("X-Foo_Bar.1"));
+    ASSERT(sg__is_header_name("!#$%&'*+-.^_`|~"));
+    ASSERT(!sg__is_header_name(""));
+    ASSERT(!sg__is_header_name("Content Type"));
+    ASSERT(!sg__is_header_name("Content-Type:"));
+    ASSERT(!sg__is_header_name("Content\r\nType"));
+    ASSERT(!sg__is_header_name("(abc)"));
+    ASSERT(!sg__is_header_name("abç"));
+}
+
+static void test__is_header_val(void) {
+    ASSERT(sg__is_header_val(""));
+    ASSERT(sg__is_header_val("text/html; charset=utf-8"));
+    ASSERT(sg__is_header_val("abc\t123"));
+    ASSERT(sg__is_header_val("abç"));
+    ASSERT(!sg__is_header_val("abc\r\nSet-Cookie: a=b"));
+    ASSERT(!sg__is_header_val("abc\n123"));
+    ASSERT(!sg__is_header_val("abc\a123"));
+    ASSERT(!sg__is_header_val("abc\x7f"));
+}
+
+static void test__monotonic(void) {
+    uint64_t t1, t2;
+    t1 = sg__monotonic();
+    t2 = sg__monotonic();
+    ASSERT(t2 >= t1);
+}
+
+static void test__usleep(void) {
+    uint64_t t;
+    t = sg__monotonic();
+    sg__usleep(10000);
+    ASSERT(sg__monotonic() - t >= 10000);
+}
+
 static void test_version(void) {
     const char *ver_original;
     char ver_local[9];
@@ -274,6 +312,64 @@ static void test_free(void) {
     sg_free(NULL);
 }
 
+static unsigned int allocs;
+
+static void *dummy_malloc_cb(size_t size) {
+    allocs++;
+    return malloc(size);
+}
+
+static void *dummy_realloc_cb(void *ptr, size_t size) {
+    if (!ptr)
+        allocs++;
+    return realloc(ptr, size);
+}
+
+static void dummy_free_cb(void *ptr) {
+    ASSERT(ptr);
+    allocs--;
+    free(ptr);
+}
+
+static void test_set_allocator(void) {
+    struct sg_strmap *map = NULL, *pair;
+    struct sg_str *str;
+    char *ptr;
+    unsigned int count;
+    ASSERT(sg_set_allocator(dummy_malloc_cb, NULL, NULL) == EINVAL);
+    ASSERT(sg_set_allocator(NULL, dummy_realloc_cb, dummy_free_cb) == EINVAL);
+
+    ASSERT(sg_set_allocator(dummy_malloc_cb, dummy_realloc_cb, dummy_free_cb) == 0);
+    allocs = 0;
+    ptr = sg_alloc(10);
+    ASSERT(allocs == 1);
+    ptr = sg_realloc(ptr, 20);
+    ASSERT(allocs == 1);
+    sg_free(ptr);
+    sg_free(NULL);
+    ASSERT(allocs == 0);
+    ASSERT(sg_strmap_add(&map, "abc", "123") == 0);
+    ASSERT(allocs > 0);
+    count = allocs;
+    ASSERT(strcmp(sg_strmap_get(map, "ABC"), "123") == 0);
+    ASSERT(sg_strmap_find(map, "aBc", &pair) == 0);
+    ASSERT(sg_strmap_find(map, "xyz", &pair) == ENOENT);
+    ASSERT(sg_strmap_rm(&map, "xyz") == ENOENT);
+    ASSERT(allocs == count);
+    sg_strmap_cleanup(&map);
+    ASSERT(allocs == 0);
+    str = sg_str_new();
+    ASSERT(sg_str_printf(str, "%s", "abc") == 0);
+    ASSERT(allocs > 0);
+    sg_str_free(str);
+    ASSERT(allocs == 0);
+    ptr = sg_tmpdir();
+    ASSERT(allocs == 1);
+    sg_free(ptr);
+    ASSERT(allocs == 0);
+    ASSERT(sg_set_allocator(NULL, NULL, NULL) == 0);
+}
+
 static void test_strerror(void) {
     char err[256];
     ASSERT(!sg_strerror(0, NULL, sizeof(err)));
@@ -284,6 +380,32 @@ static void test_strerror(void) {
     ASSERT(strcmp(err, strerror(EINVAL)) == 0);
 }
 
+static void test_err_dup(void) {
+    struct sg_err err, *dup;
+    int dummy = 123;
+    errno = 0;
+    ASSERT(!sg_err_dup(NULL));
+    ASSERT(errno == EINVAL);
+
+    err.code = SG_ERR_UPLD_FILE;
+    err.subsys = SG_ERR_SUBSYS_HTTPUPLDS;
+    err.errnum = EACCES;
+    err.req = (struct sg_httpreq *) &dummy;
+    err.msg = "abc";
+    ASSERT((dup = sg_err_dup(&err)));
+    ASSERT(dup->code == SG_ERR_UPLD_FILE);
+    ASSERT(dup->subsys == SG_ERR_SUBSYS_HTTPUPLDS);
+    ASSERT(dup->errnum == EACCES);
+    ASSERT(dup->req == (struct sg_httpreq *) &dummy);
+    ASSERT(dup->msg != err.msg);
+    ASSERT(strcmp(dup->msg, "abc") == 0);
+    sg_free(dup);
+    err.msg = NULL;
+    ASSERT((dup = sg_err_dup(&err)));
+    ASSERT(!dup->msg);
+    sg_free(dup);
+}
+
 static void test_is_post(void) {
     ASSERT(!sg_is_post(NULL));
     ASSERT(!sg_is_post(""));
@@ -318,18 +440,51 @@ static void test_tmpdir(void) {
     sg_free(tmp);
 }
 
+static void test_inherited_fd(void) {
+#ifndef _WIN32
+    char pid[32];
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    errno = 0;
+    ASSERT(sg_inherited_fd() == -1);
+    ASSERT(errno == ENOENT);
+    setenv("LISTEN_FDS", "1", 1);
+    ASSERT(sg_inherited_fd() == 3);
+    setenv("LISTEN_PID", "1", 1);
+    errno = 0;
+    ASSERT(sg_inherited_fd() == -1);
+    ASSERT(errno == ENOENT);
+    snprintf(pid, sizeof(pid), "%ld", (long) getpid());
+    setenv("LISTEN_PID", pid, 1);
+    ASSERT(sg_inherited_fd() == 3);
+    setenv("LISTEN_FDS", "0", 1);
+    errno = 0;
+    ASSERT(sg_inherited_fd() == -1);
+    ASSERT(errno == ENOENT);
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+#endif
+}
+
 int main(void) {
     test__strdup();
     test__toasciilower();
     test__strjoin();
     test__is_cookie_name();
     test__is_cookie_val();
+    test__is_header_name();
+    test__is_header_val();
+    test__monotonic();
+    test__usleep();
     test_version();
     test_alloc();
     test_realloc();
     test_free();
+    test_set_allocator();
     test_strerror();
+    test_err_dup();
     test_is_post();
     test_tmpdir();
+    test_inherited_fd();
     return EXIT_SUCCESS;
 }